@@ -0,0 +1,394 @@
+/*
+ *  micro and end to end benchmarks for the C library, results as JSON
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+// usage: ssss_bench [-q] [-d] [-t min_ms] [-f filter]
+//
+//   -q         quick: fewer configurations and a shorter minimum time
+//   -d         degree sweep: field_mult and field_invert from 64 bits to
+//              MAXDEGREE with every backend, instead of the usual set
+//   -t min_ms  minimum measured time per repetition (default 20)
+//   -f filter  only run benchmarks whose name contains filter
+//
+// all inputs come from a fixed seed so runs are comparable; each result
+// is the median of REPETITIONS timed runs after a warm up
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shamir.h"
+#include "field.h"
+
+#define REPETITIONS 5
+
+// allocation counting by replacing malloc, only where it can be forwarded
+#if defined(__GLIBC__)
+#define COUNT_ALLOCATIONS 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void __libc_free(void *p);
+
+static uint64_t allocations = 0;
+
+void *malloc(size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(p, size);
+}
+
+void free(void *p) {
+    __libc_free(p);
+}
+
+static uint64_t allocation_count(void) {
+    return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+#else
+#define COUNT_ALLOCATIONS 0
+
+static uint64_t allocation_count(void) {
+    return 0;
+}
+#endif
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// deterministic bytes (xorshift64*)
+static uint64_t seed = 0x5eed5eed5eed5eedULL;
+
+static uint8_t next_byte(void) {
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return (uint8_t)((seed * 0x2545F4914F6CDD1DULL) >> 56);
+}
+
+typedef void bench_fn_t(void *context);
+
+typedef struct {
+    uint64_t iterations;           // per repetition
+    double ns_per_op;              // median
+    double allocs_per_op;
+} measurement_t;
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static measurement_t measure(bench_fn_t *fn, void *context, uint64_t min_ns) {
+    measurement_t m = { .iterations = 1 };
+    fn(context);                   // warm up
+
+    for (;;) {
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < m.iterations; ++i) {
+            fn(context);
+        }
+        if (now_ns() - start >= min_ns || m.iterations >= (1ULL << 40)) {
+            break;
+        }
+        m.iterations *= 2;
+    }
+
+    double ns[REPETITIONS];
+    uint64_t allocated = allocation_count();
+    for (int r = 0; r < REPETITIONS; ++r) {
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < m.iterations; ++i) {
+            fn(context);
+        }
+        ns[r] = (double)(now_ns() - start) / (double)m.iterations;
+    }
+    m.allocs_per_op = (double)(allocation_count() - allocated) / (double)(REPETITIONS * m.iterations);
+    qsort(ns, REPETITIONS, sizeof(double), compare_double);
+    m.ns_per_op = ns[REPETITIONS / 2];
+    return m;
+}
+
+// JSON output, one object per result
+static bool first_result = true;
+
+static void report(const char *name, const measurement_t *m, const char *parameters) {
+    printf("%s\n    {\"name\": \"%s\", %s, \"iterations\": %llu, \"ns_per_op\": %.1f, \"ops_per_sec\": %.1f, \"allocs_per_op\": %.2f}",
+           first_result ? "" : ",", name, parameters, (unsigned long long)m->iterations,
+           m->ns_per_op, m->ns_per_op > 0 ? 1e9 / m->ns_per_op : 0.0, m->allocs_per_op);
+    first_result = false;
+    fflush(stdout);
+}
+
+static bool selected(const char *filter, const char *name) {
+    return NULL == filter || NULL != strstr(name, filter);
+}
+
+
+// field arithmetic
+
+typedef struct {
+    poly_degree_t pd;
+    mpz_t x, y, z;
+} field_bench_t;
+
+static void random_element(mpz_t x, unsigned int degree) {
+    uint8_t bytes[MAXDEGREE / 8];
+    do {
+        for (unsigned int i = 0; i < degree / 8; ++i) {
+            bytes[i] = next_byte();
+        }
+        mpz_import(x, degree / 8, 1, 1, 0, 0, bytes);
+    } while (0 == mpz_cmp_ui(x, 0));
+}
+
+static void bench_field_mult(void *context) {
+    field_bench_t *fb = (field_bench_t *)context;
+    field_mult(fb->z, fb->x, fb->y, &fb->pd);
+}
+
+static void bench_field_invert(void *context) {
+    field_bench_t *fb = (field_bench_t *)context;
+    field_invert(fb->z, fb->x, &fb->pd);
+}
+
+static void field_benchmark(int degree, const char *parameters, uint64_t min_ns, const char *filter) {
+    field_bench_t fb;
+    field_init(&fb.pd, degree);
+    mpz_init(fb.x);
+    mpz_init(fb.y);
+    mpz_init(fb.z);
+    random_element(fb.x, degree);
+    random_element(fb.y, degree);
+
+    if (selected(filter, "field_mult")) {
+        measurement_t m = measure(bench_field_mult, &fb, min_ns);
+        report("field_mult", &m, parameters);
+    }
+    if (selected(filter, "field_invert")) {
+        measurement_t m = measure(bench_field_invert, &fb, min_ns);
+        report("field_invert", &m, parameters);
+    }
+
+    mpz_clear(fb.x);
+    mpz_clear(fb.y);
+    mpz_clear(fb.z);
+    field_deinit(&fb.pd);
+}
+
+static void field_benchmarks(const int *degrees, int degree_count, uint64_t min_ns, const char *filter) {
+    for (int d = 0; d < degree_count; ++d) {
+        char parameters[64];
+        snprintf(parameters, sizeof(parameters), "\"degree\": %d", degrees[d]);
+        field_benchmark(degrees[d], parameters, min_ns, filter);
+    }
+}
+
+// cost against degree, each backend forced through field_choice
+static void degree_sweep(uint64_t min_ns, const char *filter) {
+    static const int degrees[] = { 64, 128, 256, 512, 1024, 1536, 2048, 3072, 4096, 6144, 8192 };
+    for (size_t d = 0; d < sizeof(degrees) / sizeof(int) && degrees[d] <= MAXDEGREE; ++d) {
+        for (int b = FIELD_BACKEND_GENERIC; b < FIELD_BACKEND_maximum; ++b) {
+            if (! field_backend_available((field_backend_t)b, degrees[d])) {
+                continue;
+            }
+            field_choice_t saved = field_choice[degrees[d] / 8];
+            field_choice[degrees[d] / 8].mult = b;
+            field_choice[degrees[d] / 8].invert = b;
+            char parameters[64];
+            snprintf(parameters, sizeof(parameters), "\"degree\": %d, \"backend\": \"%s\"",
+                     degrees[d], field_backend_name((field_backend_t)b));
+            field_benchmark(degrees[d], parameters, min_ns, filter);
+            field_choice[degrees[d] / 8] = saved;
+        }
+    }
+}
+
+
+// end to end through the wrapped API
+
+#define RANDOM_BYTES (16 * MAXDEGREE / 8)
+
+typedef struct {
+    char secret[MAXDEGREE / 4 + 1];
+    int degree;
+    int threshold;
+    int number;
+    bool diffusion;
+    bool hexmode;
+    char random_bytes[RANDOM_BYTES];
+    char **shares;
+    char result[MAXDEGREE / 4 + 2];    // field_print wants room for one more
+    error_t error;
+} share_bench_t;
+
+static void bench_split(void *context) {
+    share_bench_t *sb = (share_bench_t *)context;
+    error_t err = wrapped_split(sb->shares, sb->secret, sb->degree, sb->threshold, sb->number,
+                                sb->diffusion, NULL, sb->hexmode, sb->random_bytes, RANDOM_BYTES);
+    if (ERROR_OK != err) {
+        sb->error = err;
+    }
+}
+
+static void bench_combine(void *context) {
+    share_bench_t *sb = (share_bench_t *)context;
+    error_t err = wrapped_combine(sb->result, sizeof(sb->result), (const char **)sb->shares,
+                                  sb->threshold, sb->diffusion, sb->hexmode);
+    if (ERROR_OK != err) {
+        sb->error = err;
+    }
+}
+
+static void share_benchmark(share_bench_t *sb, uint64_t min_ns, const char *filter) {
+    // a secret that fills the field
+    for (int i = 0; i < sb->degree / (sb->hexmode ? 4 : 8); ++i) {
+        uint8_t b = next_byte();
+        sb->secret[i] = sb->hexmode ? "0123456789abcdef"[b & 15] : (char)(' ' + 1 + b % 94);
+    }
+    sb->secret[sb->degree / (sb->hexmode ? 4 : 8)] = '\0';
+    for (int i = 0; i < RANDOM_BYTES; ++i) {
+        sb->random_bytes[i] = (char)next_byte();
+    }
+    sb->shares = wrapped_allocate_shares(sb->number);
+    if (NULL == sb->shares) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    char parameters[160];
+    snprintf(parameters, sizeof(parameters),
+             "\"degree\": %d, \"threshold\": %d, \"number\": %d, \"diffusion\": %s, \"hexmode\": %s",
+             sb->degree, sb->threshold, sb->number, sb->diffusion ? "true" : "false", sb->hexmode ? "true" : "false");
+
+    sb->error = ERROR_OK;
+    bench_split(sb);               // shares for combine even if split is filtered out
+    if (ERROR_OK == sb->error && selected(filter, "wrapped_split")) {
+        measurement_t m = measure(bench_split, sb, min_ns);
+        report("wrapped_split", &m, parameters);
+    }
+    if (ERROR_OK == sb->error && selected(filter, "wrapped_combine")) {
+        measurement_t m = measure(bench_combine, sb, min_ns);
+        report("wrapped_combine", &m, parameters);
+        if (ERROR_OK == sb->error && 0 != strcmp(sb->result, sb->secret)) {
+            sb->error = ERROR_SHARES_INCONSISTENT;
+        }
+    }
+    if (ERROR_OK != sb->error) {
+        fprintf(stderr, "%s: error %d\n", parameters, sb->error);
+        exit(1);
+    }
+    wrapped_free_shares(sb->shares, sb->number);
+}
+
+int main(int argc, char *argv[]) {
+    bool quick = false;
+    bool sweep = false;
+    long min_ms = 0;
+    const char *filter = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "qdt:f:")) != -1) {
+        switch (opt) {
+            case 'q':
+                quick = true;
+                break;
+            case 'd':
+                sweep = true;
+                break;
+            case 't':
+                min_ms = atol(optarg);
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-q] [-d] [-t min_ms] [-f filter]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (min_ms <= 0) {
+        min_ms = quick ? 2 : 20;
+    }
+    uint64_t min_ns = (uint64_t)min_ms * 1000000ULL;
+
+    static const int all_degrees[] = { 8, 16, 32, 64, 128, 136, 256, 512, 1024, 4096 };
+    static const int quick_degrees[] = { 64, 128, 256 };
+    static const int all_thresholds[] = { 2, 3, 5, 8 };
+    static const int quick_thresholds[] = { 2, 3 };
+    const int *degrees = quick ? quick_degrees : all_degrees;
+    int degree_count = quick ? 3 : (int)(sizeof(all_degrees) / sizeof(int));
+    const int *thresholds = quick ? quick_thresholds : all_thresholds;
+    int threshold_count = quick ? 2 : (int)(sizeof(all_thresholds) / sizeof(int));
+
+    printf("{\n  \"backend\": \"%s\",\n  \"allocations_counted\": %s,\n  \"min_time_ms\": %ld,\n  \"repetitions\": %d,\n  \"results\": [",
+#if defined(SSSS_NO_GMP)
+           "fixed",
+#else
+           "gmp",
+#endif
+           COUNT_ALLOCATIONS ? "true" : "false", min_ms, REPETITIONS);
+
+    if (sweep) {
+        degree_sweep(min_ns, filter);
+        printf("\n  ]\n}\n");
+        return 0;
+    }
+    field_benchmarks(degrees, degree_count, min_ns, filter);
+
+    static share_bench_t sb;
+    for (int d = 0; d < degree_count; ++d) {
+        for (int t = 0; t < threshold_count; ++t) {
+            int numbers[] = { thresholds[t] + 1, 2 * thresholds[t] };
+            for (int n = 0; n < 2; ++n) {
+                for (int diffusion = 0; diffusion < 2; ++diffusion) {
+                    if (diffusion && degrees[d] < 64) {
+                        continue;  // not supported below 64 bits
+                    }
+                    for (int hexmode = 0; hexmode < 2; ++hexmode) {
+                        sb.degree = degrees[d];
+                        sb.threshold = thresholds[t];
+                        sb.number = numbers[n];
+                        sb.diffusion = diffusion;
+                        sb.hexmode = hexmode;
+                        share_benchmark(&sb, min_ns, filter);
+                    }
+                }
+            }
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
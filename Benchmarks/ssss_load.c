@@ -0,0 +1,550 @@
+/*
+ *  replay a trace of splits and combines against the C library
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+// usage: ssss_load [-a sync|batch|async] [-c concurrency] [-x speed] [-b batch]
+//                  [-i interval_ms] [-s seed] trace
+//
+//   -a api         library entry points to drive (default sync)
+//   -c concurrency threads for sync, pool workers for batch and async (default 1)
+//   -x speed       scale the inter-arrival times by 1 / speed, 0 => ignore them (default 1)
+//   -b batch       largest batch the batch driver collects (default 64)
+//   -i interval_ms RSS and throughput sampling interval (default 1000)
+//   -s seed        seed for the secrets and the cprng (default 1)
+//
+// the trace is text, one operation per line, '#' starts a comment:
+//
+//   delay_us op degree threshold number [flags]
+//
+//   delay_us  microseconds after the previous operation arrives
+//   op        split or combine
+//   number    shares split, combine reads threshold of them
+//   flags     d => diffusion, h => hex secret
+//
+// arrivals are open loop: an operation's latency runs from its scheduled
+// arrival, so time spent waiting behind a slow operation is counted;
+// secrets, split randomness and the shares for combines all derive from
+// the seed and the operation's position, so runs are reproducible
+//
+// results are JSON on stdout, like ssss_bench
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "shamir.h"
+
+#define SHARE_SIZE (MAXDEGREE / 4 + 2)
+
+typedef enum {
+    OP_SPLIT,
+    OP_COMBINE
+} op_kind_t;
+
+typedef struct {
+    op_kind_t kind;
+    uint64_t arrival;              // nanoseconds after the start
+    int degree;
+    int threshold;
+    int number;
+    bool diffusion;
+    bool hexmode;
+    uint64_t seed;
+    uint64_t random;               // cprng state
+    cprng_t cprng;
+    char *secret;
+    char **shares;                 // combine: the number shares of a setup split
+    int first;                     // combine: first share read
+    char *result;                  // combine
+    error_t error;
+    uint64_t latency;              // completion - arrival
+} op_t;
+
+static op_t *ops = NULL;
+static size_t op_count = 0;
+static uint64_t start_time = 0;
+static size_t completed = 0;       // atomic
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t deadline) {
+    for (uint64_t t = now_ns(); t < deadline; t = now_ns()) {
+        struct timespec ts = { .tv_sec = (deadline - t) / 1000000000ULL, .tv_nsec = (deadline - t) % 1000000000ULL };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// resident set in KiB, the peak where the current size is not available
+static long rss_kb(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (NULL != f) {
+        long pages = 0, resident = 0;
+        int n = fscanf(f, "%ld %ld", &pages, &resident);
+        fclose(f);
+        if (2 == n) {
+            return resident * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+
+// deterministic cprng (xorshift64*), the state lives in the operation
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static void *random_open(void *argument) {
+    op_t *op = (op_t *)argument;
+    op->random = op->seed | 1;
+    return op;
+}
+
+static int random_close(void *data) {
+    (void)data;
+    return 0;
+}
+
+static ssize_t random_read(void *data, void *buffer, size_t nbytes) {
+    op_t *op = (op_t *)data;
+    uint8_t *b = (uint8_t *)buffer;
+    for (size_t i = 0; i < nbytes; ++i) {
+        b[i] = (uint8_t)(next_random(&op->random) >> 56);
+    }
+    return (ssize_t)nbytes;
+}
+
+
+// operations
+
+static error_t discard_share(void *data, const char *buffer, size_t length, int number, int total) {
+    (void)data, (void)buffer, (void)length, (void)number, (void)total;
+    return ERROR_OK;
+}
+
+static error_t keep_share(void *data, const char *buffer, size_t length, int number, int total) {
+    (void)total;
+    op_t *op = (op_t *)data;
+    op->shares[number - 1] = strndup(buffer, length);
+    return NULL != op->shares[number - 1] ? ERROR_OK : ERROR_MALLOC_FAILED;
+}
+
+static const char *read_share(void *data, int number, int threshold, size_t size) {
+    (void)threshold, (void)size;
+    op_t *op = (op_t *)data;
+    return op->shares[op->first + number - 1];
+}
+
+static error_t prepare(op_t *op, size_t index, uint64_t seed) {
+    op->seed = seed ^ (0x9e3779b97f4a7c15ULL * (index + 1));
+    op->cprng = (cprng_t){ .open = random_open, .close = random_close, .read = random_read, .argument = op };
+    uint64_t state = op->seed | 1;
+    int length = op->degree / (op->hexmode ? 4 : 8);
+    op->secret = (char *)malloc(length + 1);
+    if (NULL == op->secret) {
+        return ERROR_MALLOC_FAILED;
+    }
+    for (int i = 0; i < length; ++i) {
+        uint8_t b = (uint8_t)(next_random(&state) >> 56);
+        op->secret[i] = op->hexmode ? "0123456789abcdef"[b & 15] : (char)('a' + b % 26);
+    }
+    op->secret[length] = '\0';
+    if (OP_SPLIT == op->kind) {
+        return ERROR_OK;
+    }
+    op->shares = (char **)calloc(op->number, sizeof(char *));
+    op->result = (char *)malloc(SHARE_SIZE);
+    if (NULL == op->shares || NULL == op->result) {
+        return ERROR_MALLOC_FAILED;
+    }
+    op->first = (int)(index % (op->number - op->threshold + 1));
+    return split(op->secret, keep_share, op, op->degree, op->threshold, op->number, op->diffusion,
+                 NULL, op->hexmode, &op->cprng);
+}
+
+static void finish(op_t *op, error_t err) {
+    if (ERROR_OK == err && OP_COMBINE == op->kind && 0 != strcmp(op->result, op->secret)) {
+        err = ERROR_SHARES_INCONSISTENT;
+    }
+    op->error = err;
+    op->latency = now_ns() - start_time - op->arrival;
+    __atomic_add_fetch(&completed, 1, __ATOMIC_RELEASE);
+}
+
+static error_t run(op_t *op) {
+    if (OP_SPLIT == op->kind) {
+        return split(op->secret, discard_share, NULL, op->degree, op->threshold, op->number,
+                     op->diffusion, NULL, op->hexmode, &op->cprng);
+    }
+    return combine(op->result, SHARE_SIZE, read_share, op, op->threshold, op->diffusion, op->hexmode);
+}
+
+
+// trace
+
+static bool load_trace(const char *path, double speed) {
+    FILE *f = fopen(path, "r");
+    if (NULL == f) {
+        perror(path);
+        return false;
+    }
+    size_t capacity = 0;
+    double arrival = 0;
+    char line[256];
+    int line_number = 0;
+    while (NULL != fgets(line, sizeof(line), f)) {
+        ++line_number;
+        line[strcspn(line, "#\r\n")] = '\0';
+        double delay;
+        char kind[16], flags[8] = "";
+        int degree, threshold, number;
+        int n = sscanf(line, "%lf %15s %d %d %d %7s", &delay, kind, &degree, &threshold, &number, flags);
+        if (n <= 0) {
+            continue;              // blank or comment
+        }
+        bool is_split = 0 == strcmp(kind, "split");
+        if (n < 5 || (! is_split && 0 != strcmp(kind, "combine")) || delay < 0
+            || degree < 8 || degree > MAXDEGREE || degree % 8 || threshold < 2 || number < threshold) {
+            fprintf(stderr, "%s:%d: invalid operation\n", path, line_number);
+            fclose(f);
+            return false;
+        }
+        if (op_count == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            op_t *grown = (op_t *)realloc(ops, capacity * sizeof(op_t));
+            if (NULL == grown) {
+                fprintf(stderr, "out of memory\n");
+                fclose(f);
+                return false;
+            }
+            ops = grown;
+        }
+        arrival += speed > 0 ? delay * 1000.0 / speed : 0;
+        ops[op_count++] = (op_t){
+            .kind = is_split ? OP_SPLIT : OP_COMBINE,
+            .arrival = (uint64_t)arrival,
+            .degree = degree,
+            .threshold = threshold,
+            .number = number,
+            .diffusion = NULL != strchr(flags, 'd'),
+            .hexmode = NULL != strchr(flags, 'h')
+        };
+    }
+    fclose(f);
+    return true;
+}
+
+
+// sync: each thread takes the next operation, waits for its arrival and runs it
+
+static size_t next_op = 0;         // atomic
+
+static void *sync_thread(void *argument) {
+    (void)argument;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&next_op, 1, __ATOMIC_RELAXED);
+        if (i >= op_count) {
+            return NULL;
+        }
+        sleep_until(start_time + ops[i].arrival);
+        finish(&ops[i], run(&ops[i]));
+    }
+}
+
+static bool drive_sync(int concurrency) {
+    pthread_t threads[concurrency];
+    int started = 0;
+    while (started < concurrency && 0 == pthread_create(&threads[started], NULL, sync_thread, NULL)) {
+        ++started;
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    return started > 0;
+}
+
+
+// batch: collect the operations that have arrived into split_batch and combine_batch
+
+static bool drive_batch(worker_pool_t *pool, int batch) {
+    split_job_t splits[batch];
+    combine_job_t combines[batch];
+    op_t *split_ops[batch], *combine_ops[batch];
+    size_t i = 0;
+    while (i < op_count) {
+        sleep_until(start_time + ops[i].arrival);
+        uint64_t now = now_ns() - start_time;
+        int s = 0, c = 0;
+        for (; i < op_count && s + c < batch && ops[i].arrival <= now; ++i) {
+            op_t *op = &ops[i];
+            if (OP_SPLIT == op->kind) {
+                split_ops[s] = op;
+                splits[s++] = (split_job_t){
+                    .secret = op->secret, .process_share = discard_share, .security = op->degree,
+                    .threshold = op->threshold, .number = op->number, .diffusion = op->diffusion,
+                    .hexmode = op->hexmode, .cprng = &op->cprng
+                };
+            } else {
+                combine_ops[c] = op;
+                combines[c++] = (combine_job_t){
+                    .secret = op->result, .secret_size = SHARE_SIZE, .get_share = read_share, .data = op,
+                    .threshold = op->threshold, .diffusion = op->diffusion, .hexmode = op->hexmode
+                };
+            }
+        }
+        if (s) {
+            split_batch(splits, s, pool);
+        }
+        if (c) {
+            combine_batch(combines, c, pool);
+        }
+        for (int k = 0; k < s; ++k) {
+            finish(split_ops[k], splits[k].error);
+        }
+        for (int k = 0; k < c; ++k) {
+            finish(combine_ops[k], combines[k].error);
+        }
+    }
+    return true;
+}
+
+
+// async: submit at each arrival, completions are recorded on the workers
+
+static void async_done(void *data, const async_completion_t *completion) {
+    (void)data;
+    finish(&ops[completion->user_data], completion->error);
+}
+
+static bool drive_async(worker_pool_t *pool, int concurrency) {
+    async_queue_t *queue = async_queue_create(pool, 4 * concurrency);
+    if (NULL == queue) {
+        return false;
+    }
+    for (size_t i = 0; i < op_count; ++i) {
+        op_t *op = &ops[i];
+        async_submission_t submission = { .user_data = i, .complete = async_done };
+        if (OP_SPLIT == op->kind) {
+            submission.op = ASYNC_SPLIT;
+            submission.job.split = (split_job_t){
+                .secret = op->secret, .process_share = discard_share, .security = op->degree,
+                .threshold = op->threshold, .number = op->number, .diffusion = op->diffusion,
+                .hexmode = op->hexmode, .cprng = &op->cprng
+            };
+        } else {
+            submission.op = ASYNC_COMBINE;
+            submission.job.combine = (combine_job_t){
+                .secret = op->result, .secret_size = SHARE_SIZE, .get_share = read_share, .data = op,
+                .threshold = op->threshold, .diffusion = op->diffusion, .hexmode = op->hexmode
+            };
+        }
+        sleep_until(start_time + op->arrival);
+        async_submit(queue, &submission, -1);
+    }
+    async_queue_destroy(queue);    // runs the remaining jobs
+    return true;
+}
+
+
+// sampling and report
+
+typedef struct {
+    uint64_t interval;
+    bool stop;                     // set once, after the last completion
+    bool first;
+} sampler_t;
+
+static void *sampler_thread(void *argument) {
+    sampler_t *sampler = (sampler_t *)argument;
+    size_t last = 0;
+    uint64_t next = start_time;
+    while (! __atomic_load_n(&sampler->stop, __ATOMIC_ACQUIRE)) {
+        next += sampler->interval;
+        while (now_ns() < next && ! __atomic_load_n(&sampler->stop, __ATOMIC_ACQUIRE)) {
+            uint64_t wait = next - now_ns();
+            struct timespec ts = { .tv_sec = 0, .tv_nsec = wait < 10000000 ? (long)wait : 10000000 };
+            nanosleep(&ts, NULL);
+        }
+        size_t done = __atomic_load_n(&completed, __ATOMIC_ACQUIRE);
+        uint64_t t = now_ns() - start_time;
+        printf("%s\n    {\"t_ms\": %.1f, \"completed\": %zu, \"ops_per_sec\": %.1f, \"rss_kb\": %ld}",
+               sampler->first ? "" : ",", (double)t / 1e6, done,
+               (double)(done - last) * 1e9 / (double)sampler->interval, rss_kb());
+        sampler->first = false;
+        fflush(stdout);
+        last = done;
+    }
+    return NULL;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// nearest rank percentile of a sorted array
+static uint64_t percentile(const uint64_t *sorted, size_t n, double p) {
+    if (0 == n) {
+        return 0;
+    }
+    size_t rank = (size_t)(p / 100.0 * (double)n + 0.999999);
+    return sorted[(rank ? rank : 1) - 1];
+}
+
+static void report_latency(const char *name, int kind, bool last) {
+    uint64_t *latency = (uint64_t *)malloc((op_count ? op_count : 1) * sizeof(uint64_t));
+    size_t n = 0;
+    for (size_t i = 0; NULL != latency && i < op_count; ++i) {
+        if (kind < 0 || (int)ops[i].kind == kind) {
+            latency[n++] = ops[i].latency;
+        }
+    }
+    if (NULL != latency) {
+        qsort(latency, n, sizeof(uint64_t), compare_u64);
+    }
+    printf("    \"%s\": {\"count\": %zu, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}%s\n",
+           name, n, (unsigned long long)percentile(latency, n, 50), (unsigned long long)percentile(latency, n, 99),
+           (unsigned long long)percentile(latency, n, 99.9), (unsigned long long)(n ? latency[n - 1] : 0),
+           last ? "" : ",");
+    free(latency);
+}
+
+int main(int argc, char *argv[]) {
+    const char *api = "sync";
+    int concurrency = 1;
+    double speed = 1.0;
+    int batch = 64;
+    long interval_ms = 1000;
+    uint64_t seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:c:x:b:i:s:")) != -1) {
+        switch (opt) {
+            case 'a':
+                api = optarg;
+                break;
+            case 'c':
+                concurrency = atoi(optarg);
+                break;
+            case 'x':
+                speed = atof(optarg);
+                break;
+            case 'b':
+                batch = atoi(optarg);
+                break;
+            case 'i':
+                interval_ms = atol(optarg);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    bool known = 0 == strcmp(api, "sync") || 0 == strcmp(api, "batch") || 0 == strcmp(api, "async");
+    if (optind != argc - 1 || ! known || concurrency < 1 || batch < 1 || interval_ms < 1 || speed < 0) {
+        fprintf(stderr, "usage: %s [-a sync|batch|async] [-c concurrency] [-x speed] [-b batch] [-i interval_ms] [-s seed] trace\n", argv[0]);
+        return 1;
+    }
+    if (! load_trace(argv[optind], speed)) {
+        return 1;
+    }
+    for (size_t i = 0; i < op_count; ++i) {
+        error_t err = prepare(&ops[i], i, seed);
+        if (ERROR_OK != err) {
+            fprintf(stderr, "operation %zu: setup failed, error %d\n", i + 1, err);
+            return 1;
+        }
+    }
+
+    worker_pool_t *pool = NULL;
+    if (0 != strcmp(api, "sync")) {
+        pool_config_t config = { .workers = concurrency };
+        pool = worker_pool_create(&config);
+        if (NULL == pool) {
+            fprintf(stderr, "cannot create the worker pool\n");
+            return 1;
+        }
+    }
+
+    printf("{\n  \"trace\": \"%s\",\n  \"api\": \"%s\",\n  \"concurrency\": %d,\n  \"speed\": %g,\n  \"seed\": %llu,\n"
+           "  \"operations\": %zu,\n  \"rss_kb_before\": %ld,\n  \"timeline\": [",
+           argv[optind], api, concurrency, speed, (unsigned long long)seed, op_count, rss_kb());
+    fflush(stdout);
+
+    sampler_t sampler = { .interval = (uint64_t)interval_ms * 1000000ULL, .stop = false, .first = true };
+    pthread_t sampling;
+    start_time = now_ns();
+    bool sampling_started = 0 == pthread_create(&sampling, NULL, sampler_thread, &sampler);
+
+    bool ok;
+    if (0 == strcmp(api, "sync")) {
+        ok = drive_sync(concurrency);
+    } else if (0 == strcmp(api, "batch")) {
+        ok = drive_batch(pool, batch);
+    } else {
+        ok = drive_async(pool, concurrency);
+    }
+    while (ok && __atomic_load_n(&completed, __ATOMIC_ACQUIRE) < op_count) {
+        sleep_until(now_ns() + 1000000);
+    }
+    uint64_t elapsed = now_ns() - start_time;
+    __atomic_store_n(&sampler.stop, true, __ATOMIC_RELEASE);
+    if (sampling_started) {
+        pthread_join(sampling, NULL);
+    }
+
+    size_t errors = 0;
+    for (size_t i = 0; i < op_count; ++i) {
+        errors += ERROR_OK != ops[i].error;
+    }
+    printf("\n  ],\n  \"completed\": %s,\n  \"errors\": %zu,\n  \"elapsed_ms\": %.1f,\n  \"ops_per_sec\": %.1f,\n"
+           "  \"rss_kb_after\": %ld,\n  \"latency_ns\": {\n",
+           ok ? "true" : "false", errors, (double)elapsed / 1e6,
+           elapsed ? (double)op_count * 1e9 / (double)elapsed : 0.0, rss_kb());
+    report_latency("all", -1, false);
+    report_latency("split", OP_SPLIT, false);
+    report_latency("combine", OP_COMBINE, true);
+    printf("  }\n}\n");
+
+    if (NULL != pool) {
+        worker_pool_destroy(pool);
+    }
+    return ok && 0 == errors ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+/*
+ *  ChaCha20-Poly1305 authenticated encryption (RFC 8439)
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <string.h>
+
+#include "aead.h"
+
+// portable C with no library to depend on, as mpz_fixed.h; Poly1305 is
+// done on 26 bit limbs so that it needs no 128 bit products
+
+static inline uint32_t load32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void store32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void store64(uint8_t *p, uint64_t v) {
+    store32(p, (uint32_t)v);
+    store32(p + 4, (uint32_t)(v >> 32));
+}
+
+
+// ChaCha20
+// ========
+
+#define ROTL32(v, n) ((v) << (n) | (v) >> (32 - (n)))
+
+#define QUARTER(a, b, c, d)                          \
+    do {                                             \
+        a += b; d ^= a; d = ROTL32(d, 16);           \
+        c += d; b ^= c; b = ROTL32(b, 12);           \
+        a += b; d ^= a; d = ROTL32(d, 8);            \
+        c += d; b ^= c; b = ROTL32(b, 7);            \
+    } while (0)
+
+typedef struct {
+    uint32_t state[16];
+} chacha_t;
+
+static void chacha_init(chacha_t *ctx, const uint8_t key[AEAD_KEY_SIZE], const uint8_t nonce[AEAD_NONCE_SIZE], uint32_t counter) {
+    ctx->state[0] = 0x61707865;    // "expand 32-byte k"
+    ctx->state[1] = 0x3320646e;
+    ctx->state[2] = 0x79622d32;
+    ctx->state[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) {
+        ctx->state[4 + i] = load32(key + 4 * i);
+    }
+    ctx->state[12] = counter;
+    for (int i = 0; i < 3; ++i) {
+        ctx->state[13 + i] = load32(nonce + 4 * i);
+    }
+}
+
+// the next 64 bytes of key stream as words
+static void chacha_words(chacha_t *ctx, uint32_t x[16]) {
+    memcpy(x, ctx->state, sizeof(uint32_t) * 16);
+    for (int i = 0; i < 10; ++i) {
+        QUARTER(x[0], x[4], x[8], x[12]);
+        QUARTER(x[1], x[5], x[9], x[13]);
+        QUARTER(x[2], x[6], x[10], x[14]);
+        QUARTER(x[3], x[7], x[11], x[15]);
+        QUARTER(x[0], x[5], x[10], x[15]);
+        QUARTER(x[1], x[6], x[11], x[12]);
+        QUARTER(x[2], x[7], x[8], x[13]);
+        QUARTER(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        x[i] += ctx->state[i];
+    }
+    ++ctx->state[12];
+}
+
+static void chacha_block(chacha_t *ctx, uint8_t out[64]) {
+    uint32_t x[16];
+    chacha_words(ctx, x);
+    for (int i = 0; i < 16; ++i) {
+        store32(out + 4 * i, x[i]);
+    }
+    memset(x, 0, sizeof(x));
+}
+
+#if defined(__GNUC__)
+
+// four blocks at once, lane b of every word belonging to block b; the
+// vector extensions give SSE2 or NEON code without per-CPU variants
+typedef uint32_t chacha_v4 __attribute__((vector_size(16)));
+
+#define ROTV(v, n) ((v) << (n) | (v) >> (32 - (n)))
+
+#define QUARTERV(a, b, c, d)                         \
+    do {                                             \
+        a += b; d ^= a; d = ROTV(d, 16);             \
+        c += d; b ^= c; b = ROTV(b, 12);             \
+        a += b; d ^= a; d = ROTV(d, 8);              \
+        c += d; b ^= c; b = ROTV(b, 7);              \
+    } while (0)
+
+static void chacha_xor4(chacha_t *ctx, uint8_t *out, const uint8_t *in) {
+    chacha_v4 s[16], x[16];
+    for (int i = 0; i < 16; ++i) {
+        s[i] = (chacha_v4){ ctx->state[i], ctx->state[i], ctx->state[i], ctx->state[i] };
+    }
+    s[12] += (chacha_v4){ 0, 1, 2, 3 };
+    memcpy(x, s, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        QUARTERV(x[0], x[4], x[8], x[12]);
+        QUARTERV(x[1], x[5], x[9], x[13]);
+        QUARTERV(x[2], x[6], x[10], x[14]);
+        QUARTERV(x[3], x[7], x[11], x[15]);
+        QUARTERV(x[0], x[5], x[10], x[15]);
+        QUARTERV(x[1], x[6], x[11], x[12]);
+        QUARTERV(x[2], x[7], x[8], x[13]);
+        QUARTERV(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        x[i] += s[i];
+    }
+    for (int b = 0; b < 4; ++b) {
+        for (int i = 0; i < 16; ++i) {
+            store32(out + 64 * b + 4 * i, load32(in + 64 * b + 4 * i) ^ x[i][b]);
+        }
+    }
+    ctx->state[12] += 4;
+    memset(x, 0, sizeof(x));
+}
+
+#endif
+
+// whole blocks a word at a time, the loads and stores compile to single moves
+static void chacha_xor(chacha_t *ctx, uint8_t *out, const uint8_t *in, size_t length) {
+    uint32_t x[16];
+#if defined(__GNUC__)
+    for (; length >= 256; length -= 256, in += 256, out += 256) {
+        chacha_xor4(ctx, out, in);
+    }
+#endif
+    for (; length >= 64; length -= 64, in += 64, out += 64) {
+        chacha_words(ctx, x);
+        for (int i = 0; i < 16; ++i) {
+            store32(out + 4 * i, load32(in + 4 * i) ^ x[i]);
+        }
+    }
+    if (0 != length) {
+        uint8_t stream[64];
+        chacha_block(ctx, stream);
+        for (size_t i = 0; i < length; ++i) {
+            out[i] = in[i] ^ stream[i];
+        }
+        memset(stream, 0, sizeof(stream));
+    }
+    memset(x, 0, sizeof(x));
+}
+
+
+// Poly1305
+// ========
+
+typedef struct {
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+} poly1305_t;
+
+static void poly1305_init(poly1305_t *ctx, const uint8_t key[32]) {
+    // r is clamped
+    ctx->r[0] = load32(key + 0) & 0x3ffffff;
+    ctx->r[1] = (load32(key + 3) >> 2) & 0x3ffff03;
+    ctx->r[2] = (load32(key + 6) >> 4) & 0x3ffc0ff;
+    ctx->r[3] = (load32(key + 9) >> 6) & 0x3f03fff;
+    ctx->r[4] = (load32(key + 12) >> 8) & 0x00fffff;
+    memset(ctx->h, 0, sizeof(ctx->h));
+    for (int i = 0; i < 4; ++i) {
+        ctx->pad[i] = load32(key + 16 + 4 * i);
+    }
+}
+
+// whole 16 byte blocks
+static void poly1305_blocks(poly1305_t *ctx, const uint8_t *m, size_t blocks) {
+    const uint32_t r0 = ctx->r[0], r1 = ctx->r[1], r2 = ctx->r[2], r3 = ctx->r[3], r4 = ctx->r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2], h3 = ctx->h[3], h4 = ctx->h[4];
+
+    for (; 0 != blocks; --blocks, m += 16) {
+        // h += m, with the 2^128 bit
+        h0 += load32(m + 0) & 0x3ffffff;
+        h1 += (load32(m + 3) >> 2) & 0x3ffffff;
+        h2 += (load32(m + 6) >> 4) & 0x3ffffff;
+        h3 += (load32(m + 9) >> 6) & 0x3ffffff;
+        h4 += (load32(m + 12) >> 8) | (1 << 24);
+
+        // h *= r mod 2^130 - 5
+        uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        uint32_t c = (uint32_t)(d0 >> 26);
+        h0 = (uint32_t)d0 & 0x3ffffff;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+    }
+
+    ctx->h[0] = h0;
+    ctx->h[1] = h1;
+    ctx->h[2] = h2;
+    ctx->h[3] = h3;
+    ctx->h[4] = h4;
+}
+
+// m zero padded to a multiple of 16 bytes, as the AEAD construction does
+static void poly1305_padded(poly1305_t *ctx, const uint8_t *m, size_t length) {
+    poly1305_blocks(ctx, m, length / 16);
+    size_t rest = length % 16;
+    if (0 != rest) {
+        uint8_t block[16] = { 0 };
+        memcpy(block, m + length - rest, rest);
+        poly1305_blocks(ctx, block, 1);
+    }
+}
+
+static void poly1305_finish(poly1305_t *ctx, uint8_t tag[AEAD_TAG_SIZE]) {
+    uint32_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2], h3 = ctx->h[3], h4 = ctx->h[4];
+
+    // carry fully
+    uint32_t c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    // g = h + 5 - 2^130, taken in constant time when not negative
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1 << 26);
+
+    uint32_t mask = (g4 >> 31) - 1;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    // h + pad mod 2^128
+    uint64_t f;
+    f = (uint64_t)(h0 | h1 << 26) + ctx->pad[0];               store32(tag + 0, (uint32_t)f);
+    f = (uint64_t)(h1 >> 6 | h2 << 20) + ctx->pad[1] + (f >> 32);  store32(tag + 4, (uint32_t)f);
+    f = (uint64_t)(h2 >> 12 | h3 << 14) + ctx->pad[2] + (f >> 32); store32(tag + 8, (uint32_t)f);
+    f = (uint64_t)(h3 >> 18 | h4 << 8) + ctx->pad[3] + (f >> 32);  store32(tag + 12, (uint32_t)f);
+
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+
+// AEAD
+// ====
+
+static void aead_tag(uint8_t tag[AEAD_TAG_SIZE], const uint8_t *c, size_t length,
+                     const uint8_t *ad, size_t ad_length,
+                     const uint8_t key[AEAD_KEY_SIZE], const uint8_t nonce[AEAD_NONCE_SIZE]) {
+    // the one time Poly1305 key is the first half of block zero
+    chacha_t chacha;
+    uint8_t block[64];
+    chacha_init(&chacha, key, nonce, 0);
+    chacha_block(&chacha, block);
+
+    poly1305_t poly;
+    poly1305_init(&poly, block);
+    poly1305_padded(&poly, ad, ad_length);
+    poly1305_padded(&poly, c, length);
+    uint8_t lengths[16];
+    store64(lengths, ad_length);
+    store64(lengths + 8, length);
+    poly1305_blocks(&poly, lengths, 1);
+    poly1305_finish(&poly, tag);
+
+    memset(block, 0, sizeof(block));
+    memset(&chacha, 0, sizeof(chacha));
+}
+
+void aead_encrypt(uint8_t *out, uint8_t tag[AEAD_TAG_SIZE],
+                  const uint8_t *in, size_t length,
+                  const uint8_t *ad, size_t ad_length,
+                  const uint8_t key[AEAD_KEY_SIZE], const uint8_t nonce[AEAD_NONCE_SIZE]) {
+    chacha_t chacha;
+    chacha_init(&chacha, key, nonce, 1);
+    chacha_xor(&chacha, out, in, length);
+    memset(&chacha, 0, sizeof(chacha));
+    aead_tag(tag, out, length, ad, ad_length, key, nonce);
+}
+
+bool aead_decrypt(uint8_t *out, const uint8_t *in, size_t length,
+                  const uint8_t tag[AEAD_TAG_SIZE],
+                  const uint8_t *ad, size_t ad_length,
+                  const uint8_t key[AEAD_KEY_SIZE], const uint8_t nonce[AEAD_NONCE_SIZE]) {
+    uint8_t expected[AEAD_TAG_SIZE];
+    aead_tag(expected, in, length, ad, ad_length, key, nonce);
+    uint8_t diff = 0;
+    for (int i = 0; i < AEAD_TAG_SIZE; ++i) {
+        diff |= expected[i] ^ tag[i];
+    }
+    if (0 != diff) {
+        return false;
+    }
+    chacha_t chacha;
+    chacha_init(&chacha, key, nonce, 1);
+    chacha_xor(&chacha, out, in, length);
+    memset(&chacha, 0, sizeof(chacha));
+    return true;
+}
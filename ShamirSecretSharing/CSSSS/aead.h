@@ -0,0 +1,43 @@
+/*
+ *  ChaCha20-Poly1305 authenticated encryption (RFC 8439)
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_AEAD_H_)
+#define _AEAD_H_ 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define AEAD_KEY_SIZE 32
+#define AEAD_NONCE_SIZE 12
+#define AEAD_TAG_SIZE 16
+
+// out may be in
+void aead_encrypt(uint8_t *out, uint8_t tag[AEAD_TAG_SIZE],
+                  const uint8_t *in, size_t length,
+                  const uint8_t *ad, size_t ad_length,
+                  const uint8_t key[AEAD_KEY_SIZE], const uint8_t nonce[AEAD_NONCE_SIZE]);
+
+// false => tag does not match and out is untouched
+bool aead_decrypt(uint8_t *out, const uint8_t *in, size_t length,
+                  const uint8_t tag[AEAD_TAG_SIZE],
+                  const uint8_t *ad, size_t ad_length,
+                  const uint8_t key[AEAD_KEY_SIZE], const uint8_t nonce[AEAD_NONCE_SIZE]);
+
+#endif
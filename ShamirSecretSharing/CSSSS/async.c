@@ -0,0 +1,294 @@
+/*
+ *  asynchronous submission/completion queues for split and combine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+#include "shamir.h"
+#include "pool.h"
+
+// every submission is handed to the worker pool as a task of its own,
+// which runs the oldest job in the submission ring and posts its
+// completion as soon as it finishes, so short jobs are not held back by
+// long ones
+struct async_queue {
+    worker_pool_t *pool;
+    unsigned int entries;
+
+    pthread_mutex_t lock;            // protects everything below
+    pthread_cond_t drained;          // destroy waits for the tasks
+    pthread_cond_t space;            // submitters wait for space
+    pthread_cond_t completed;        // reapers wait for completions
+
+    async_submission_t *sq;          // submission ring
+    unsigned int sq_head;
+    unsigned int sq_count;
+    async_completion_t *cq;          // completion ring
+    unsigned int cq_head;
+    unsigned int cq_count;
+    unsigned int in_flight;          // submitted and not yet reaped
+    unsigned int tasks;              // handed to the pool and not yet finished
+
+    int fd[2];                       // read and write ends of the notification
+};
+
+static void notify(async_queue_t *queue) {
+#if defined(__linux__)
+    uint64_t one = 1;
+    ssize_t n = write(queue->fd[1], &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t n = write(queue->fd[1], &one, sizeof(one));  // if the pipe is full the reader is already due to wake
+#endif
+    (void)n;
+}
+
+static void clear_notification(async_queue_t *queue) {
+    char buffer[64];
+    while (read(queue->fd[0], buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+// the task is done with the queue
+static void task_finished(async_queue_t *queue) {
+    if (0 == --queue->tasks) {
+        pthread_cond_broadcast(&queue->drained);
+    }
+}
+
+static void async_item(void *context, size_t index, int worker) {
+    (void)index;
+    (void)worker;
+    async_queue_t *queue = (async_queue_t *)context;
+
+    // one task per submission, so there is always one to take
+    pthread_mutex_lock(&queue->lock);
+    async_submission_t submission = queue->sq[queue->sq_head];
+    queue->sq_head = (queue->sq_head + 1) % queue->entries;
+    --queue->sq_count;
+    pthread_mutex_unlock(&queue->lock);
+
+    async_completion_t completion = {
+        .op = submission.op,
+        .user_data = submission.user_data
+    };
+    if (ASYNC_SPLIT == submission.op) {
+        split_job_t *job = &submission.job.split;
+        completion.error = split(job->secret, job->process_share, job->data,
+                                 job->security, job->threshold, job->number, job->diffusion,
+                                 job->prefix, job->hexmode, job->cprng);
+    } else {
+        combine_job_t *job = &submission.job.combine;
+        completion.error = combine(job->secret, job->secret_size, job->get_share, job->data,
+                                   job->threshold, job->diffusion, job->hexmode);
+    }
+
+    if (NULL != submission.complete) {
+        async_complete_t *complete = submission.complete;
+        void *complete_data = submission.complete_data;
+        pthread_mutex_lock(&queue->lock);
+        --queue->in_flight;
+        pthread_cond_broadcast(&queue->space);
+        pthread_mutex_unlock(&queue->lock);
+        complete(complete_data, &completion);
+        pthread_mutex_lock(&queue->lock);
+        task_finished(queue);
+        pthread_mutex_unlock(&queue->lock);
+        return;
+    }
+
+    // in_flight bounds the completions too, so there is always a free slot
+    pthread_mutex_lock(&queue->lock);
+    queue->cq[(queue->cq_head + queue->cq_count) % queue->entries] = completion;
+    ++queue->cq_count;
+    pthread_cond_broadcast(&queue->completed);
+    notify(queue);
+    task_finished(queue);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static bool open_notification(async_queue_t *queue) {
+#if defined(__linux__)
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    queue->fd[0] = queue->fd[1] = fd;
+    return fd >= 0;
+#else
+    if (pipe(queue->fd) < 0) {
+        return false;
+    }
+    for (int i = 0; i < 2; ++i) {
+        fcntl(queue->fd[i], F_SETFL, fcntl(queue->fd[i], F_GETFL) | O_NONBLOCK);
+        fcntl(queue->fd[i], F_SETFD, FD_CLOEXEC);
+    }
+    return true;
+#endif
+}
+
+static void close_notification(async_queue_t *queue) {
+    close(queue->fd[0]);
+    if (queue->fd[1] != queue->fd[0]) {
+        close(queue->fd[1]);
+    }
+}
+
+async_queue_t *async_queue_create(worker_pool_t *pool, unsigned int entries) {
+    if (NULL == pool || 0 == entries) {
+        return NULL;
+    }
+    async_queue_t *queue = (async_queue_t *)malloc(sizeof(async_queue_t));
+    if (NULL == queue) {
+        return NULL;
+    }
+    memset(queue, 0, sizeof(async_queue_t));
+    queue->pool = pool;
+    queue->entries = entries;
+    queue->sq = (async_submission_t *)calloc(entries, sizeof(async_submission_t));
+    queue->cq = (async_completion_t *)calloc(entries, sizeof(async_completion_t));
+    if (NULL == queue->sq || NULL == queue->cq || !open_notification(queue)) {
+        free(queue->sq);
+        free(queue->cq);
+        free(queue);
+        return NULL;
+    }
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->drained, NULL);
+    pthread_cond_init(&queue->space, NULL);
+    pthread_cond_init(&queue->completed, NULL);
+    return queue;
+}
+
+void async_queue_destroy(async_queue_t *queue) {
+    if (NULL == queue) {
+        return;
+    }
+    pthread_mutex_lock(&queue->lock);
+    while (queue->tasks > 0) {
+        pthread_cond_wait(&queue->drained, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    pthread_cond_destroy(&queue->completed);
+    pthread_cond_destroy(&queue->space);
+    pthread_cond_destroy(&queue->drained);
+    pthread_mutex_destroy(&queue->lock);
+    close_notification(queue);
+    free(queue->sq);
+    free(queue->cq);
+    free(queue);
+}
+
+// absolute deadline for pthread_cond_timedwait
+static struct timespec deadline(int timeout_ms) {
+    if (timeout_ms < 0) {
+        timeout_ms = 0;  // not used
+    }
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    struct timespec ts = {
+        .tv_sec = now.tv_sec + timeout_ms / 1000,
+        .tv_nsec = now.tv_usec * 1000L + (timeout_ms % 1000) * 1000000L
+    };
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec += 1;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+// one wait for the condition, false once the timeout has passed
+static bool wait_once(pthread_cond_t *cond, pthread_mutex_t *lock, const struct timespec *until, int timeout_ms) {
+    if (0 == timeout_ms) {
+        return false;
+    }
+    if (timeout_ms < 0) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return ETIMEDOUT != pthread_cond_timedwait(cond, lock, until);
+}
+
+error_t async_submit(async_queue_t *queue, const async_submission_t *submission, int timeout_ms) {
+    if (NULL == queue || NULL == submission) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    struct timespec until = deadline(timeout_ms);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->in_flight >= queue->entries) {
+        if (!wait_once(&queue->space, &queue->lock, &until, timeout_ms)) {
+            pthread_mutex_unlock(&queue->lock);
+            return ERROR_QUEUE_FULL;
+        }
+    }
+    // the task cannot take the job before the lock is released
+    if (!worker_pool_submit(queue->pool, async_item, queue, 0)) {
+        pthread_mutex_unlock(&queue->lock);
+        return ERROR_MALLOC_FAILED;
+    }
+    queue->sq[(queue->sq_head + queue->sq_count) % queue->entries] = *submission;
+    ++queue->sq_count;
+    ++queue->in_flight;
+    ++queue->tasks;
+    pthread_mutex_unlock(&queue->lock);
+    return ERROR_OK;
+}
+
+unsigned int async_reap(async_queue_t *queue, async_completion_t *completions, unsigned int max, int timeout_ms) {
+    if (NULL == queue || NULL == completions || 0 == max) {
+        return 0;
+    }
+    clear_notification(queue);  // before harvesting, so a later completion notifies again
+
+    struct timespec until = deadline(timeout_ms);
+    pthread_mutex_lock(&queue->lock);
+    while (0 == queue->cq_count && wait_once(&queue->completed, &queue->lock, &until, timeout_ms)) {
+    }
+    unsigned int n = 0;
+    if (queue->cq_count > 0) {
+        for (; n < max && queue->cq_count > 0; ++n) {
+            completions[n] = queue->cq[queue->cq_head];
+            queue->cq_head = (queue->cq_head + 1) % queue->entries;
+            --queue->cq_count;
+        }
+        queue->in_flight -= n;
+        if (n > 0) {
+            pthread_cond_broadcast(&queue->space);
+        }
+        if (queue->cq_count > 0) {
+            notify(queue);          // the caller stopped at max, keep the fd readable
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return n;
+}
+
+int async_queue_fd(const async_queue_t *queue) {
+    return NULL == queue ? -1 : queue->fd[0];
+}
@@ -0,0 +1,855 @@
+/*
+ *  share bundles: one holder's shares of many secrets in one file
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shamir.h"
+#include "field.h"
+#include "pool.h"
+#include "histogram.h"
+
+// layout, all integers little endian:
+//
+//   header   64 bytes: magic, version, count, index offset, end of the records
+//   records  id (8), number (2), value bytes (2), value; packed, in the
+//            order they were appended
+//   index    count (id, record offset) pairs of 8 byte integers, sorted by
+//            id, 8 byte aligned, the last thing in the file
+//
+// records are only ever appended; the index and then the header are
+// written when the writer is closed, so until then the file either reads
+// as it was before (appending to a bundle) or not at all (a new one).
+// An append after reopening starts past the old index, which is left as
+// dead space among the records; a record for an id already in the
+// bundle replaces the older one
+
+#define BUNDLE_MAGIC "SSSSBNDL"
+#define BUNDLE_HEADER_SIZE 64
+#define BUNDLE_RECORD_HEADER 12
+#define BUNDLE_INDEX_ENTRY 16
+#define BUNDLE_BUFFER_SIZE (64 * 1024)
+
+static inline uint64_t load64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static inline void store64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline unsigned load16(const uint8_t *p) {
+    return p[0] | (unsigned)p[1] << 8;
+}
+
+static inline void store16(uint8_t *p, unsigned v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+typedef struct {
+    uint64_t count;
+    uint64_t index;                // offset of the index, 0 => not finished
+    uint64_t end;                  // end of the records
+} bundle_header_t;
+
+static void header_encode(uint8_t buffer[BUNDLE_HEADER_SIZE], const bundle_header_t *h) {
+    memset(buffer, 0, BUNDLE_HEADER_SIZE);
+    memcpy(buffer, BUNDLE_MAGIC, 8);
+    store64(buffer + 8, BUNDLE_VERSION);
+    store64(buffer + 16, h->count);
+    store64(buffer + 24, h->index);
+    store64(buffer + 32, h->end);
+}
+
+// a finished bundle in a file of size bytes; anything after the index is
+// left from an append that never finished and is ignored
+static bool header_decode(bundle_header_t *h, const uint8_t buffer[BUNDLE_HEADER_SIZE], uint64_t size) {
+    if (0 != memcmp(buffer, BUNDLE_MAGIC, 8) || BUNDLE_VERSION != load64(buffer + 8)) {
+        return false;
+    }
+    h->count = load64(buffer + 16);
+    h->index = load64(buffer + 24);
+    h->end = load64(buffer + 32);
+    return h->index >= BUNDLE_HEADER_SIZE && 0 == h->index % 8 && h->index <= size
+        && h->end >= BUNDLE_HEADER_SIZE && h->end <= h->index
+        && h->count <= (size - h->index) / BUNDLE_INDEX_ENTRY;
+}
+
+static bool value_length_valid(size_t length) {
+    return length <= MAXDEGREE / 8 && field_size_valid(8 * (int)length);
+}
+
+
+// reading
+// =======
+
+struct bundle {
+    int fd;
+    const uint8_t *map;
+    size_t size;
+    bundle_header_t header;
+};
+
+bundle_t *bundle_open(const char *path) {
+    bundle_t *b = calloc(1, sizeof(bundle_t));
+    if (NULL == b || NULL == path) {
+        free(b);
+        return NULL;
+    }
+    b->fd = open(path, O_RDONLY);
+    struct stat st;
+    if (b->fd < 0 || 0 != fstat(b->fd, &st) || st.st_size < BUNDLE_HEADER_SIZE) {
+        goto failed;
+    }
+    b->size = (size_t)st.st_size;
+    void *p = mmap(NULL, b->size, PROT_READ, MAP_SHARED, b->fd, 0);
+    if (MAP_FAILED == p) {
+        goto failed;
+    }
+    b->map = p;
+    if (! header_decode(&b->header, b->map, b->size)) {
+        goto failed;
+    }
+    // lookups binary search, so the ids must be strictly increasing
+    const uint8_t *index = b->map + b->header.index;
+    for (uint64_t i = 1; i < b->header.count; i++) {
+        if (load64(index + (i - 1) * BUNDLE_INDEX_ENTRY) >= load64(index + i * BUNDLE_INDEX_ENTRY)) {
+            goto failed;
+        }
+    }
+    return b;
+
+failed:
+    bundle_close(b);
+    return NULL;
+}
+
+void bundle_close(bundle_t *bundle) {
+    if (NULL == bundle) {
+        return;
+    }
+    if (NULL != bundle->map) {
+        munmap((void *)bundle->map, bundle->size);
+    }
+    if (bundle->fd >= 0) {
+        close(bundle->fd);
+    }
+    free(bundle);
+}
+
+size_t bundle_count(const bundle_t *bundle) {
+    return NULL == bundle ? 0 : (size_t)bundle->header.count;
+}
+
+error_t bundle_entry(const bundle_t *bundle, size_t index, bundle_share_t *share) {
+    if (NULL == bundle || NULL == share) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (index >= bundle->header.count) {
+        return ERROR_INVALID_SHARE;
+    }
+    const uint8_t *entry = bundle->map + bundle->header.index + index * BUNDLE_INDEX_ENTRY;
+    uint64_t id = load64(entry);
+    uint64_t offset = load64(entry + 8);
+    if (offset < BUNDLE_HEADER_SIZE || offset > bundle->header.end - BUNDLE_RECORD_HEADER) {
+        return ERROR_INVALID_SHARE;
+    }
+    const uint8_t *record = bundle->map + offset;
+    size_t length = load16(record + 10);
+    if (load64(record) != id || ! value_length_valid(length)
+        || length > bundle->header.end - offset - BUNDLE_RECORD_HEADER) {
+        return ERROR_INVALID_SHARE;
+    }
+    share->id = id;
+    share->number = (int)load16(record + 8);
+    share->length = length;
+    share->value = record + BUNDLE_RECORD_HEADER;
+    return ERROR_OK;
+}
+
+size_t bundle_search(const bundle_t *bundle, uint64_t id) {
+    size_t low = 0, high = bundle_count(bundle);
+    const uint8_t *index = NULL == bundle ? NULL : bundle->map + bundle->header.index;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (load64(index + middle * BUNDLE_INDEX_ENTRY) < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+error_t bundle_find(const bundle_t *bundle, uint64_t id, bundle_share_t *share) {
+    if (NULL == bundle || NULL == share) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    size_t i = bundle_search(bundle, id);
+    if (i >= bundle->header.count || load64(bundle->map + bundle->header.index + i * BUNDLE_INDEX_ENTRY) != id) {
+        return ERROR_INVALID_SHARE;
+    }
+    return bundle_entry(bundle, i, share);
+}
+
+error_t bundle_print_share(char *buffer, size_t size, const bundle_share_t *share) {
+    if (NULL == buffer || NULL == share) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    int n = snprintf(buffer, size, "%d-", share->number);
+    if (n < 0 || (size_t)n + 2 * share->length + 1 > size) {
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+    for (size_t i = 0; i < share->length; i++) {
+        buffer[n + 2 * i] = "0123456789abcdef"[share->value[i] >> 4];
+        buffer[n + 2 * i + 1] = "0123456789abcdef"[share->value[i] & 15];
+    }
+    buffer[n + 2 * share->length] = '\0';
+    return ERROR_OK;
+}
+
+
+// writing
+// =======
+
+typedef struct {
+    uint64_t id;
+    uint64_t offset;
+} index_entry_t;
+
+struct bundle_writer {
+    pthread_mutex_t lock;
+    int fd;
+    uint64_t position;             // file offset of buffer[0]
+    size_t used;
+    uint8_t buffer[BUNDLE_BUFFER_SIZE];
+    index_entry_t *index;
+    size_t count;
+    size_t capacity;
+    uint64_t previous_index;       // the header's when reopened, 0 => new
+    error_t error;                 // first failure, returned by every later call
+};
+
+static bool write_all(int fd, const uint8_t *buffer, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pwrite(fd, buffer, length, (off_t)offset);
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buffer += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, uint8_t *buffer, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pread(fd, buffer, length, (off_t)offset);
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buffer += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+static bool index_reserve(bundle_writer_t *w, size_t count) {
+    if (count <= w->capacity) {
+        return true;
+    }
+    size_t capacity = w->capacity ? w->capacity : 1024;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    index_entry_t *index = realloc(w->index, capacity * sizeof(index_entry_t));
+    if (NULL == index) {
+        return false;
+    }
+    w->index = index;
+    w->capacity = capacity;
+    return true;
+}
+
+// the index of an existing bundle, the new records go after it
+static error_t writer_reopen(bundle_writer_t *w) {
+    struct stat st;
+    uint8_t h[BUNDLE_HEADER_SIZE];
+    bundle_header_t header;
+    if (0 != fstat(w->fd, &st)) {
+        return ERROR_CANNOT_READ_INPUT;
+    }
+    if (0 == st.st_size) {
+        return ERROR_OK;               // new
+    }
+    if (st.st_size < BUNDLE_HEADER_SIZE || ! read_all(w->fd, h, sizeof(h), 0)
+        || ! header_decode(&header, h, (uint64_t)st.st_size)) {
+        return ERROR_INVALID_SYNTAX;
+    }
+    if (! index_reserve(w, (size_t)header.count)) {
+        return ERROR_MALLOC_FAILED;
+    }
+    uint8_t entry[BUNDLE_INDEX_ENTRY];
+    for (uint64_t i = 0; i < header.count; i++) {
+        if (! read_all(w->fd, entry, sizeof(entry), header.index + i * BUNDLE_INDEX_ENTRY)) {
+            return ERROR_CANNOT_READ_INPUT;
+        }
+        w->index[i].id = load64(entry);
+        w->index[i].offset = load64(entry + 8);
+    }
+    w->count = (size_t)header.count;
+    w->position = header.index + header.count * BUNDLE_INDEX_ENTRY;
+    w->previous_index = header.index;
+    return ERROR_OK;
+}
+
+bundle_writer_t *bundle_writer_open(const char *path, bool append) {
+    bundle_writer_t *w = calloc(1, sizeof(bundle_writer_t));
+    if (NULL == w || NULL == path) {
+        free(w);
+        return NULL;
+    }
+    w->fd = open(path, O_RDWR | O_CREAT | (append ? 0 : O_TRUNC), 0600);
+    if (w->fd < 0) {
+        free(w);
+        return NULL;
+    }
+    w->position = BUNDLE_HEADER_SIZE;
+    if (append && ERROR_OK != writer_reopen(w)) {
+        close(w->fd);
+        free(w->index);
+        free(w);
+        return NULL;
+    }
+    if (0 == w->previous_index) {
+        // unfinished until the close writes the header again
+        uint8_t h[BUNDLE_HEADER_SIZE];
+        bundle_header_t header = { .count = 0, .index = 0, .end = BUNDLE_HEADER_SIZE };
+        header_encode(h, &header);
+        if (! write_all(w->fd, h, sizeof(h), 0) || 0 != ftruncate(w->fd, BUNDLE_HEADER_SIZE)) {
+            close(w->fd);
+            free(w->index);
+            free(w);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    return w;
+}
+
+static void writer_drain(bundle_writer_t *w) {
+    if (ERROR_OK == w->error && w->used > 0 && ! write_all(w->fd, w->buffer, w->used, w->position)) {
+        w->error = ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    w->position += w->used;
+    w->used = 0;
+}
+
+error_t bundle_append(bundle_writer_t *writer, uint64_t id, int number, const void *value, size_t length) {
+    if (NULL == writer || NULL == value) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (number < 0 || number > 0xffff) {
+        return ERROR_INVALID_SHARE;
+    }
+    if (! value_length_valid(length)) {
+        return ERROR_SHARE_HAS_ILLEGAL_LENGTH;
+    }
+    size_t size = BUNDLE_RECORD_HEADER + length;
+    pthread_mutex_lock(&writer->lock);
+    error_t err = writer->error;
+    if (ERROR_OK == err && ! index_reserve(writer, writer->count + 1)) {
+        err = ERROR_MALLOC_FAILED;
+    }
+    if (ERROR_OK == err) {
+        if (writer->used + size > BUNDLE_BUFFER_SIZE) {
+            writer_drain(writer);
+        }
+        uint8_t *record = writer->buffer + writer->used;
+        store64(record, id);
+        store16(record + 8, (unsigned)number);
+        store16(record + 10, (unsigned)length);
+        memcpy(record + BUNDLE_RECORD_HEADER, value, length);
+        writer->index[writer->count].id = id;
+        writer->index[writer->count].offset = writer->position + writer->used;
+        writer->count++;
+        writer->used += size;
+        err = writer->error;
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return err;
+}
+
+static int hex_digit(char c) {
+    return c >= '0' && c <= '9' ? c - '0'
+         : c >= 'a' && c <= 'f' ? c - 'a' + 10
+         : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+// a split share line, [prefix-]number-hex as for combine
+error_t bundle_append_share(bundle_writer_t *writer, uint64_t id, const char *share, size_t length) {
+    if (NULL == share) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    while (length > 0 && ('\n' == share[length - 1] || '\r' == share[length - 1])) {
+        length--;
+    }
+    const char *a = memchr(share, '-', length);
+    if (NULL == a) {
+        return ERROR_INVALID_SYNTAX;
+    }
+    const char *b = memchr(a + 1, '-', length - (size_t)(a + 1 - share));
+    if (NULL == b) {
+        b = a;
+        a = share;
+    } else {
+        a++;
+    }
+    int number = 0;
+    for (const char *p = a; p < b; p++) {
+        if (*p < '0' || *p > '9' || number > 0xffff) {
+            return ERROR_INVALID_SHARE;
+        }
+        number = 10 * number + (*p - '0');
+    }
+    b++;
+    size_t digits = length - (size_t)(b - share);
+    if (0 == number) {
+        return ERROR_INVALID_SHARE;
+    }
+    if (digits % 2 || ! value_length_valid(digits / 2)) {
+        return ERROR_SHARE_HAS_ILLEGAL_LENGTH;
+    }
+    uint8_t value[MAXDEGREE / 8];
+    for (size_t i = 0; i < digits / 2; i++) {
+        int hi = hex_digit(b[2 * i]), lo = hex_digit(b[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            memset(value, 0, i);
+            return ERROR_INVALID_SYNTAX;
+        }
+        value[i] = (uint8_t)(16 * hi + lo);
+    }
+    error_t err = bundle_append(writer, id, number, value, digits / 2);
+    memset(value, 0, digits / 2);
+    return err;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const index_entry_t *x = a, *y = b;
+    if (x->id != y->id) {
+        return x->id < y->id ? -1 : 1;
+    }
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+// sort by id and keep the last record of each
+static size_t index_finish(index_entry_t *index, size_t count) {
+    if (0 == count) {
+        return 0;                  // an empty bundle, index may be NULL
+    }
+    qsort(index, count, sizeof(index_entry_t), compare_entries);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (kept > 0 && index[kept - 1].id == index[i].id) {
+            index[kept - 1] = index[i];
+        } else {
+            index[kept++] = index[i];
+        }
+    }
+    return kept;
+}
+
+static error_t writer_finish(bundle_writer_t *w) {
+    writer_drain(w);
+    if (ERROR_OK != w->error) {
+        return w->error;
+    }
+    bundle_header_t header = { .end = w->position };
+    header.index = (w->position + 7) & ~(uint64_t)7;
+    header.count = index_finish(w->index, w->count);
+
+    // the index goes out through the record buffer
+    w->position = header.index;
+    for (size_t i = 0; i < header.count && ERROR_OK == w->error; i++) {
+        if (w->used + BUNDLE_INDEX_ENTRY > BUNDLE_BUFFER_SIZE) {
+            writer_drain(w);
+        }
+        store64(w->buffer + w->used, w->index[i].id);
+        store64(w->buffer + w->used + 8, w->index[i].offset);
+        w->used += BUNDLE_INDEX_ENTRY;
+    }
+    writer_drain(w);
+    if (ERROR_OK != w->error) {
+        return w->error;
+    }
+
+    // then, once the index is on disk, the header that points to it
+    uint8_t h[BUNDLE_HEADER_SIZE];
+    header_encode(h, &header);
+    uint64_t size = header.index + header.count * BUNDLE_INDEX_ENTRY;
+    if (0 != ftruncate(w->fd, (off_t)size) || 0 != fdatasync(w->fd)
+        || ! write_all(w->fd, h, sizeof(h), 0) || 0 != fdatasync(w->fd)) {
+        return ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    return ERROR_OK;
+}
+
+error_t bundle_writer_close(bundle_writer_t *writer) {
+    if (NULL == writer) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    pthread_mutex_lock(&writer->lock);
+    error_t err = writer_finish(writer);
+    pthread_mutex_unlock(&writer->lock);
+    if (0 != close(writer->fd) && ERROR_OK == err) {
+        err = ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    pthread_mutex_destroy(&writer->lock);
+    memset(writer->buffer, 0, sizeof(writer->buffer));
+    free(writer->index);
+    free(writer);
+    return err;
+}
+
+error_t bundle_process_share(void *data, const char *buffer, size_t length, int number, int total) {
+    const bundle_target_t *target = (const bundle_target_t *)data;
+    (void)total;
+    if (NULL == target || NULL == target->bundles) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (number < 1 || number > target->count) {
+        return ERROR_OK;               // no bundle for this holder
+    }
+    bundle_writer_t *writer = target->bundles[number - 1];
+    return NULL == writer ? ERROR_OK : bundle_append_share(writer, target->id, buffer, length);
+}
+
+
+// combining
+// =========
+
+// a merge-join of the holders' bundles on id, walking every
+// index once in order; the ids present in all of them are combined a
+// chunk at a time on the workers, with the Lagrange weights computed once
+// for each set of share numbers, so a secret costs threshold
+// multiplications, and the secrets are appended to the output in id order
+
+#define BUNDLE_COMBINE_CHUNK 1024
+
+typedef struct {
+    int *numbers;                  // threshold share numbers, bundle order
+    mpz_t *w;                      // weights
+    mpz_t *p;                      // x^t
+    poly_degree_t pd;
+    error_t error;                 // from field_lagrange_weights
+} bundle_weights_t;
+
+typedef struct {
+    int threshold;
+    bool diffusion;
+    bundle_weights_t *sets;
+    size_t set_count;
+    size_t set_capacity;
+    size_t count;                  // items in this chunk
+    uint64_t id[BUNDLE_COMBINE_CHUNK];
+    size_t set[BUNDLE_COMBINE_CHUNK];
+    error_t error[BUNDLE_COMBINE_CHUNK];
+    const uint8_t **value;         // threshold per item
+    uint8_t (*secret)[MAXDEGREE / 8];
+    mpz_t *scratch;                // three per worker
+    size_t *position;              // index cursor per bundle
+    int *numbers;                  // share numbers of the item being prepared
+} bundle_combine_t;
+
+static void weights_clear(bundle_weights_t *ws, int threshold) {
+    for (int k = 0; k < threshold; k++) {
+        mpz_clear(ws->w[k]);
+        mpz_clear(ws->p[k]);
+    }
+    field_deinit(&ws->pd);
+    free(ws->numbers);
+    free(ws->w);
+    free(ws->p);
+}
+
+// index of the weight set for degree and numbers, made on first use;
+// (size_t)-1 => out of memory
+static size_t weights_find(bundle_combine_t *bc, unsigned int degree, const int numbers[]) {
+    int t = bc->threshold;
+    for (size_t i = bc->set_count; i > 0; i--) {   // newest first, usually the only one
+        bundle_weights_t *ws = &bc->sets[i - 1];
+        if (ws->pd.degree == degree && 0 == memcmp(ws->numbers, numbers, t * sizeof(int))) {
+            return i - 1;
+        }
+    }
+    if (bc->set_count == bc->set_capacity) {
+        size_t capacity = bc->set_capacity ? 2 * bc->set_capacity : 4;
+        bundle_weights_t *sets = realloc(bc->sets, capacity * sizeof(bundle_weights_t));
+        if (NULL == sets) {
+            return (size_t)-1;
+        }
+        bc->sets = sets;
+        bc->set_capacity = capacity;
+    }
+    bundle_weights_t *ws = &bc->sets[bc->set_count];
+    ws->numbers = malloc(t * sizeof(int));
+    ws->w = malloc(t * sizeof(mpz_t));
+    ws->p = malloc(t * sizeof(mpz_t));
+    if (NULL == ws->numbers || NULL == ws->w || NULL == ws->p) {
+        free(ws->numbers);
+        free(ws->w);
+        free(ws->p);
+        return (size_t)-1;
+    }
+    memcpy(ws->numbers, numbers, t * sizeof(int));
+    for (int k = 0; k < t; k++) {
+        mpz_init(ws->w[k]);
+        mpz_init(ws->p[k]);
+    }
+    field_init(&ws->pd, degree);
+    ws->error = field_lagrange_weights(t, numbers, ws->w, ws->p, &ws->pd);
+    return bc->set_count++;
+}
+
+// the shares of one aligned id, checked as combine does; the chunk item
+// is filled in and its error set for the workers to skip
+static error_t combine_prepare(bundle_combine_t *bc, bundle_t *const *bundles) {
+    int t = bc->threshold;
+    size_t item = bc->count;
+    int *numbers = bc->numbers;
+    size_t length = 0;
+
+    for (int k = 0; k < t; k++) {
+        bundle_share_t share;
+        error_t err = bundle_entry(bundles[k], bc->position[k], &share);
+        if (ERROR_OK != err) {
+            return err;
+        }
+        if (k && share.length != length) {
+            return ERROR_SHARES_HAVE_DIFFERENT_SECURITY_LEVELS;
+        }
+        length = share.length;
+        // share numbers must be field elements
+        if (share.number < 1 || (1 == length && share.number > 255)) {
+            return ERROR_INVALID_SHARE;
+        }
+        numbers[k] = share.number;
+        bc->value[item * t + k] = share.value;
+    }
+    if (bc->diffusion && 8 * length < 64) {
+        return ERROR_SECURITY_LEVEL_TOO_SMALL_FOR_DIFFUSION;
+    }
+    size_t set = weights_find(bc, 8 * (unsigned int)length, numbers);
+    if ((size_t)-1 == set) {
+        return ERROR_MALLOC_FAILED;
+    }
+    if (ERROR_OK != bc->sets[set].error) {
+        return bc->sets[set].error;
+    }
+    bc->set[item] = set;
+    return ERROR_OK;
+}
+
+static void combine_aligned(void *context, size_t index, int worker) {
+    bundle_combine_t *bc = (bundle_combine_t *)context;
+    if (ERROR_OK != bc->error[index]) {
+        return;
+    }
+    int t = bc->threshold;
+    bundle_weights_t *ws = &bc->sets[bc->set[index]];
+    unsigned int degree = ws->pd.degree;
+    mpz_t *y = &bc->scratch[3 * worker];
+    mpz_t *h = &bc->scratch[3 * worker + 1];
+    mpz_t *sum = &bc->scratch[3 * worker + 2];
+
+    mpz_set_ui(*sum, 0);
+    for (int k = 0; k < t; k++) {
+        field_import_bytes(degree, *y, bc->value[index * t + k], degree / 8);
+        field_add(*y, *y, ws->p[k]);
+        field_mult(*h, *y, ws->w[k], &ws->pd);
+        field_add(*sum, *sum, *h);
+    }
+    if (bc->diffusion) {
+        encode_mpz(degree, *sum, DECODE);
+    }
+    bc->error[index] = field_export_bytes(bc->secret[index], degree / 8, degree, *sum);
+    mpz_set_ui(*sum, 0);
+    mpz_set_ui(*y, 0);
+}
+
+// combine the chunk and append its secrets; a failed id is left out, the
+// first such error is kept in *failed
+static error_t combine_flush(bundle_combine_t *bc, worker_pool_t *pool, bundle_writer_t *output, size_t *combined, error_t *failed) {
+    worker_pool_run(pool, bc->count, combine_aligned, NULL, bc);
+    for (size_t i = 0; i < bc->count; i++) {
+        if (ERROR_OK != bc->error[i]) {
+            if (ERROR_OK == *failed) {
+                *failed = bc->error[i];
+            }
+            continue;
+        }
+        error_t err = bundle_append(output, bc->id[i], 0, bc->secret[i], bc->sets[bc->set[i]].pd.degree / 8);
+        if (ERROR_OK != err) {
+            return err;
+        }
+        ++*combined;
+    }
+    memset(bc->secret, 0, bc->count * sizeof(*bc->secret));
+    bc->count = 0;
+    return ERROR_OK;
+}
+
+error_t bundle_combine(bundle_writer_t *output, bundle_t *const *bundles, int threshold, bool diffusion, worker_pool_t *pool, size_t *combined) {
+    size_t done = 0;
+    if (NULL != combined) {
+        *combined = 0;
+    }
+    if (NULL == output || NULL == bundles) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (threshold < 1) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    for (int k = 0; k < threshold; k++) {
+        if (NULL == bundles[k]) {
+            return ERROR_INPUT_IS_NULL;
+        }
+    }
+
+    uint64_t start = histogram_start();
+    int workers = worker_pool_size(pool);
+    bundle_combine_t *bc = calloc(1, sizeof(bundle_combine_t));
+    if (NULL != bc) {
+        bc->threshold = threshold;
+        bc->diffusion = diffusion;
+        bc->value = malloc(BUNDLE_COMBINE_CHUNK * threshold * sizeof(const uint8_t *));
+        bc->secret = calloc(BUNDLE_COMBINE_CHUNK, sizeof(*bc->secret));
+        bc->scratch = malloc(3 * workers * sizeof(mpz_t));
+        bc->position = calloc(threshold, sizeof(size_t));
+        bc->numbers = malloc(threshold * sizeof(int));
+    }
+    if (NULL == bc || NULL == bc->value || NULL == bc->secret || NULL == bc->scratch
+        || NULL == bc->position || NULL == bc->numbers) {
+        if (NULL != bc) {
+            free(bc->value);
+            free(bc->secret);
+            free(bc->scratch);
+            free(bc->position);
+            free(bc->numbers);
+        }
+        free(bc);
+        return ERROR_MALLOC_FAILED;
+    }
+    for (int i = 0; i < 3 * workers; i++) {
+        mpz_init(bc->scratch[i]);
+    }
+
+    // advance every bundle to the largest id under the cursors until they
+    // all agree, that id is aligned
+    size_t *position = bc->position;
+    error_t err = ERROR_OK, failed = ERROR_OK;
+    for (;;) {
+        uint64_t top = 0;
+        bool end = false;
+        for (int k = 0; k < threshold && ! end; k++) {
+            if (position[k] >= bundles[k]->header.count) {
+                end = true;
+            } else {
+                uint64_t id = load64(bundles[k]->map + bundles[k]->header.index + position[k] * BUNDLE_INDEX_ENTRY);
+                top = id > top ? id : top;
+            }
+        }
+        bool aligned = true;
+        for (int k = 0; k < threshold && ! end; k++) {
+            const bundle_t *b = bundles[k];
+            const uint8_t *index = b->map + b->header.index;
+            while (position[k] < b->header.count && load64(index + position[k] * BUNDLE_INDEX_ENTRY) < top) {
+                position[k]++;
+            }
+            if (position[k] >= b->header.count) {
+                end = true;
+            } else if (load64(index + position[k] * BUNDLE_INDEX_ENTRY) != top) {
+                aligned = false;
+            }
+        }
+        if (end) {
+            break;
+        }
+        if (! aligned) {
+            continue;
+        }
+        bc->id[bc->count] = top;
+        bc->error[bc->count] = combine_prepare(bc, bundles);
+        bc->count++;
+        for (int k = 0; k < threshold; k++) {
+            position[k]++;
+        }
+        if (BUNDLE_COMBINE_CHUNK == bc->count) {
+            err = combine_flush(bc, pool, output, &done, &failed);
+            if (ERROR_OK != err) {
+                break;
+            }
+        }
+    }
+    if (ERROR_OK == err) {
+        err = combine_flush(bc, pool, output, &done, &failed);
+    }
+    histogram_stop(HISTOGRAM_COMBINE_BATCH, 0, 0, start);
+
+    for (size_t i = 0; i < bc->set_count; i++) {
+        weights_clear(&bc->sets[i], threshold);
+    }
+    for (int i = 0; i < 3 * workers; i++) {
+        mpz_clear(bc->scratch[i]);
+    }
+    free(bc->sets);
+    free(bc->value);
+    free(bc->secret);
+    free(bc->scratch);
+    free(bc->position);
+    free(bc->numbers);
+    free(bc);
+    if (NULL != combined) {
+        *combined = done;
+    }
+    return ERROR_OK != err ? err : failed;
+}
@@ -0,0 +1,113 @@
+/*
+ *  GF(2^deg) field arithmetic shared by the library and its tools
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_FIELD_H_)
+#define _FIELD_H_ 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(SSSS_NO_GMP)
+#include "mpz_fixed.h"
+#else
+#include "gmp.h"
+#endif
+
+#include "shamir.h"
+
+typedef struct {
+    unsigned int degree;
+    mpz_t poly;
+    unsigned char k[3];            // poly = x^degree + x^k[0] + x^k[1] + x^k[2] + 1
+} poly_degree_t;
+
+// degree is a multiple of 8 in 8..MAXDEGREE
+int field_size_valid(int deg);
+
+// pd->poly is the irreducible polynomial of degree deg
+void field_init(poly_degree_t *pd, int deg);
+void field_deinit(poly_degree_t *pd);
+
+// hex or ASCII text <=> field element
+error_t field_import(const unsigned int degree, mpz_t x, const char *s, int hexmode);
+error_t field_print(char *buffer, size_t size, const char *prefix, int format_length, int number, const unsigned int degree, const mpz_t x, bool hexmode);
+
+// raw bytes <=> field element, always degree / 8 bytes
+error_t field_import_bytes(const unsigned int degree, mpz_t x, const void *bytes, size_t length);
+error_t field_export_bytes(void *buffer, size_t size, const unsigned int degree, const mpz_t x);
+
+void field_add(mpz_t z, const mpz_t x, const mpz_t y);
+void field_mult(mpz_t z, const mpz_t x, const mpz_t y, poly_degree_t *pd);  // z != y
+void field_invert(mpz_t z, const mpz_t x, poly_degree_t *pd);               // x != 0
+
+// y = x^n + coeff[n-1]x^(n-1) + ... + coeff[0]
+void horner(int n, mpz_t y, const mpz_t x, const mpz_t coeff[], poly_degree_t *pd);
+
+// Lagrange interpolation at zero for shares y = x^t + ... + c[0] with
+// share numbers x: c[0] = sum of (y + p) * w; ERROR_SHARES_INCONSISTENT =>
+// a repeated number, the scratch for t shares is on the heap
+error_t field_lagrange_weights(int t, const int numbers[], mpz_t w[], mpz_t p[], poly_degree_t *pd);
+
+// the diffusion layer (degree >= 64) applied to a secret before splitting
+enum encdec {ENCODE, DECODE};
+void encode_mpz(const unsigned int degree, mpz_t x, enum encdec encdecmode);
+
+// random numbers, cprng_bytes and cprng_read close the cprng on failure
+extern const cprng_t internal_cprng;             // reads RANDOM_SOURCE
+
+error_t cprng_init(const cprng_t *cprng, void **data);
+error_t cprng_deinit(const cprng_t *cprng, void *data);
+error_t cprng_bytes(const cprng_t *cprng, void *data, void *buffer, size_t size);
+
+// per degree implementation choices, set by tune (tune.c), zero => built-in
+typedef struct {
+    unsigned char mult;            // field_backend_t
+    unsigned char invert;          // field_backend_t
+    unsigned char restore;         // restore_t
+} field_choice_t;
+
+extern field_choice_t field_choice[MAXDEGREE / 8 + 1];
+
+bool field_backend_available(field_backend_t backend, unsigned int degree);
+
+// untuned: the specialised kernels where there are some, otherwise limbs
+// for multiplying and the extended Euclid on mpz values for inverting
+// (Itoh-Tsujii costs degree squarings, which the generic limbs lose)
+static inline field_backend_t field_mult_backend(unsigned int degree) {
+    field_backend_t b = (field_backend_t)field_choice[degree / 8].mult;
+    if (FIELD_BACKEND_AUTO == b) {
+        return field_backend_available(FIELD_BACKEND_FIXED, degree) ? FIELD_BACKEND_FIXED : FIELD_BACKEND_LIMBS;
+    }
+    return b;
+}
+
+static inline field_backend_t field_invert_backend(unsigned int degree) {
+    field_backend_t b = (field_backend_t)field_choice[degree / 8].invert;
+    if (FIELD_BACKEND_AUTO == b) {
+        return field_backend_available(FIELD_BACKEND_FIXED, degree) ? FIELD_BACKEND_FIXED : FIELD_BACKEND_GENERIC;
+    }
+    return b;
+}
+
+static inline restore_t field_restore(unsigned int degree) {
+    restore_t r = (restore_t)field_choice[degree / 8].restore;
+    return RESTORE_AUTO == r ? RESTORE_LAGRANGE : r;
+}
+
+#endif
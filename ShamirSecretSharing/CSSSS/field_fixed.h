@@ -0,0 +1,287 @@
+/*
+ *  GF(2^N) arithmetic on fixed arrays of 64 bit limbs, specialised per degree
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_FIELD_FIXED_H_)
+#define _FIELD_FIXED_H_ 1
+
+#include <stdint.h>
+#include <string.h>
+
+// elements are little endian limb arrays, limb 0 holds x^0..x^63
+//
+// FIELD_FIXED_DEFINE(N, A, B, C) instantiates, for the field modulo
+// x^N + x^A + x^B + x^C + 1 (the irred_coeff entry for N, N a multiple
+// of 64 and 0 < C < B < A < 64):
+//
+//   field<N>_mult(z, x, y)   z = x * y    (z may alias x or y)
+//   field<N>_square(z, x)    z = x^2      (z may alias x)
+//   field<N>_invert(z, x)    z = 1 / x    (x non-zero)
+//
+// all loop bounds are compile time constants so the compiler can unroll
+// them and the modulus never exists at run time
+//
+// field_limbs_mult/square/invert do the same for any degree with the
+// degree and the three middle exponents of the modulus passed at run time
+
+
+// carry-less 64 x 64 => 128 bit multiply
+static inline void clmul64(uint64_t a, uint64_t b, uint64_t *lo, uint64_t *hi) {
+    // multiples of a by every 4 bit polynomial, top three bits of a are
+    // left out so no product overflows a limb
+    uint64_t a1 = a & 0x1fffffffffffffffULL;
+    uint64_t u[16];
+    u[0] = 0;
+    u[1] = a1;
+    for (int i = 2; i < 16; i += 2) {
+        u[i] = u[i / 2] << 1;
+        u[i + 1] = u[i] ^ a1;
+    }
+    uint64_t l = u[b & 15];
+    uint64_t h = 0;
+    for (int i = 4; i < 64; i += 4) {
+        uint64_t t = u[(b >> i) & 15];
+        l ^= t << i;
+        h ^= t >> (64 - i);
+    }
+    for (int i = 61; i < 64; i++) {
+        uint64_t mask = -((a >> i) & 1);
+        l ^= (b << i) & mask;
+        h ^= (b >> (64 - i)) & mask;
+    }
+    *lo = l;
+    *hi = h;
+}
+
+// spread the low 32 bits of x to the even bit positions (squaring over GF(2))
+static inline uint64_t spread32(uint64_t x) {
+    x &= 0xffffffffULL;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+#define FIELD_FIXED_DEFINE(N, A, B, C)                                          \
+                                                                                \
+enum { field##N##_limbs = (N) / 64 };                                           \
+                                                                                \
+/* reduce a 2N bit product to N bits, r is clobbered */                         \
+static inline void field##N##_reduce(uint64_t z[(N) / 64], uint64_t r[2 * (N) / 64]) { \
+    for (int i = 2 * (N) / 64 - 1; i >= (N) / 64; i--) {                        \
+        uint64_t t = r[i];                                                      \
+        r[i - (N) / 64] ^= t ^ (t << (A)) ^ (t << (B)) ^ (t << (C));            \
+        r[i - (N) / 64 + 1] ^= (t >> (64 - (A))) ^ (t >> (64 - (B))) ^ (t >> (64 - (C))); \
+    }                                                                           \
+    memcpy(z, r, (N) / 8);                                                      \
+}                                                                               \
+                                                                                \
+static inline void field##N##_mult(uint64_t z[(N) / 64], const uint64_t x[(N) / 64], const uint64_t y[(N) / 64]) { \
+    uint64_t r[2 * (N) / 64] = { 0 };                                           \
+    for (int i = 0; i < (N) / 64; i++) {                                        \
+        for (int j = 0; j < (N) / 64; j++) {                                    \
+            uint64_t lo, hi;                                                    \
+            clmul64(x[i], y[j], &lo, &hi);                                      \
+            r[i + j] ^= lo;                                                     \
+            r[i + j + 1] ^= hi;                                                 \
+        }                                                                       \
+    }                                                                           \
+    field##N##_reduce(z, r);                                                    \
+}                                                                               \
+                                                                                \
+static inline void field##N##_square(uint64_t z[(N) / 64], const uint64_t x[(N) / 64]) { \
+    uint64_t r[2 * (N) / 64];                                                   \
+    for (int i = 0; i < (N) / 64; i++) {                                        \
+        r[2 * i] = spread32(x[i]);                                              \
+        r[2 * i + 1] = spread32(x[i] >> 32);                                    \
+    }                                                                           \
+    field##N##_reduce(z, r);                                                    \
+}                                                                               \
+                                                                                \
+/* Itoh-Tsujii: x^-1 = x^(2^N - 2) = (x^(2^(N-1) - 1))^2 */                     \
+static inline void field##N##_invert(uint64_t z[(N) / 64], const uint64_t x[(N) / 64]) { \
+    uint64_t r[(N) / 64], t[(N) / 64];                                          \
+    memcpy(r, x, (N) / 8);          /* r = x^(2^k - 1), k = 1 */                \
+    int k = 1;                                                                  \
+    int top = 0;                    /* highest set bit of N - 1 */              \
+    while (((N) - 1) >> (top + 1)) {                                            \
+        top++;                                                                  \
+    }                                                                           \
+    for (int bit = top - 1; bit >= 0; bit--) {                                  \
+        memcpy(t, r, (N) / 8);                                                  \
+        for (int i = 0; i < k; i++) {                                           \
+            field##N##_square(t, t);                                            \
+        }                                                                       \
+        field##N##_mult(r, t, r);       /* k => 2k */                           \
+        k *= 2;                                                                 \
+        if ((((N) - 1) >> bit) & 1) {                                           \
+            field##N##_square(r, r);                                            \
+            field##N##_mult(r, r, x);   /* k => k + 1 */                        \
+            k += 1;                                                             \
+        }                                                                       \
+    }                                                                           \
+    field##N##_square(z, r);                                                    \
+}
+
+
+// any degree d, elements of (d + 63) / 64 limbs, x^d + x^k[0] + x^k[1] + x^k[2] + 1
+#define FIELD_LIMBS_MAX 128             // MAXDEGREE / 64
+#define FIELD_KARATSUBA_LIMBS 8         // below this schoolbook is cheaper
+
+// r ^= t * x^offset
+static inline void xor_at(uint64_t *r, uint64_t t, unsigned offset) {
+    unsigned bit = offset % 64;
+    r[offset / 64] ^= t << bit;
+    if (bit) {
+        r[offset / 64 + 1] ^= t >> (64 - bit);
+    }
+}
+
+// reduce the 2 * limbs word product r, folding from the top word down
+// (a fold only lands on the same or lower words)
+static inline void field_limbs_reduce(uint64_t *z, uint64_t *r, unsigned degree, const unsigned char k[3]) {
+    int limbs = (int)(degree + 63) / 64;
+    for (int i = 2 * limbs - 1; i >= 0 && 64 * (unsigned)i + 64 > degree; i--) {
+        for (;;) {
+            uint64_t t;
+            unsigned base;
+            if (64 * (unsigned)i >= degree) {
+                t = r[i];
+                r[i] = 0;
+                base = 64 * (unsigned)i - degree;
+            } else {
+                t = r[i] >> (degree % 64);
+                r[i] &= ((uint64_t)1 << (degree % 64)) - 1;
+                base = 0;
+            }
+            if (0 == t) {
+                break;
+            }
+            xor_at(r, t, base);
+            xor_at(r, t, base + k[0]);
+            xor_at(r, t, base + k[1]);
+            xor_at(r, t, base + k[2]);
+        }
+    }
+    memcpy(z, r, limbs * sizeof(uint64_t));
+}
+
+// significant limbs of x
+static inline int field_limbs_used(const uint64_t *x, int limbs) {
+    while (limbs > 0 && 0 == x[limbs - 1]) {
+        limbs--;
+    }
+    return limbs;
+}
+
+// r ^= x * y, x of nx and y of ny limbs
+static inline void clmul_schoolbook(uint64_t *r, const uint64_t *x, int nx, const uint64_t *y, int ny) {
+    for (int i = 0; i < nx; i++) {
+        if (0 == x[i]) {
+            continue;
+        }
+        for (int j = 0; j < ny; j++) {
+            uint64_t lo, hi;
+            clmul64(x[i], y[j], &lo, &hi);
+            r[i + j] ^= lo;
+            r[i + j + 1] ^= hi;
+        }
+    }
+}
+
+// r = x * y, n limbs each, 2n limbs of result; three half size products
+// (x0 y0, x1 y1 and (x0 + x1)(y0 + y1)) instead of four
+static inline void clmul_karatsuba(uint64_t *r, const uint64_t *x, const uint64_t *y, int n) {
+    if (n < FIELD_KARATSUBA_LIMBS) {
+        memset(r, 0, 2 * (size_t)n * sizeof(uint64_t));
+        clmul_schoolbook(r, x, n, y, n);
+        return;
+    }
+    int h = n / 2, m = n - h;          // m >= h
+    uint64_t xs[m], ys[m], mid[2 * m];
+    clmul_karatsuba(r, x, y, h);
+    clmul_karatsuba(r + 2 * h, x + h, y + h, m);
+    for (int i = 0; i < m; i++) {
+        xs[i] = x[h + i] ^ (i < h ? x[i] : 0);
+        ys[i] = y[h + i] ^ (i < h ? y[i] : 0);
+    }
+    clmul_karatsuba(mid, xs, ys, m);
+    for (int i = 0; i < 2 * h; i++) {
+        mid[i] ^= r[i];
+    }
+    for (int i = 0; i < 2 * m; i++) {
+        mid[i] ^= r[2 * h + i];
+    }
+    for (int i = 0; i < 2 * m; i++) {
+        r[h + i] ^= mid[i];
+    }
+}
+
+// Karatsuba when both factors fill many limbs, otherwise schoolbook over
+// the limbs in use (x is a small share number in horner)
+static inline void field_limbs_mult(uint64_t *z, const uint64_t *x, const uint64_t *y, unsigned degree, const unsigned char k[3]) {
+    int limbs = (int)(degree + 63) / 64;
+    uint64_t r[2 * FIELD_LIMBS_MAX + 1];
+    int nx = field_limbs_used(x, limbs), ny = field_limbs_used(y, limbs);
+    if (nx >= FIELD_KARATSUBA_LIMBS && ny >= FIELD_KARATSUBA_LIMBS) {
+        clmul_karatsuba(r, x, y, limbs);
+        r[2 * limbs] = 0;
+    } else {
+        memset(r, 0, (2 * (size_t)limbs + 1) * sizeof(uint64_t));
+        clmul_schoolbook(r, x, nx, y, ny);
+    }
+    field_limbs_reduce(z, r, degree, k);
+}
+
+static inline void field_limbs_square(uint64_t *z, const uint64_t *x, unsigned degree, const unsigned char k[3]) {
+    int limbs = (int)(degree + 63) / 64;
+    uint64_t r[2 * FIELD_LIMBS_MAX + 1];
+    r[2 * limbs] = 0;
+    for (int i = 0; i < limbs; i++) {
+        r[2 * i] = spread32(x[i]);
+        r[2 * i + 1] = spread32(x[i] >> 32);
+    }
+    field_limbs_reduce(z, r, degree, k);
+}
+
+// Itoh-Tsujii as field<N>_invert
+static inline void field_limbs_invert(uint64_t *z, const uint64_t *x, unsigned degree, const unsigned char k[3]) {
+    int limbs = (int)(degree + 63) / 64;
+    uint64_t r[FIELD_LIMBS_MAX], t[FIELD_LIMBS_MAX];
+    memcpy(r, x, limbs * sizeof(uint64_t));
+    unsigned n = 1;
+    int top = 63 - __builtin_clzll(degree - 1);
+    for (int bit = top - 1; bit >= 0; bit--) {
+        memcpy(t, r, limbs * sizeof(uint64_t));
+        for (unsigned i = 0; i < n; i++) {
+            field_limbs_square(t, t, degree, k);
+        }
+        field_limbs_mult(r, t, r, degree, k);
+        n *= 2;
+        if (((degree - 1) >> bit) & 1) {
+            field_limbs_square(r, r, degree, k);
+            field_limbs_mult(r, r, x, degree, k);
+            n += 1;
+        }
+    }
+    field_limbs_square(z, r, degree, k);
+}
+
+#endif
@@ -0,0 +1,748 @@
+/*
+ *  byte-wise secret sharing over GF(2^8) for binary secrets of any length
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "shamir.h"
+#include "field.h"
+#include "gf256.h"
+
+// SIMD kernels only where the compiler can target them per function and
+// detect the CPU at run time
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && !defined(SSSS_NO_SIMD)
+#define GF256_X86 1
+#include <immintrin.h>
+#endif
+
+// every byte position i is a separate polynomial of degree threshold - 1
+// whose constant term is secret[i]; share x holds its value at x.  All
+// the work is multiplying a whole region by one constant and adding
+// another region, as in Reed-Solomon coding, so the inner loops are one
+// region kernel per CPU: a 256 byte product table per constant for the
+// scalar one, PSHUFB on 16 entry nibble tables for SSSE3/AVX2 and
+// GF2P8MULB, whose field is this one, for GFNI
+
+#define GF256_POLY 0x11b               // x^8 + x^4 + x^3 + x + 1
+#define GF256_GENERATOR 3              // x + 1, primitive for GF256_POLY
+#define GF256_BLOCK 4096               // secret bytes per random read and stream chunk
+
+// exp is doubled so a product needs no reduction of the log sum
+static uint8_t gf256_exp[2 * 255];
+static uint8_t gf256_log[256];
+static pthread_once_t gf256_once = PTHREAD_ONCE_INIT;
+
+static inline uint8_t gf256_mult(uint8_t a, uint8_t b) {
+    if (0 == a || 0 == b) {
+        return 0;
+    }
+    return gf256_exp[gf256_log[a] + gf256_log[b]];
+}
+
+static inline uint8_t gf256_divide(uint8_t a, uint8_t b) {  // b != 0
+    if (0 == a) {
+        return 0;
+    }
+    return gf256_exp[gf256_log[a] + 255 - gf256_log[b]];
+}
+
+static inline uint8_t gf256_power(uint8_t a, int n) {
+    if (0 == n) {
+        return 1;
+    }
+    if (0 == a) {
+        return 0;
+    }
+    return gf256_exp[(gf256_log[a] * (unsigned int)n) % 255];
+}
+
+// a constant with its tables for the region kernels
+typedef struct {
+    uint8_t table[256];            // c * y
+    uint8_t low[16];               // c * y, y < 16
+    uint8_t high[16];              // c * (y << 4), y < 16
+    uint8_t c;
+} gf256_coeff_t;
+
+static void gf256_coeff(gf256_coeff_t *k, uint8_t c) {
+    k->c = c;
+    for (int y = 0; y < 256; ++y) {
+        k->table[y] = gf256_mult(c, (uint8_t)y);
+    }
+    for (int y = 0; y < 16; ++y) {
+        k->low[y] = k->table[y];
+        k->high[y] = k->table[y << 4];
+    }
+}
+
+// dst[i] = c * a[i] ^ b[i], b NULL => 0; dst may be a or b
+typedef void gf256_region_t(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t n, const gf256_coeff_t *k);
+
+static void region_scalar(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t n, const gf256_coeff_t *k) {
+    const uint8_t *table = k->table;
+    if (NULL == b) {
+        for (size_t i = 0; i < n; ++i) {
+            dst[i] = table[a[i]];
+        }
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            dst[i] = table[a[i]] ^ b[i];
+        }
+    }
+}
+
+#if defined(GF256_X86)
+
+__attribute__((target("ssse3")))
+static void region_ssse3(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t n, const gf256_coeff_t *k) {
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i low = _mm_loadu_si128((const __m128i *)k->low);
+    const __m128i high = _mm_loadu_si128((const __m128i *)k->high);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(low, _mm_and_si128(v, mask)),
+                                  _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(v, 4), mask)));
+        if (NULL != b) {
+            p = _mm_xor_si128(p, _mm_loadu_si128((const __m128i *)(b + i)));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), p);
+    }
+    region_scalar(dst + i, a + i, NULL == b ? NULL : b + i, n - i, k);
+}
+
+__attribute__((target("avx2")))
+static void region_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t n, const gf256_coeff_t *k) {
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    const __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)k->low));
+    const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)k->high));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(low, _mm256_and_si256(v, mask)),
+                                     _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi64(v, 4), mask)));
+        if (NULL != b) {
+            p = _mm256_xor_si256(p, _mm256_loadu_si256((const __m256i *)(b + i)));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), p);
+    }
+    region_scalar(dst + i, a + i, NULL == b ? NULL : b + i, n - i, k);
+}
+
+__attribute__((target("gfni,avx2")))
+static void region_gfni(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t n, const gf256_coeff_t *k) {
+    const __m256i c = _mm256_set1_epi8((char)k->c);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i p = _mm256_gf2p8mul_epi8(_mm256_loadu_si256((const __m256i *)(a + i)), c);
+        if (NULL != b) {
+            p = _mm256_xor_si256(p, _mm256_loadu_si256((const __m256i *)(b + i)));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + i), p);
+    }
+    region_scalar(dst + i, a + i, NULL == b ? NULL : b + i, n - i, k);
+}
+
+__attribute__((target("gfni,avx512f,avx512bw")))
+static void region_avx512_gfni(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t n, const gf256_coeff_t *k) {
+    const __m512i c = _mm512_set1_epi8((char)k->c);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i p = _mm512_gf2p8mul_epi8(_mm512_loadu_si512((const void *)(a + i)), c);
+        if (NULL != b) {
+            p = _mm512_xor_si512(p, _mm512_loadu_si512((const void *)(b + i)));
+        }
+        _mm512_storeu_si512((void *)(dst + i), p);
+    }
+    region_scalar(dst + i, a + i, NULL == b ? NULL : b + i, n - i, k);
+}
+
+#endif
+
+static gf256_region_t *const gf256_regions[GF256_KERNEL_maximum] = {
+    [GF256_KERNEL_SCALAR] = region_scalar,
+#if defined(GF256_X86)
+    [GF256_KERNEL_SSSE3] = region_ssse3,
+    [GF256_KERNEL_AVX2] = region_avx2,
+    [GF256_KERNEL_GFNI] = region_gfni,
+    [GF256_KERNEL_AVX512_GFNI] = region_avx512_gfni,
+#endif
+};
+
+static gf256_kernel_t gf256_current = GF256_KERNEL_SCALAR;
+static gf256_region_t *gf256_region = region_scalar;
+
+bool gf256_kernel_available(gf256_kernel_t kernel) {
+    switch (kernel) {
+    case GF256_KERNEL_AUTO:
+    case GF256_KERNEL_SCALAR:
+        return true;
+#if defined(GF256_X86)
+    case GF256_KERNEL_SSSE3:
+        return __builtin_cpu_supports("ssse3");
+    case GF256_KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case GF256_KERNEL_GFNI:
+        return __builtin_cpu_supports("gfni") && __builtin_cpu_supports("avx2");
+    case GF256_KERNEL_AVX512_GFNI:
+        return __builtin_cpu_supports("gfni") && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+    default:
+        return false;
+    }
+}
+
+// the widest available
+static gf256_kernel_t gf256_best(void) {
+    for (int kernel = GF256_KERNEL_maximum - 1; kernel > GF256_KERNEL_SCALAR; --kernel) {
+        if (gf256_kernel_available((gf256_kernel_t)kernel)) {
+            return (gf256_kernel_t)kernel;
+        }
+    }
+    return GF256_KERNEL_SCALAR;
+}
+
+static void gf256_tables(void) {
+    unsigned int x = 1;
+    for (int i = 0; i < 255; ++i) {
+        gf256_exp[i] = gf256_exp[i + 255] = (uint8_t)x;
+        gf256_log[x] = (uint8_t)i;
+        // x *= GF256_GENERATOR
+        x ^= x << 1;
+        if (x & 0x100) {
+            x ^= GF256_POLY;
+        }
+    }
+    gf256_current = gf256_best();
+    gf256_region = gf256_regions[gf256_current];
+}
+
+bool gf256_set_kernel(gf256_kernel_t kernel) {
+    pthread_once(&gf256_once, gf256_tables);
+    if (!gf256_kernel_available(kernel)) {
+        return false;
+    }
+    if (GF256_KERNEL_AUTO == kernel) {
+        kernel = gf256_best();
+    }
+    gf256_current = kernel;
+    gf256_region = gf256_regions[kernel];
+    return true;
+}
+
+gf256_kernel_t gf256_kernel(void) {
+    pthread_once(&gf256_once, gf256_tables);
+    return gf256_current;
+}
+
+const char *gf256_kernel_name(gf256_kernel_t kernel) {
+    static const char *const names[GF256_KERNEL_maximum] = {
+        [GF256_KERNEL_AUTO] = "auto",
+        [GF256_KERNEL_SCALAR] = "scalar",
+        [GF256_KERNEL_SSSE3] = "ssse3",
+        [GF256_KERNEL_AVX2] = "avx2",
+        [GF256_KERNEL_GFNI] = "gfni",
+        [GF256_KERNEL_AVX512_GFNI] = "avx512-gfni",
+    };
+    if (kernel < 0 || kernel >= GF256_KERNEL_maximum) {
+        return "unknown";
+    }
+    return names[kernel];
+}
+
+size_t gf256_share_size(size_t length) {
+    return length + GF256_HEADER_SIZE;
+}
+
+// shares and their constants, shared by the whole and streaming splits
+typedef struct {
+    int threshold;
+    int number;
+    const cprng_t *cprng;
+    void *cprng_data;              // NULL => closed
+    gf256_coeff_t *xs;             // number constants, x = 1..number
+    uint8_t *coeff;                // (threshold - 1) * GF256_BLOCK random bytes
+} split_state_t;
+
+static error_t split_init(split_state_t *state, int threshold, int number, const cprng_t *cprng) {
+    if (threshold < 1 || number < threshold || number > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    pthread_once(&gf256_once, gf256_tables);
+
+    state->threshold = threshold;
+    state->number = number;
+    state->cprng = NULL == cprng ? &internal_cprng : cprng;
+    state->xs = malloc(sizeof(gf256_coeff_t) * (size_t)number + (size_t)(threshold - 1) * GF256_BLOCK);
+    if (NULL == state->xs) {
+        return ERROR_MALLOC_FAILED;
+    }
+    state->coeff = (uint8_t *)(state->xs + number);
+    for (int s = 0; s < number; ++s) {
+        gf256_coeff(&state->xs[s], (uint8_t)(s + 1));
+    }
+
+    state->cprng_data = NULL;
+    error_t err = cprng_init(state->cprng, &state->cprng_data);
+    if (ERROR_OK != err) {
+        state->cprng_data = NULL;
+        free(state->xs);
+    }
+    return err;
+}
+
+static error_t split_deinit(split_state_t *state) {
+    memset(state->coeff, 0, (size_t)(state->threshold - 1) * GF256_BLOCK);
+    free(state->xs);
+    if (NULL == state->cprng_data) {
+        return ERROR_OK;
+    }
+    return cprng_deinit(state->cprng, state->cprng_data);
+}
+
+static void split_header(const split_state_t *state, uint8_t *header, int s) {
+    header[0] = GF256_VERSION;
+    header[1] = (uint8_t)state->threshold;
+    header[2] = (uint8_t)(s + 1);
+}
+
+// m (<= GF256_BLOCK) secret bytes to m bytes of each share in outs
+static error_t split_block(split_state_t *state, uint8_t *const *outs, size_t offset, const uint8_t *in, size_t m) {
+    int threshold = state->threshold;
+    uint8_t *coeff = state->coeff;
+
+    // coefficient j (1..threshold-1) of byte i is coeff[(j - 1) * m + i]
+    error_t err = cprng_bytes(state->cprng, state->cprng_data, coeff, (size_t)(threshold - 1) * m);
+    if (ERROR_OK != err) {
+        // cprng_bytes closed the cprng
+        state->cprng_data = NULL;
+        return err;
+    }
+
+    // Horner: out = x * out + coefficient, from the top one down
+    gf256_region_t *region = gf256_region;
+    for (int s = 0; s < state->number; ++s) {
+        uint8_t *out = outs[s] + offset;
+        if (1 == threshold) {
+            memcpy(out, in, m);
+            continue;
+        }
+        memcpy(out, coeff + (size_t)(threshold - 2) * m, m);
+        for (int j = threshold - 2; j >= 0; --j) {
+            const uint8_t *c = 0 == j ? in : coeff + (size_t)(j - 1) * m;
+            region(out, out, c, m, &state->xs[s]);
+        }
+    }
+    return ERROR_OK;
+}
+
+error_t gf256_split(uint8_t *const *shares, const void *secret, size_t length,
+                    int threshold, int number, const cprng_t *cprng) {
+    if (NULL == shares || (NULL == secret && 0 != length)) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    split_state_t state;
+    error_t err = split_init(&state, threshold, number, cprng);
+    if (ERROR_OK != err) {
+        return err;
+    }
+
+    uint8_t *outs[GF256_MAX_SHARES];
+    for (int s = 0; s < number; ++s) {
+        split_header(&state, shares[s], s);
+        outs[s] = shares[s] + GF256_HEADER_SIZE;
+    }
+
+    const uint8_t *in = (const uint8_t *)secret;
+    for (size_t offset = 0; offset < length && ERROR_OK == err; offset += GF256_BLOCK) {
+        size_t m = length - offset < GF256_BLOCK ? length - offset : GF256_BLOCK;
+        err = split_block(&state, outs, offset, in + offset, m);
+    }
+
+    error_t e = split_deinit(&state);
+    return ERROR_OK == err ? e : err;
+}
+
+// check the threshold share headers and set the Lagrange weights at zero
+// w[k] = prod(j != k) x[j] / (x[j] - x[k])
+static error_t combine_weights(gf256_coeff_t *ws, const uint8_t *const *headers, int threshold) {
+    bool seen[256] = { false };
+    for (int k = 0; k < threshold; ++k) {
+        if (GF256_VERSION != headers[k][0]) {
+            return ERROR_INVALID_SYNTAX;
+        }
+        if (threshold != headers[k][1]) {
+            return ERROR_SHARES_INCONSISTENT;
+        }
+        uint8_t x = headers[k][2];
+        if (0 == x || seen[x]) {
+            return ERROR_INVALID_SHARE;
+        }
+        seen[x] = true;
+    }
+
+    for (int k = 0; k < threshold; ++k) {
+        uint8_t xk = headers[k][2];
+        uint8_t w = 1;
+        for (int j = 0; j < threshold; ++j) {
+            if (j != k) {
+                uint8_t xj = headers[j][2];
+                w = gf256_mult(w, gf256_divide(xj, xj ^ xk));
+            }
+        }
+        gf256_coeff(&ws[k], w);
+    }
+    return ERROR_OK;
+}
+
+// out = sum w[k] * ys[k]
+static void combine_block(uint8_t *out, const uint8_t *const *ys, size_t offset, size_t m,
+                          const gf256_coeff_t *ws, int threshold) {
+    gf256_region_t *region = gf256_region;
+    for (int k = 0; k < threshold; ++k) {
+        region(out, ys[k] + offset, 0 == k ? NULL : out, m, &ws[k]);
+    }
+}
+
+error_t gf256_combine(void *secret, size_t length, const uint8_t *const *shares, int threshold) {
+    if (NULL == shares || (NULL == secret && 0 != length)) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (threshold < 1 || threshold > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    pthread_once(&gf256_once, gf256_tables);
+
+    const uint8_t *ys[GF256_MAX_SHARES];
+    for (int k = 0; k < threshold; ++k) {
+        if (NULL == shares[k]) {
+            return ERROR_INPUT_IS_NULL;
+        }
+        ys[k] = shares[k] + GF256_HEADER_SIZE;
+    }
+
+    gf256_coeff_t *ws = malloc(sizeof(gf256_coeff_t) * (size_t)threshold);
+    if (NULL == ws) {
+        return ERROR_MALLOC_FAILED;
+    }
+    error_t err = combine_weights(ws, shares, threshold);
+
+    // a block at a time so the secret being summed stays in cache
+    uint8_t *out = (uint8_t *)secret;
+    for (size_t offset = 0; offset < length && ERROR_OK == err; offset += GF256_BLOCK) {
+        size_t m = length - offset < GF256_BLOCK ? length - offset : GF256_BLOCK;
+        combine_block(out + offset, ys, offset, m, ws, threshold);
+    }
+
+    memset(ws, 0, sizeof(gf256_coeff_t) * (size_t)threshold);
+    free(ws);
+    return err;
+}
+
+
+// dispersal
+// =========
+
+error_t gf256_disperse(uint8_t *const *fragments, const uint8_t *data, size_t m, int threshold, int number) {
+    if (threshold < 1 || number < threshold || number > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    pthread_once(&gf256_once, gf256_tables);
+
+    gf256_coeff_t *xs = malloc(sizeof(gf256_coeff_t) * (size_t)number);
+    if (NULL == xs) {
+        return ERROR_MALLOC_FAILED;
+    }
+    for (int s = 0; s < number; ++s) {
+        gf256_coeff(&xs[s], (uint8_t)(s + 1));
+    }
+
+    // Horner as for split, with the data rows as the coefficients
+    gf256_region_t *region = gf256_region;
+    for (size_t offset = 0; offset < m; offset += GF256_BLOCK) {
+        size_t n = m - offset < GF256_BLOCK ? m - offset : GF256_BLOCK;
+        for (int s = 0; s < number; ++s) {
+            uint8_t *out = fragments[s] + offset;
+            memcpy(out, data + (size_t)(threshold - 1) * m + offset, n);
+            for (int j = threshold - 2; j >= 0; --j) {
+                region(out, out, data + (size_t)j * m + offset, n, &xs[s]);
+            }
+        }
+    }
+
+    free(xs);
+    return ERROR_OK;
+}
+
+error_t gf256_recover(uint8_t *data, const uint8_t *const *fragments, const uint8_t *xs, size_t m, int threshold) {
+    if (threshold < 1 || threshold > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    pthread_once(&gf256_once, gf256_tables);
+
+    bool seen[256] = { false };
+    for (int k = 0; k < threshold; ++k) {
+        if (0 == xs[k] || seen[xs[k]]) {
+            return ERROR_INVALID_SHARE;
+        }
+        seen[xs[k]] = true;
+    }
+
+    // invert the Vandermonde matrix a[k][j] = x[k]^j by Gauss-Jordan on [a | 1]
+    size_t t = (size_t)threshold;
+    size_t width = 2 * t;
+    uint8_t *a = malloc(t * width);
+    gf256_coeff_t *ws = malloc(sizeof(gf256_coeff_t) * t);
+    if (NULL == a || NULL == ws) {
+        free(a);
+        free(ws);
+        return ERROR_MALLOC_FAILED;
+    }
+    for (size_t k = 0; k < t; ++k) {
+        for (size_t j = 0; j < t; ++j) {
+            a[k * width + j] = gf256_power(xs[k], (int)j);
+            a[k * width + t + j] = k == j;
+        }
+    }
+    for (size_t col = 0; col < t; ++col) {
+        size_t pivot = col;
+        while (0 == a[pivot * width + col]) {
+            ++pivot;                 // distinct x => non-singular, always found
+        }
+        if (pivot != col) {
+            for (size_t j = 0; j < width; ++j) {
+                uint8_t tmp = a[col * width + j];
+                a[col * width + j] = a[pivot * width + j];
+                a[pivot * width + j] = tmp;
+            }
+        }
+        uint8_t *row = a + col * width;
+        uint8_t d = row[col];
+        for (size_t j = 0; j < width; ++j) {
+            row[j] = gf256_divide(row[j], d);
+        }
+        for (size_t k = 0; k < t; ++k) {
+            uint8_t f = a[k * width + col];
+            if (k != col && 0 != f) {
+                for (size_t j = 0; j < width; ++j) {
+                    a[k * width + j] ^= gf256_mult(f, row[j]);
+                }
+            }
+        }
+    }
+
+    // row[j] = sum(k) inverse[j][k] * fragment[k]
+    gf256_region_t *region = gf256_region;
+    for (size_t j = 0; j < t; ++j) {
+        for (size_t k = 0; k < t; ++k) {
+            gf256_coeff(&ws[k], a[j * width + t + k]);
+        }
+        uint8_t *out = data + j * m;
+        for (size_t offset = 0; offset < m; offset += GF256_BLOCK) {
+            size_t n = m - offset < GF256_BLOCK ? m - offset : GF256_BLOCK;
+            for (size_t k = 0; k < t; ++k) {
+                region(out + offset, fragments[k] + offset, 0 == k ? NULL : out + offset, n, &ws[k]);
+            }
+        }
+    }
+
+    free(a);
+    free(ws);
+    return ERROR_OK;
+}
+
+
+// streaming
+// =========
+
+// input is gathered into whole blocks, so the random bytes are drawn
+// exactly as gf256_split draws them and the share streams are the same
+// bytes as its shares
+
+struct gf256_split_stream {
+    split_state_t state;
+    gf256_output_t *output;
+    void *data;
+    error_t err;                   // first failure, later calls just return it
+    size_t used;                   // bytes in block
+    uint8_t *block;                // GF256_BLOCK bytes of secret
+    uint8_t *outs[GF256_MAX_SHARES];  // GF256_BLOCK bytes each
+};
+
+error_t gf256_split_begin(gf256_split_stream_t **stream, int threshold, int number, const cprng_t *cprng,
+                          gf256_output_t *output, void *data) {
+    if (NULL == stream || NULL == output) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    *stream = NULL;
+    gf256_split_stream_t *st = calloc(1, sizeof(gf256_split_stream_t));
+    if (NULL == st) {
+        return ERROR_MALLOC_FAILED;
+    }
+    error_t err = split_init(&st->state, threshold, number, cprng);
+    if (ERROR_OK != err) {
+        free(st);
+        return err;
+    }
+    st->output = output;
+    st->data = data;
+
+    st->block = malloc((size_t)(number + 1) * GF256_BLOCK);
+    if (NULL == st->block) {
+        split_deinit(&st->state);
+        free(st);
+        return ERROR_MALLOC_FAILED;
+    }
+    for (int s = 0; s < number; ++s) {
+        st->outs[s] = st->block + (size_t)(s + 1) * GF256_BLOCK;
+    }
+
+    for (int s = 0; s < number && ERROR_OK == err; ++s) {
+        uint8_t header[GF256_HEADER_SIZE];
+        split_header(&st->state, header, s);
+        err = output(data, header, sizeof(header), s + 1, number);
+    }
+    st->err = err;
+    *stream = st;
+    return err;
+}
+
+// split m bytes from in and pass each share's part on
+static error_t split_stream_block(gf256_split_stream_t *st, const uint8_t *in, size_t m) {
+    error_t err = split_block(&st->state, st->outs, 0, in, m);
+    for (int s = 0; s < st->state.number && ERROR_OK == err; ++s) {
+        err = st->output(st->data, st->outs[s], m, s + 1, st->state.number);
+    }
+    return err;
+}
+
+error_t gf256_split_update(gf256_split_stream_t *stream, const void *chunk, size_t length) {
+    if (NULL == stream || (NULL == chunk && 0 != length)) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    const uint8_t *in = (const uint8_t *)chunk;
+    while (0 != length && ERROR_OK == stream->err) {
+        // whole blocks straight from the caller's buffer
+        if (0 == stream->used && length >= GF256_BLOCK) {
+            stream->err = split_stream_block(stream, in, GF256_BLOCK);
+            in += GF256_BLOCK;
+            length -= GF256_BLOCK;
+            continue;
+        }
+        size_t n = GF256_BLOCK - stream->used < length ? GF256_BLOCK - stream->used : length;
+        memcpy(stream->block + stream->used, in, n);
+        stream->used += n;
+        in += n;
+        length -= n;
+        if (GF256_BLOCK == stream->used) {
+            stream->err = split_stream_block(stream, stream->block, GF256_BLOCK);
+            stream->used = 0;
+        }
+    }
+    return stream->err;
+}
+
+error_t gf256_split_end(gf256_split_stream_t *stream) {
+    if (NULL == stream) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    error_t err = stream->err;
+    if (ERROR_OK == err && 0 != stream->used) {
+        err = split_stream_block(stream, stream->block, stream->used);
+    }
+    error_t e = split_deinit(&stream->state);
+    memset(stream->block, 0, (size_t)(stream->state.number + 1) * GF256_BLOCK);
+    free(stream->block);
+    free(stream);
+    return ERROR_OK == err ? e : err;
+}
+
+// fill buffer from share k unless it ends first, the count read
+static error_t combine_read(gf256_input_t *input, void *data, int k, uint8_t *buffer, size_t size, size_t *count) {
+    *count = 0;
+    while (*count < size) {
+        ssize_t n = input(data, k, buffer + *count, size - *count);
+        if (n < 0) {
+            return ERROR_CANNOT_READ_INPUT;
+        }
+        if (0 == n) {
+            break;
+        }
+        *count += (size_t)n;
+    }
+    return ERROR_OK;
+}
+
+error_t gf256_combine_stream(int threshold, gf256_input_t *input, gf256_output_t *output, void *data) {
+    if (NULL == input || NULL == output) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (threshold < 1 || threshold > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    pthread_once(&gf256_once, gf256_tables);
+
+    // a block of each share and one of the secret
+    size_t ws_size = sizeof(gf256_coeff_t) * (size_t)threshold;
+    gf256_coeff_t *ws = malloc(ws_size + (size_t)(threshold + 1) * GF256_BLOCK);
+    if (NULL == ws) {
+        return ERROR_MALLOC_FAILED;
+    }
+    uint8_t *out = (uint8_t *)(ws + threshold);
+    uint8_t *ys[GF256_MAX_SHARES];
+    for (int k = 0; k < threshold; ++k) {
+        ys[k] = out + (size_t)(k + 1) * GF256_BLOCK;
+    }
+
+    error_t err = ERROR_OK;
+    for (int k = 0; k < threshold && ERROR_OK == err; ++k) {
+        size_t count;
+        err = combine_read(input, data, k, ys[k], GF256_HEADER_SIZE, &count);
+        if (ERROR_OK == err && GF256_HEADER_SIZE != count) {
+            err = ERROR_SHARE_HAS_ILLEGAL_LENGTH;
+        }
+    }
+    if (ERROR_OK == err) {
+        err = combine_weights(ws, (const uint8_t *const *)ys, threshold);
+    }
+
+    while (ERROR_OK == err) {
+        size_t m = 0;
+        for (int k = 0; k < threshold && ERROR_OK == err; ++k) {
+            size_t count;
+            err = combine_read(input, data, k, ys[k], GF256_BLOCK, &count);
+            if (0 == k) {
+                m = count;
+            } else if (ERROR_OK == err && count != m) {
+                err = ERROR_SHARE_HAS_ILLEGAL_LENGTH;   // streams of different lengths
+            }
+        }
+        if (ERROR_OK != err || 0 == m) {
+            break;
+        }
+        combine_block(out, (const uint8_t *const *)ys, 0, m, ws, threshold);
+        err = output(data, out, m, 0, threshold);
+    }
+
+    memset(ws, 0, ws_size + (size_t)(threshold + 1) * GF256_BLOCK);
+    free(ws);
+    return err;
+}
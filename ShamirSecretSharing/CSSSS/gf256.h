@@ -0,0 +1,36 @@
+/*
+ *  information dispersal over the byte-wise GF(2^8) engine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_GF256_H_)
+#define _GF256_H_ 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "shamir.h"
+
+// Rabin's dispersal: data is threshold rows of m bytes, row j at
+// data + j * m, and fragment s (m bytes) holds sum(j) row[j] * x^j at
+// x = s + 1, so any threshold fragments give back all of data
+error_t gf256_disperse(uint8_t *const *fragments, const uint8_t *data, size_t m, int threshold, int number);
+
+// fragments[k] was dispersed at xs[k], which must be distinct and non-zero
+error_t gf256_recover(uint8_t *data, const uint8_t *const *fragments, const uint8_t *xs, size_t m, int threshold);
+
+#endif
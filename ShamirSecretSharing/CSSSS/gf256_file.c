@@ -0,0 +1,228 @@
+/*
+ *  byte-wise split and combine of files through memory mappings
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shamir.h"
+
+// gf256_split and gf256_combine already work a block at a time over
+// whole buffers, so handing them the mappings is the streaming engine
+// without its copies: input pages are read from the page cache where
+// they lie and the shares are dirtied in place for the kernel to write
+// back.  Outputs are allocated up front (posix_fallocate on Linux) so a
+// full disk is an error here and not a SIGBUS in the middle of a store
+
+typedef struct {
+    int fd;                        // -1 => not open
+    uint8_t *map;                  // NULL => not mapped (empty file)
+    size_t size;
+} mapping_t;
+
+static const mapping_t mapping_none = { .fd = -1, .map = NULL, .size = 0 };
+
+static error_t map_input(mapping_t *m, const char *path) {
+    *m = mapping_none;
+    m->fd = open(path, O_RDONLY);
+    if (m->fd < 0) {
+        return ERROR_CANNOT_READ_INPUT;
+    }
+    struct stat st;
+    if (0 != fstat(m->fd, &st)) {
+        return ERROR_CANNOT_READ_INPUT;
+    }
+    m->size = (size_t)st.st_size;
+    if (0 == m->size) {
+        return ERROR_OK;
+    }
+    void *p = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, m->fd, 0);
+    if (MAP_FAILED == p) {
+        return ERROR_CANNOT_READ_INPUT;
+    }
+    m->map = p;
+    madvise(p, m->size, MADV_SEQUENTIAL);
+    return ERROR_OK;
+}
+
+static error_t map_output(mapping_t *m, const char *path, size_t size) {
+    *m = mapping_none;
+    m->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (m->fd < 0) {
+        return ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    m->size = size;
+    if (0 == size) {
+        return ERROR_OK;
+    }
+#if defined(__linux__)
+    int rc = posix_fallocate(m->fd, 0, (off_t)size);
+    if (0 != rc && EINVAL != rc && EOPNOTSUPP != rc) {
+        return ERROR_CANNOT_WRITE_OUTPUT;
+    }
+#endif
+    if (0 != ftruncate(m->fd, (off_t)size)) {
+        return ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0);
+    if (MAP_FAILED == p) {
+        return ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    m->map = p;
+    madvise(p, size, MADV_SEQUENTIAL);
+    return ERROR_OK;
+}
+
+// an output is on disk before it is reported written, as bundle.c does
+static error_t unmap(mapping_t *m, bool output) {
+    error_t err = ERROR_OK;
+    if (output && NULL != m->map && 0 != msync(m->map, m->size, MS_SYNC)) {
+        err = ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    if (output && m->fd >= 0 && 0 != fdatasync(m->fd)) {
+        err = ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    if (NULL != m->map && 0 != munmap(m->map, m->size)) {
+        err = ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    if (m->fd >= 0 && 0 != close(m->fd) && output) {
+        err = ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    *m = mapping_none;
+    return err;
+}
+
+error_t gf256_split_file(const char *secret_path, gf256_share_path_t *share_path, void *data,
+                         int threshold, int number, const cprng_t *cprng) {
+    if (NULL == secret_path || NULL == share_path) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (threshold < 1 || number < threshold || number > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+
+    mapping_t *maps = malloc(sizeof(mapping_t) * (size_t)(number + 1));
+    char (*paths)[PATH_MAX] = malloc(sizeof(*paths) * (size_t)number);
+    if (NULL == maps || NULL == paths) {
+        free(maps);
+        free(paths);
+        return ERROR_MALLOC_FAILED;
+    }
+    mapping_t *secret = &maps[number];
+
+    int created = 0;
+    error_t err = map_input(secret, secret_path);
+    for (int s = 0; s < number && ERROR_OK == err; ++s) {
+        err = share_path(data, paths[s], sizeof(paths[s]), s + 1, number);
+        if (ERROR_OK == err) {
+            err = map_output(&maps[s], paths[s], gf256_share_size(secret->size));
+            created = s + 1;
+        }
+    }
+
+    if (ERROR_OK == err) {
+        uint8_t *shares[GF256_MAX_SHARES];
+        for (int s = 0; s < number; ++s) {
+            shares[s] = maps[s].map;
+        }
+        err = gf256_split(shares, secret->map, secret->size, threshold, number, cprng);
+    }
+
+    for (int s = 0; s < created; ++s) {
+        error_t e = unmap(&maps[s], true);
+        if (ERROR_OK == err) {
+            err = e;
+        }
+    }
+    unmap(secret, false);
+    if (ERROR_OK != err) {
+        for (int s = 0; s < created; ++s) {
+            unlink(paths[s]);
+        }
+    }
+
+    free(maps);
+    free(paths);
+    return err;
+}
+
+error_t gf256_combine_file(const char *secret_path, const char *const *share_paths, int threshold) {
+    if (NULL == secret_path || NULL == share_paths) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (threshold < 1 || threshold > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+
+    mapping_t *maps = malloc(sizeof(mapping_t) * (size_t)(threshold + 1));
+    if (NULL == maps) {
+        return ERROR_MALLOC_FAILED;
+    }
+    mapping_t *secret = &maps[threshold];
+    *secret = mapping_none;
+
+    int opened = 0;
+    error_t err = ERROR_OK;
+    for (int k = 0; k < threshold && ERROR_OK == err; ++k) {
+        if (NULL == share_paths[k]) {
+            err = ERROR_INPUT_IS_NULL;
+            break;
+        }
+        err = map_input(&maps[k], share_paths[k]);
+        opened = k + 1;
+        if (ERROR_OK == err && (maps[k].size < GF256_HEADER_SIZE || maps[k].size != maps[0].size)) {
+            err = ERROR_SHARE_HAS_ILLEGAL_LENGTH;
+        }
+    }
+
+    bool created = false;
+    if (ERROR_OK == err) {
+        err = map_output(secret, secret_path, maps[0].size - GF256_HEADER_SIZE);
+        created = true;
+    }
+    if (ERROR_OK == err) {
+        const uint8_t *shares[GF256_MAX_SHARES];
+        for (int k = 0; k < threshold; ++k) {
+            shares[k] = maps[k].map;
+        }
+        err = gf256_combine(secret->map, secret->size, shares, threshold);
+    }
+
+    for (int k = 0; k < opened; ++k) {
+        unmap(&maps[k], false);
+    }
+    if (created) {
+        error_t e = unmap(secret, true);
+        if (ERROR_OK == err) {
+            err = e;
+        }
+        if (ERROR_OK != err) {
+            unlink(secret_path);
+        }
+    }
+
+    free(maps);
+    return err;
+}
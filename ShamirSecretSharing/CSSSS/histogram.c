@@ -0,0 +1,353 @@
+/*
+ *  per thread HDR style latency histograms
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "shamir.h"
+#include "histogram.h"
+
+// as for the statistics: each recording thread owns a shard on a
+// lock-free list that is never pruned; a shard holds a list of series,
+// one per key the thread has seen, pushed with a release store so a
+// reader walking it sees initialised series, whose words it loads
+// relaxed while the owner keeps adding
+
+#define SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+
+typedef struct series {
+    struct series *next;
+    histogram_t histogram;
+} series_t;
+
+typedef struct histogram_shard {
+    struct histogram_shard *next;
+    series_t *series;
+    series_t *last;              // most recently recorded, checked first
+} histogram_shard_t;
+
+int histogram_on = 0;
+
+static histogram_shard_t *shards = NULL;
+static __thread histogram_shard_t *local_shard = NULL;
+
+static const char *op_names[HISTOGRAM_maximum] = {
+    [HISTOGRAM_SPLIT] = "split",
+    [HISTOGRAM_COMBINE] = "combine",
+    [HISTOGRAM_SPLIT_BATCH] = "split_batch",
+    [HISTOGRAM_COMBINE_BATCH] = "combine_batch"
+};
+
+static histogram_shard_t *shard(void) {
+    if (NULL == local_shard) {
+        histogram_shard_t *s = (histogram_shard_t *)calloc(1, sizeof(histogram_shard_t));
+        if (NULL == s) {
+            return NULL;           // this thread goes unrecorded
+        }
+        histogram_shard_t *head = __atomic_load_n(&shards, __ATOMIC_ACQUIRE);
+        do {
+            s->next = head;
+        } while (!__atomic_compare_exchange_n(&shards, &head, s, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+        local_shard = s;
+    }
+    return local_shard;
+}
+
+// thresholds are bucketed by powers of two: 2, 3..4, 5..8, ...
+static int threshold_bucket(int threshold) {
+    int limit = 2;
+    while (limit < threshold && limit < (1 << 30)) {
+        limit <<= 1;
+    }
+    return limit;
+}
+
+static series_t *find_series(histogram_shard_t *s, histogram_op_t op, unsigned int degree, int threshold) {
+    series_t *p = s->last;
+    if (NULL != p && p->histogram.op == op && p->histogram.degree == degree && p->histogram.threshold == threshold) {
+        return p;
+    }
+    for (p = s->series; NULL != p; p = p->next) {
+        if (p->histogram.op == op && p->histogram.degree == degree && p->histogram.threshold == threshold) {
+            return s->last = p;
+        }
+    }
+    p = (series_t *)calloc(1, sizeof(series_t));
+    if (NULL == p) {
+        return NULL;
+    }
+    p->histogram.op = op;
+    p->histogram.degree = degree;
+    p->histogram.threshold = threshold;
+    p->histogram.min = UINT64_MAX;
+    p->next = s->series;
+    __atomic_store_n(&s->series, p, __ATOMIC_RELEASE);
+    return s->last = p;
+}
+
+static size_t bucket_index(uint64_t value) {
+    if (value >> HISTOGRAM_VALUE_BITS) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    if (value < SUB_BUCKETS) {
+        return (size_t)value;
+    }
+    int e = 63 - __builtin_clzll(value);           // HISTOGRAM_SUB_BUCKET_BITS <= e < HISTOGRAM_VALUE_BITS
+    int shift = e - HISTOGRAM_SUB_BUCKET_BITS;
+    return (size_t)(shift + 1) * SUB_BUCKETS + (size_t)((value >> shift) - SUB_BUCKETS);
+}
+
+uint64_t histogram_bucket_limit(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    if (bucket >= HISTOGRAM_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    int shift = (int)(bucket / SUB_BUCKETS) - 1;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+// single writer, so no read-modify-write is needed
+static void add(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+void histogram_record(histogram_op_t op, unsigned int degree, int threshold, uint64_t nanoseconds) {
+    histogram_shard_t *s = shard();
+    if (NULL == s || op >= HISTOGRAM_maximum) {
+        return;
+    }
+    series_t *p = find_series(s, op, degree, threshold > 0 ? threshold_bucket(threshold) : 0);
+    if (NULL == p) {
+        return;
+    }
+    histogram_t *h = &p->histogram;
+    add(&h->buckets[bucket_index(nanoseconds)], 1);
+    add(&h->sum, nanoseconds);
+    if (nanoseconds < __atomic_load_n(&h->min, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&h->min, nanoseconds, __ATOMIC_RELAXED);
+    }
+    if (nanoseconds > __atomic_load_n(&h->max, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&h->max, nanoseconds, __ATOMIC_RELAXED);
+    }
+}
+
+void histogram_enable(bool enable) {
+    __atomic_store_n(&histogram_on, enable ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+bool histogram_enabled(void) {
+    return __atomic_load_n(&histogram_on, __ATOMIC_RELAXED);
+}
+
+static void merge(histogram_t *total, const histogram_t *h) {
+    uint64_t count = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        uint64_t n = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+        total->buckets[i] += n;
+        count += n;
+    }
+    total->count += count;
+    total->sum += __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+    uint64_t min = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    if (min < total->min) {
+        total->min = min;
+    }
+    if (max > total->max) {
+        total->max = max;
+    }
+}
+
+static int compare_series(const void *a, const void *b) {
+    const histogram_t *x = (const histogram_t *)a;
+    const histogram_t *y = (const histogram_t *)b;
+    if (x->op != y->op) {
+        return x->op < y->op ? -1 : 1;
+    }
+    if (x->degree != y->degree) {
+        return x->degree < y->degree ? -1 : 1;
+    }
+    return x->threshold < y->threshold ? -1 : x->threshold > y->threshold;
+}
+
+error_t histogram_snapshot(histogram_snapshot_t *snapshot) {
+    if (NULL == snapshot) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    snapshot->count = 0;
+    snapshot->histograms = NULL;
+    
+    size_t count = 0;
+    size_t capacity = 0;
+    histogram_t *h = NULL;
+    for (histogram_shard_t *s = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); NULL != s; s = s->next) {
+        for (series_t *p = __atomic_load_n(&s->series, __ATOMIC_ACQUIRE); NULL != p; p = p->next) {
+            size_t i = 0;
+            while (i < count && 0 != compare_series(&h[i], &p->histogram)) {
+                ++i;
+            }
+            if (i == count) {
+                if (count == capacity) {
+                    capacity = 0 == capacity ? 16 : 2 * capacity;
+                    histogram_t *grown = (histogram_t *)realloc(h, capacity * sizeof(histogram_t));
+                    if (NULL == grown) {
+                        free(h);
+                        return ERROR_MALLOC_FAILED;
+                    }
+                    h = grown;
+                }
+                memset(&h[i], 0, sizeof(histogram_t));
+                h[i].op = p->histogram.op;
+                h[i].degree = p->histogram.degree;
+                h[i].threshold = p->histogram.threshold;
+                h[i].min = UINT64_MAX;
+                ++count;
+            }
+            merge(&h[i], &p->histogram);
+        }
+    }
+    if (0 != count) {
+        qsort(h, count, sizeof(histogram_t), compare_series);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (0 == h[i].count) {
+            h[i].min = 0;
+        }
+    }
+    snapshot->count = count;
+    snapshot->histograms = h;
+    return ERROR_OK;
+}
+
+void histogram_snapshot_free(histogram_snapshot_t *snapshot) {
+    if (NULL != snapshot) {
+        free(snapshot->histograms);
+        snapshot->histograms = NULL;
+        snapshot->count = 0;
+    }
+}
+
+uint64_t histogram_percentile(const histogram_t *histogram, double percentile) {
+    if (NULL == histogram || 0 == histogram->count) {
+        return 0;
+    }
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    } else if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t limit = histogram_bucket_limit(i);
+            return limit < histogram->max ? limit : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+const char *histogram_op_name(histogram_op_t op) {
+    return op < HISTOGRAM_maximum ? op_names[op] : "unknown";
+}
+
+#define METRIC "ssss_latency_nanoseconds"
+
+error_t histogram_export(histogram_output_t *output, void *data) {
+    if (NULL == output) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    histogram_snapshot_t snapshot;
+    error_t err = histogram_snapshot(&snapshot);
+    if (ERROR_OK != err) {
+        return err;
+    }
+    char line[256];
+    int n = snprintf(line, sizeof(line), "# TYPE " METRIC " histogram\n");
+    err = output(data, line, (size_t)n);
+    for (size_t i = 0; ERROR_OK == err && i < snapshot.count; ++i) {
+        const histogram_t *h = &snapshot.histograms[i];
+        char labels[96];
+        snprintf(labels, sizeof(labels), "op=\"%s\",degree=\"%u\",threshold=\"%d\"",
+                 histogram_op_name(h->op), h->degree, h->threshold);
+        uint64_t cumulative = 0;
+        for (size_t b = 0; ERROR_OK == err && b < HISTOGRAM_BUCKETS - 1; ++b) {
+            if (0 != h->buckets[b]) {
+                cumulative += h->buckets[b];
+                n = snprintf(line, sizeof(line), METRIC "_bucket{%s,le=\"%" PRIu64 "\"} %" PRIu64 "\n",
+                             labels, histogram_bucket_limit(b), cumulative);
+                err = output(data, line, (size_t)n);
+            }
+        }
+        if (ERROR_OK == err) {
+            n = snprintf(line, sizeof(line), METRIC "_bucket{%s,le=\"+Inf\"} %" PRIu64 "\n", labels, h->count);
+            err = output(data, line, (size_t)n);
+        }
+        if (ERROR_OK == err) {
+            n = snprintf(line, sizeof(line), METRIC "_sum{%s} %" PRIu64 "\n", labels, h->sum);
+            err = output(data, line, (size_t)n);
+        }
+        if (ERROR_OK == err) {
+            n = snprintf(line, sizeof(line), METRIC "_count{%s} %" PRIu64 "\n", labels, h->count);
+            err = output(data, line, (size_t)n);
+        }
+    }
+    histogram_snapshot_free(&snapshot);
+    return err;
+}
+
+static error_t write_line(void *data, const char *text, size_t length) {
+    return length == fwrite(text, 1, length, (FILE *)data) ? ERROR_OK : ERROR_CANNOT_WRITE_OUTPUT;
+}
+
+error_t histogram_write_file(const char *path) {
+    if (NULL == path) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    // a scraper never sees a partly written file
+    size_t length = strlen(path) + sizeof(".tmp");
+    char temporary[length];
+    snprintf(temporary, length, "%s.tmp", path);
+    FILE *f = fopen(temporary, "w");
+    if (NULL == f) {
+        return ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    error_t err = histogram_export(write_line, f);
+    if (0 != fclose(f) && ERROR_OK == err) {
+        err = ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    if (ERROR_OK == err && 0 != rename(temporary, path)) {
+        err = ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    if (ERROR_OK != err) {
+        remove(temporary);
+    }
+    return err;
+}
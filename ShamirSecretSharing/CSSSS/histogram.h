@@ -0,0 +1,50 @@
+/*
+ *  recording side of the latency histogram API
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_HISTOGRAM_H_)
+#define _HISTOGRAM_H_ 1
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "shamir.h"
+#include "stats.h"
+
+// usage, as for stats_start/stats_stop:
+//
+//   uint64_t start = histogram_start();
+//   ... split ...
+//   histogram_stop(HISTOGRAM_SPLIT, degree, threshold, start);
+
+extern int histogram_on;                         // read relaxed
+
+void histogram_record(histogram_op_t op, unsigned int degree, int threshold, uint64_t nanoseconds);
+
+// zero when disabled
+static inline uint64_t histogram_start(void) {
+    return __atomic_load_n(&histogram_on, __ATOMIC_RELAXED) ? stats_clock() : 0;
+}
+
+static inline void histogram_stop(histogram_op_t op, unsigned int degree, int threshold, uint64_t start) {
+    if (0 != start) {
+        histogram_record(op, degree, threshold, stats_clock() - start);
+    }
+}
+
+#endif
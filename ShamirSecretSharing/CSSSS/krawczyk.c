@@ -0,0 +1,211 @@
+/*
+ *  computational secret sharing (Krawczyk) for large secrets
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shamir.h"
+#include "field.h"
+#include "gf256.h"
+#include "aead.h"
+
+// share layout, integers big endian:
+//
+//   0   version      KRAWCZYK_VERSION
+//   1   threshold
+//   2   x            1..number
+//   3   length       8 bytes, of the secret
+//   11  nonce        AEAD_NONCE_SIZE bytes, the same in every share
+//   23  key share    AEAD_KEY_SIZE bytes, byte-wise Shamir share at x
+//   55  fragment     fragment_size bytes of the dispersed ciphertext
+//
+// the ciphertext is the encrypted secret, its tag and zero padding to a
+// multiple of threshold; version, threshold and length are authenticated
+
+#define OFFSET_LENGTH 3
+#define OFFSET_NONCE 11
+#define OFFSET_KEY (OFFSET_NONCE + AEAD_NONCE_SIZE)
+#define AD_SIZE 10
+
+static size_t fragment_size(size_t length, int threshold) {
+    return (length + AEAD_TAG_SIZE + (size_t)threshold - 1) / (size_t)threshold;
+}
+
+size_t krawczyk_share_size(size_t length, int threshold) {
+    if (threshold < 1) {
+        return 0;
+    }
+    return KRAWCZYK_HEADER_SIZE + fragment_size(length, threshold);
+}
+
+size_t krawczyk_secret_length(const uint8_t *share) {
+    uint64_t length = 0;
+    for (int i = 0; i < 8; ++i) {
+        length = length << 8 | share[OFFSET_LENGTH + i];
+    }
+    return (size_t)length;
+}
+
+static void additional_data(uint8_t ad[AD_SIZE], const uint8_t *header) {
+    ad[0] = header[0];
+    ad[1] = header[1];
+    memcpy(ad + 2, header + OFFSET_LENGTH, 8);
+}
+
+error_t krawczyk_split(uint8_t *const *shares, const void *secret, size_t length,
+                       int threshold, int number, const cprng_t *cprng) {
+    if (NULL == shares || (NULL == secret && 0 != length)) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (threshold < 1 || number < threshold || number > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    if (NULL == cprng) {
+        cprng = &internal_cprng;
+    }
+
+    // fresh key and nonce
+    uint8_t key_nonce[AEAD_KEY_SIZE + AEAD_NONCE_SIZE];
+    void *cprng_data = NULL;
+    error_t err = cprng_init(cprng, &cprng_data);
+    if (ERROR_OK != err) {
+        return err;
+    }
+    err = cprng_bytes(cprng, cprng_data, key_nonce, sizeof(key_nonce));
+    if (ERROR_OK != err) {
+        return err;                // cprng_bytes closed the cprng
+    }
+    err = cprng_deinit(cprng, cprng_data);
+    if (ERROR_OK != err) {
+        return err;
+    }
+    const uint8_t *key = key_nonce;
+    const uint8_t *nonce = key_nonce + AEAD_KEY_SIZE;
+
+    size_t m = fragment_size(length, threshold);
+    size_t data_size = m * (size_t)threshold;
+    size_t key_share_size = gf256_share_size(AEAD_KEY_SIZE);
+    uint8_t *data = calloc(1, data_size + key_share_size * (size_t)number);
+    if (NULL == data) {
+        memset(key_nonce, 0, sizeof(key_nonce));
+        return ERROR_MALLOC_FAILED;
+    }
+    uint8_t *key_shares = data + data_size;
+
+    uint8_t *key_outs[GF256_MAX_SHARES];
+    uint8_t *fragments[GF256_MAX_SHARES];
+    for (int s = 0; s < number; ++s) {
+        uint8_t *h = shares[s];
+        h[0] = KRAWCZYK_VERSION;
+        h[1] = (uint8_t)threshold;
+        h[2] = (uint8_t)(s + 1);
+        for (int i = 0; i < 8; ++i) {
+            h[OFFSET_LENGTH + i] = (uint8_t)((uint64_t)length >> (56 - 8 * i));
+        }
+        memcpy(h + OFFSET_NONCE, nonce, AEAD_NONCE_SIZE);
+        key_outs[s] = key_shares + key_share_size * (size_t)s;
+        fragments[s] = h + KRAWCZYK_HEADER_SIZE;
+    }
+
+    uint8_t ad[AD_SIZE];
+    additional_data(ad, shares[0]);
+    aead_encrypt(data, data + length, (const uint8_t *)secret, length, ad, sizeof(ad), key, nonce);
+
+    // the key byte-wise, whose share at x goes with the fragment at x
+    err = gf256_split(key_outs, key, AEAD_KEY_SIZE, threshold, number, cprng);
+    if (ERROR_OK == err) {
+        for (int s = 0; s < number; ++s) {
+            memcpy(shares[s] + OFFSET_KEY, key_outs[s] + GF256_HEADER_SIZE, AEAD_KEY_SIZE);
+        }
+        err = gf256_disperse(fragments, data, m, threshold, number);
+    }
+
+    memset(key_nonce, 0, sizeof(key_nonce));
+    memset(key_shares, 0, key_share_size * (size_t)number);
+    free(data);
+    return err;
+}
+
+error_t krawczyk_combine(void *secret, size_t length, const uint8_t *const *shares, int threshold) {
+    if (NULL == shares || (NULL == secret && 0 != length)) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (threshold < 1 || threshold > GF256_MAX_SHARES) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+
+    uint8_t xs[GF256_MAX_SHARES];
+    for (int k = 0; k < threshold; ++k) {
+        const uint8_t *h = shares[k];
+        if (NULL == h) {
+            return ERROR_INPUT_IS_NULL;
+        }
+        if (KRAWCZYK_VERSION != h[0]) {
+            return ERROR_INVALID_SYNTAX;
+        }
+        if (threshold != h[1] || 0 != memcmp(h + OFFSET_NONCE, shares[0] + OFFSET_NONCE, AEAD_NONCE_SIZE)) {
+            return ERROR_SHARES_INCONSISTENT;
+        }
+        if (length != krawczyk_secret_length(h)) {
+            return ERROR_SHARE_HAS_ILLEGAL_LENGTH;
+        }
+        xs[k] = h[2];
+    }
+
+    size_t m = fragment_size(length, threshold);
+    size_t data_size = m * (size_t)threshold;
+    size_t key_share_size = gf256_share_size(AEAD_KEY_SIZE);
+    uint8_t *data = malloc(data_size + key_share_size * (size_t)threshold);
+    if (NULL == data) {
+        return ERROR_MALLOC_FAILED;
+    }
+    uint8_t *key_shares = data + data_size;
+
+    const uint8_t *key_ins[GF256_MAX_SHARES];
+    const uint8_t *fragments[GF256_MAX_SHARES];
+    for (int k = 0; k < threshold; ++k) {
+        uint8_t *ks = key_shares + key_share_size * (size_t)k;
+        ks[0] = GF256_VERSION;
+        ks[1] = (uint8_t)threshold;
+        ks[2] = xs[k];
+        memcpy(ks + GF256_HEADER_SIZE, shares[k] + OFFSET_KEY, AEAD_KEY_SIZE);
+        key_ins[k] = ks;
+        fragments[k] = shares[k] + KRAWCZYK_HEADER_SIZE;
+    }
+
+    uint8_t key[AEAD_KEY_SIZE];
+    error_t err = gf256_combine(key, sizeof(key), key_ins, threshold);
+    if (ERROR_OK == err) {
+        err = gf256_recover(data, fragments, xs, m, threshold);
+    }
+    if (ERROR_OK == err) {
+        uint8_t ad[AD_SIZE];
+        additional_data(ad, shares[0]);
+        if (!aead_decrypt((uint8_t *)secret, data, length, data + length, ad, sizeof(ad),
+                          key, shares[0] + OFFSET_NONCE)) {
+            err = ERROR_AUTHENTICATION_FAILED;
+        }
+    }
+
+    memset(key, 0, sizeof(key));
+    memset(key_shares, 0, key_share_size * (size_t)threshold);
+    free(data);
+    return err;
+}
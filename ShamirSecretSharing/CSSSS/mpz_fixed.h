@@ -0,0 +1,359 @@
+/*
+ *  fixed size stand-in for the GMP mpz functions used by shamir.c
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_MPZ_FIXED_H_)
+#define _MPZ_FIXED_H_ 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+#include "shamir.h"
+
+// selected by building with -DSSSS_NO_GMP
+//
+// only non-negative values of at most MAXDEGREE + 1 bits are needed (a
+// field element shifted left once, or the modulus), so every value is an
+// array of limbs with no allocation; init and clear only zero it
+//
+// limbs at and above size are always zero, so copies and clears stop at
+// size and small degrees do not pay for MAXDEGREE
+//
+// the functions follow the GMP semantics for the arguments shamir.c
+// passes, building without SSSS_NO_GMP gives the reference results
+
+#define MPZ_FIXED_LIMBS (MAXDEGREE / 64 + 1)
+
+typedef struct {
+    int size;                          // limbs that may be non-zero
+    uint64_t limb[MPZ_FIXED_LIMBS];    // least significant first
+} mpz_fixed_t;
+
+typedef mpz_fixed_t mpz_t[1];
+
+// size clamped to the limb array, so no index computed from it can leave
+// the array even for a corrupted value
+static inline int mpz_fixed_size(const mpz_t x) {
+    return x->size < 0 ? 0 : x->size > MPZ_FIXED_LIMBS ? MPZ_FIXED_LIMBS : x->size;
+}
+
+static inline void mpz_init(mpz_t x) {
+    x->size = 0;
+    memset(x->limb, 0, sizeof(x->limb));
+}
+
+static inline void mpz_clear(mpz_t x) {
+    memset(x->limb, 0, mpz_fixed_size(x) * sizeof(uint64_t));
+    x->size = 0;
+}
+
+static inline void mpz_set(mpz_t z, const mpz_t x) {
+    if (z != x) {
+        int size = mpz_fixed_size(x);
+        memcpy(z->limb, x->limb, size * sizeof(uint64_t));
+        for (int i = size; i < mpz_fixed_size(z); i++) {
+            z->limb[i] = 0;
+        }
+        z->size = size;
+    }
+}
+
+static inline void mpz_set_ui(mpz_t z, unsigned long v) {
+    for (int i = 1; i < z->size; i++) {
+        z->limb[i] = 0;
+    }
+    z->limb[0] = v;
+    z->size = 1;
+}
+
+static inline void mpz_init_set(mpz_t z, const mpz_t x) {
+    mpz_init(z);
+    mpz_set(z, x);
+}
+
+static inline void mpz_init_set_ui(mpz_t z, unsigned long v) {
+    mpz_init(z);
+    mpz_set_ui(z, v);
+}
+
+static inline void mpz_swap(mpz_t x, mpz_t y) {
+    int size = x->size > y->size ? x->size : y->size;
+    for (int i = 0; i < size; i++) {
+        uint64_t t = x->limb[i];
+        x->limb[i] = y->limb[i];
+        y->limb[i] = t;
+    }
+    size = x->size;
+    x->size = y->size;
+    y->size = size;
+}
+
+static inline int mpz_cmp_ui(const mpz_t x, unsigned long v) {
+    for (int i = x->size - 1; i > 0; i--) {
+        if (x->limb[i]) {
+            return 1;
+        }
+    }
+    uint64_t low = x->size > 0 ? x->limb[0] : 0;
+    return low > v ? 1 : low < v ? -1 : 0;
+}
+
+static inline int mpz_cmp(const mpz_t x, const mpz_t y) {
+    int size = x->size > y->size ? x->size : y->size;
+    for (int i = size - 1; i >= 0; i--) {
+        if (x->limb[i] != y->limb[i]) {
+            return x->limb[i] > y->limb[i] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+static inline int mpz_tstbit(const mpz_t x, unsigned long bit) {
+    return bit / 64 < (unsigned long)x->size ? (int)((x->limb[bit / 64] >> (bit % 64)) & 1) : 0;
+}
+
+// bits beyond MAXDEGREE + 1 cannot be held and are dropped
+static inline void mpz_setbit(mpz_t x, unsigned long bit) {
+    assert(bit / 64 < MPZ_FIXED_LIMBS);
+    if (bit / 64 >= MPZ_FIXED_LIMBS) {
+        return;
+    }
+    x->limb[bit / 64] |= (uint64_t)1 << (bit % 64);
+    if (x->size <= (int)(bit / 64)) {
+        x->size = (int)(bit / 64) + 1;
+    }
+}
+
+static inline void mpz_xor(mpz_t z, const mpz_t x, const mpz_t y) {
+    int size = x->size > y->size ? x->size : y->size;
+    for (int i = 0; i < size; i++) {
+        z->limb[i] = x->limb[i] ^ y->limb[i];
+    }
+    for (int i = size; i < z->size; i++) {
+        z->limb[i] = 0;
+    }
+    z->size = size;
+}
+
+static inline void mpz_mul_2exp(mpz_t z, const mpz_t x, unsigned long n) {
+    int words = (int)(n / 64);
+    int bits = (int)(n % 64);
+    if (0 == words && 0 != bits) {     // the common short shift, in one pass
+        uint64_t carry = 0;
+        int size = x->size;
+        for (int i = 0; i < size; i++) {
+            uint64_t v = x->limb[i];
+            z->limb[i] = (v << bits) | carry;
+            carry = v >> (64 - bits);
+        }
+        if (carry && size < MPZ_FIXED_LIMBS) {
+            z->limb[size++] = carry;
+        }
+        for (int i = size; i < z->size; i++) {
+            z->limb[i] = 0;
+        }
+        z->size = size;
+        return;
+    }
+    int size = x->size + words + (bits ? 1 : 0);
+    if (size > MPZ_FIXED_LIMBS) {
+        size = MPZ_FIXED_LIMBS;        // the bits shifted out must be zero
+    }
+    for (int i = size - 1; i >= 0; i--) {
+        int j = i - words;
+        uint64_t hi = j >= 0 && j < x->size ? x->limb[j] : 0;
+        uint64_t lo = j >= 1 && j - 1 < x->size ? x->limb[j - 1] : 0;
+        z->limb[i] = bits ? (hi << bits) | (lo >> (64 - bits)) : hi;
+    }
+    for (int i = size; i < z->size; i++) {
+        z->limb[i] = 0;
+    }
+    z->size = size;
+}
+
+// significant bits, zero for zero
+static inline size_t mpz_fixed_bits(const mpz_t x) {
+    assert(x->size <= MPZ_FIXED_LIMBS);
+    for (int i = mpz_fixed_size(x) - 1; i >= 0; i--) {
+        if (x->limb[i]) {
+            return 64 * (size_t)i + 64 - __builtin_clzll(x->limb[i]);
+        }
+    }
+    return 0;
+}
+
+// only bases 2 and 16
+static inline size_t mpz_sizeinbase(const mpz_t x, int base) {
+    size_t bits = mpz_fixed_bits(x);
+    if (0 == bits) {
+        return 1;
+    }
+    return 16 == base ? (bits + 3) / 4 : bits;
+}
+
+// words of size bytes, order 1 => most significant word first, endian
+// 1 => most significant byte first in a word (0 => native), no nails
+static inline size_t mpz_fixed_byte_position(size_t word, size_t byte, size_t count, int order, size_t size, int endian) {
+    if (0 == endian) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        endian = 1;
+#else
+        endian = -1;
+#endif
+    }
+    size_t w = order > 0 ? count - 1 - word : word;
+    size_t b = endian > 0 ? size - 1 - byte : byte;
+    return w * size + b;               // byte significance in the value
+}
+
+// limbs in the layout of the limb array, copied directly
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MPZ_FIXED_NATIVE_LIMBS(order, size, endian) (order < 0 && sizeof(uint64_t) == size && endian >= 0)
+#else
+#define MPZ_FIXED_NATIVE_LIMBS(order, size, endian) (order < 0 && sizeof(uint64_t) == size && endian <= 0)
+#endif
+
+static inline void mpz_import(mpz_t z, size_t count, int order, size_t size, int endian, size_t nails, const void *op) {
+    assert(0 == nails);
+    (void)nails;
+    const unsigned char *data = (const unsigned char *)op;
+    if (MPZ_FIXED_NATIVE_LIMBS(order, size, endian)) {
+        int limbs = count < MPZ_FIXED_LIMBS ? (int)count : MPZ_FIXED_LIMBS;  // more are not held
+        memcpy(z->limb, data, limbs * sizeof(uint64_t));
+        for (int i = limbs; i < mpz_fixed_size(z); i++) {
+            z->limb[i] = 0;
+        }
+        z->size = limbs;
+        return;
+    }
+    mpz_init(z);
+    for (size_t word = 0; word < count; word++) {
+        for (size_t byte = 0; byte < size; byte++) {
+            size_t k = mpz_fixed_byte_position(word, byte, count, order, size, endian);
+            unsigned char c = data[word * size + byte];
+            if (c) {
+                assert(k / 8 < MPZ_FIXED_LIMBS);
+                if (k / 8 >= MPZ_FIXED_LIMBS) {
+                    continue;          // more significant than any value held
+                }
+                z->limb[k / 8] |= (uint64_t)c << (8 * (k % 8));
+            }
+        }
+    }
+    z->size = (int)((count * size + 7) / 8);
+    if (z->size > MPZ_FIXED_LIMBS) {
+        z->size = MPZ_FIXED_LIMBS;
+    }
+}
+
+static inline void *mpz_export(void *rop, size_t *countp, int order, size_t size, int endian, size_t nails, const mpz_t x) {
+    assert(0 == nails);
+    (void)nails;
+    unsigned char *data = (unsigned char *)rop;
+    size_t count = (mpz_fixed_bits(x) + 8 * size - 1) / (8 * size);
+    if (MPZ_FIXED_NATIVE_LIMBS(order, size, endian)) {
+        memcpy(data, x->limb, count * sizeof(uint64_t));
+        if (NULL != countp) {
+            *countp = count;
+        }
+        return rop;
+    }
+    for (size_t word = 0; word < count; word++) {
+        for (size_t byte = 0; byte < size; byte++) {
+            size_t k = mpz_fixed_byte_position(word, byte, count, order, size, endian);
+            data[word * size + byte] = k / 8 < MPZ_FIXED_LIMBS ? (unsigned char)(x->limb[k / 8] >> (8 * (k % 8))) : 0;
+        }
+    }
+    if (NULL != countp) {
+        *countp = count;
+    }
+    return rop;
+}
+
+// base 16 only: optional white space, sign and either case; -1 if invalid
+static inline int mpz_set_str(mpz_t z, const char *s, int base) {
+    assert(16 == base);
+    (void)base;
+    mpz_init(z);
+    bool negative = false;
+    while (' ' == *s || '\t' == *s || '\n' == *s) {
+        s++;
+    }
+    if ('-' == *s) {
+        negative = true;
+        s++;
+    }
+    size_t digits = 0;
+    for (const char *p = s; *p; p++) {
+        digits += ' ' != *p && '\t' != *p && '\n' != *p;
+    }
+    if (0 == digits) {
+        return -1;
+    }
+    size_t k = digits;                 // significance of the next digit + 1
+    for (; *s; s++) {
+        int d;
+        if (*s >= '0' && *s <= '9') {
+            d = *s - '0';
+        } else if (*s >= 'a' && *s <= 'f') {
+            d = *s - 'a' + 10;
+        } else if (*s >= 'A' && *s <= 'F') {
+            d = *s - 'A' + 10;
+        } else if (' ' == *s || '\t' == *s || '\n' == *s) {
+            continue;
+        } else {
+            mpz_init(z);
+            return -1;
+        }
+        --k;
+        if (d) {
+            if (k / 16 >= MPZ_FIXED_LIMBS) {
+                mpz_init(z);
+                return -1;             // too large for any field element
+            }
+            z->limb[k / 16] |= (uint64_t)d << (4 * (k % 16));
+        }
+    }
+    z->size = (int)((digits + 15) / 16);
+    if (z->size > MPZ_FIXED_LIMBS) {
+        z->size = MPZ_FIXED_LIMBS;
+    }
+    if (negative && mpz_fixed_bits(z)) {
+        mpz_init(z);
+        return -1;                     // no negative values, callers reject them anyway
+    }
+    return 0;
+}
+
+// lower case hex, buffer must hold mpz_sizeinbase(x, 16) + 1 characters
+static inline char *mpz_get_str(char *buffer, int base, const mpz_t x) {
+    assert(16 == base && NULL != buffer);
+    (void)base;
+    size_t digits = mpz_sizeinbase(x, 16);
+    for (size_t i = 0; i < digits; i++) {
+        size_t k = digits - 1 - i;
+        buffer[i] = "0123456789abcdef"[(x->limb[k / 16] >> (4 * (k % 16))) & 15];
+    }
+    buffer[digits] = '\0';
+    return buffer;
+}
+
+#endif
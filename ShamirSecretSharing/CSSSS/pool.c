@@ -0,0 +1,382 @@
+/*
+ *  work stealing worker pool for the batch and parallel routines
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE 1   // for pthread_setaffinity_np
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "shamir.h"
+#include "pool.h"
+
+// each worker owns a range of items: it takes chunks from the low end
+// while thieves split off the high half
+typedef struct {
+    worker_pool_t *pool;
+    int index;
+    int cpu;                   // -1 => not pinned
+    pthread_t thread;
+    pthread_mutex_t lock;      // protects lo and hi
+    size_t lo;
+    size_t hi;
+} pool_worker_t;
+
+// an item submitted on its own, run by the first worker free of runs
+typedef struct pool_task {
+    pool_item_t *item;
+    void *context;
+    size_t index;
+    struct pool_task *next;
+} pool_task_t;
+
+struct worker_pool {
+    pthread_mutex_t run_lock;  // one run at a time
+    pthread_mutex_t lock;      // protects the fields below
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;  // incremented for each run
+    bool running;              // the current run still takes workers
+    int joined;                // workers that took part in the current run
+    int idle;                  // of those, the ones finished with it
+    bool shutdown;
+
+    int workers;
+    pool_worker_t *worker;
+    uint64_t chunk_cost;       // configured, zero => auto
+
+    // the current run
+    pool_item_t *item;
+    void *context;
+    const uint64_t *costs;     // NULL => all items cost 1
+    uint64_t run_chunk_cost;
+
+    // submitted items, oldest first, protected by lock
+    pool_task_t *tasks;
+    pool_task_t *tasks_tail;
+};
+
+// pool whose worker is running on this thread, used to run nested work inline
+static __thread worker_pool_t *current_pool = NULL;
+static __thread int current_worker = 0;
+
+// fewer items than this per worker are not worth splitting into chunks
+#define CHUNKS_PER_WORKER 8
+
+static uint64_t item_cost(const worker_pool_t *pool, size_t index) {
+    return NULL == pool->costs ? 1 : pool->costs[index];
+}
+
+// take the next chunk from the worker's own range
+static bool take_chunk(worker_pool_t *pool, pool_worker_t *w, size_t *lo, size_t *hi) {
+    pthread_mutex_lock(&w->lock);
+    size_t end = w->lo;
+    uint64_t cost = 0;
+    while (end < w->hi && (end == w->lo || cost < pool->run_chunk_cost)) {
+        cost += item_cost(pool, end++);
+    }
+    *lo = w->lo;
+    *hi = end;
+    w->lo = end;
+    pthread_mutex_unlock(&w->lock);
+    return *lo < *hi;
+}
+
+// move the upper half of some other worker's range to this worker
+static bool steal(worker_pool_t *pool, pool_worker_t *w) {
+    for (int i = 1; i < pool->workers; ++i) {
+        pool_worker_t *victim = &pool->worker[(w->index + i) % pool->workers];
+        pthread_mutex_lock(&victim->lock);
+        size_t remaining = victim->hi - victim->lo;
+        if (0 == remaining) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        size_t mid = victim->lo + remaining / 2;
+        size_t hi = victim->hi;
+        victim->hi = mid;
+        pthread_mutex_unlock(&victim->lock);
+
+        pthread_mutex_lock(&w->lock);
+        w->lo = mid;
+        w->hi = hi;
+        pthread_mutex_unlock(&w->lock);
+        return true;
+    }
+    return false;
+}
+
+static void drain(worker_pool_t *pool, pool_worker_t *w) {
+    do {
+        size_t lo, hi;
+        while (take_chunk(pool, w, &lo, &hi)) {
+            for (size_t i = lo; i < hi; ++i) {
+                pool->item(pool->context, i, w->index);
+            }
+        }
+    } while (steal(pool, w));
+}
+
+static void pin_to_cpu(pool_worker_t *w) {
+#if defined(__linux__)
+    if (w->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);  // best effort
+    }
+#else
+    (void)w;
+#endif
+}
+
+static void *worker_main(void *arg) {
+    pool_worker_t *w = (pool_worker_t *)arg;
+    worker_pool_t *pool = w->pool;
+    current_pool = pool;
+    current_worker = w->index;
+    pin_to_cpu(w);
+
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen && NULL == pool->tasks) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->generation != seen) {
+            seen = pool->generation;
+            if (!pool->running) {
+                continue;          // finished by the others while this ran a task
+            }
+            ++pool->joined;
+            pthread_mutex_unlock(&pool->lock);
+
+            // steals from workers still busy with tasks too, so once every
+            // worker that joined is done no item is left
+            drain(pool, w);
+
+            pthread_mutex_lock(&pool->lock);
+            if (++pool->idle == pool->joined) {
+                pthread_cond_signal(&pool->done);
+            }
+        } else if (NULL != pool->tasks) {
+            pool_task_t *task = pool->tasks;
+            pool->tasks = task->next;
+            if (NULL == pool->tasks) {
+                pool->tasks_tail = NULL;
+            }
+            pthread_mutex_unlock(&pool->lock);
+
+            task->item(task->context, task->index, w->index);
+            free(task);
+
+            pthread_mutex_lock(&pool->lock);
+        } else {
+            break;                 // shutdown, and the tasks have all run
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static int online_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : (int)n;
+}
+
+worker_pool_t *worker_pool_create(const pool_config_t *config) {
+    pool_config_t defaults = {
+        .workers = 0,
+        .cpus = NULL,
+        .cpu_count = 0,
+        .chunk_cost = 0
+    };
+    if (NULL == config) {
+        config = &defaults;
+    }
+
+    worker_pool_t *pool = (worker_pool_t *)malloc(sizeof(worker_pool_t));
+    if (NULL == pool) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(worker_pool_t));
+    pool->workers = config->workers > 0 ? config->workers : online_cpus();
+    pool->chunk_cost = config->chunk_cost;
+
+    pool->worker = (pool_worker_t *)malloc(pool->workers * sizeof(pool_worker_t));
+    if (NULL == pool->worker) {
+        free(pool);
+        return NULL;
+    }
+    memset(pool->worker, 0, pool->workers * sizeof(pool_worker_t));
+
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 0; i < pool->workers; ++i) {
+        pool_worker_t *w = &pool->worker[i];
+        w->pool = pool;
+        w->index = i;
+        w->cpu = (NULL != config->cpus && config->cpu_count > 0) ? config->cpus[i % config->cpu_count] : -1;
+        pthread_mutex_init(&w->lock, NULL);
+        if (0 != pthread_create(&w->thread, NULL, worker_main, w)) {
+            pthread_mutex_destroy(&w->lock);
+            pool->workers = i;       // only join the ones that started
+            worker_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void worker_pool_destroy(worker_pool_t *pool) {
+    if (NULL == pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->workers; ++i) {
+        pthread_join(pool->worker[i].thread, NULL);
+        pthread_mutex_destroy(&pool->worker[i].lock);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    free(pool->worker);
+    free(pool);
+}
+
+int worker_pool_size(const worker_pool_t *pool) {
+    return NULL == pool ? 1 : pool->workers;
+}
+
+bool worker_pool_submit(worker_pool_t *pool, pool_item_t *item, void *context, size_t index) {
+    if (NULL == pool || NULL == item) {
+        return false;
+    }
+    pool_task_t *task = (pool_task_t *)malloc(sizeof(pool_task_t));
+    if (NULL == task) {
+        return false;
+    }
+    task->item = item;
+    task->context = context;
+    task->index = index;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (NULL == pool->tasks_tail) {
+        pool->tasks = task;
+    } else {
+        pool->tasks_tail->next = task;
+    }
+    pool->tasks_tail = task;
+    pthread_cond_signal(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+void worker_pool_run(worker_pool_t *pool, size_t count, pool_item_t *item, pool_cost_t *cost, void *context) {
+    if (0 == count) {
+        return;
+    }
+
+    uint64_t *costs = NULL;
+    if (NULL != pool && current_pool != pool && NULL != cost) {
+        costs = (uint64_t *)malloc(count * sizeof(uint64_t));
+        if (NULL == costs) {
+            pool = NULL; // fall back to running inline
+        }
+    }
+    if (NULL == pool || current_pool == pool) {
+        int worker = NULL == pool ? 0 : current_worker;
+        for (size_t i = 0; i < count; ++i) {
+            item(context, i, worker);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->run_lock);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (NULL != costs) {
+            costs[i] = cost(context, i);
+            if (0 == costs[i]) {
+                costs[i] = 1;
+            }
+        }
+        total += NULL == costs ? 1 : costs[i];
+    }
+
+    pool->item = item;
+    pool->context = context;
+    pool->costs = costs;
+    pool->run_chunk_cost = pool->chunk_cost;
+    if (0 == pool->run_chunk_cost) {
+        pool->run_chunk_cost = total / ((uint64_t)pool->workers * CHUNKS_PER_WORKER);
+    }
+
+    // initial contiguous ranges of roughly equal cost
+    size_t lo = 0;
+    uint64_t sum = 0;
+    for (int i = 0; i < pool->workers; ++i) {
+        uint64_t target = total * (i + 1) / pool->workers;
+        size_t hi = lo;
+        while (hi < count && (i == pool->workers - 1 || sum < target)) {
+            sum += item_cost(pool, hi++);
+        }
+        pool->worker[i].lo = lo;
+        pool->worker[i].hi = hi;
+        lo = hi;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->joined = 0;
+    pool->idle = 0;
+    pool->running = true;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->start);
+    while (0 == pool->idle || pool->idle < pool->joined) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->running = false;
+    pthread_mutex_unlock(&pool->lock);
+
+    pool->item = NULL;
+    pool->context = NULL;
+    pool->costs = NULL;
+    pthread_mutex_unlock(&pool->run_lock);
+
+    free(costs);
+}
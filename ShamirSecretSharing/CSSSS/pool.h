@@ -0,0 +1,56 @@
+/*
+ *  work stealing worker pool for the batch and parallel routines
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_POOL_H_)
+#define _POOL_H_ 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "shamir.h"
+
+// process item number index (0..count-1) on worker number worker (0..size-1)
+// so that per worker scratch space can be indexed
+typedef void pool_item_t(void *context, size_t index, int worker);
+
+// estimated relative cost of item number index
+typedef uint64_t pool_cost_t(void *context, size_t index);
+
+// run items 0..count-1 on the pool and wait for all of them to finish
+// items are spread over the workers weighted by cost (NULL => all equal)
+// and idle workers steal from busy ones, including workers still running
+// a submitted item, which the run does not wait for; with a NULL pool, or when called
+// from one of the pool's own workers, the items run in the calling thread
+void worker_pool_run(worker_pool_t *pool, size_t count, pool_item_t *item, pool_cost_t *cost, void *context);
+
+// run item(context, index, worker) once on the pool without waiting for
+// it; submitted items start in submission order as workers come free of
+// runs, and the ones left at worker_pool_destroy still run; false => a
+// NULL pool or no memory
+bool worker_pool_submit(worker_pool_t *pool, pool_item_t *item, void *context, size_t index);
+
+// number of worker threads, 1 for a NULL pool
+int worker_pool_size(const worker_pool_t *pool);
+
+// estimated relative cost of batch jobs (from shamir.c)
+uint64_t split_job_cost(const split_job_t *job);
+uint64_t combine_job_cost(const combine_job_t *job);
+
+#endif
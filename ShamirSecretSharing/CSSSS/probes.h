@@ -0,0 +1,69 @@
+/*
+ *  USDT (SystemTap/DTrace style) static probes
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_PROBES_H_)
+#define _PROBES_H_ 1
+
+// provider "ssss", compiled in when <sys/sdt.h> is available (Linux with
+// systemtap-sdt-dev) unless SSSS_NO_USDT is defined; each probe is a nop
+// until a tracer attaches, elsewhere the macros expand to nothing
+//
+//   split__entry          security (0 => automatic), threshold, number
+//   split__return         degree, threshold, number, error
+//   combine__entry        threshold
+//   combine__return       degree, threshold, error
+//   restore__entry        degree, threshold
+//   restore__return       degree, threshold, result (0 => solved)
+//   cprng__entry          degree
+//   cprng__return         degree, error
+//   encode__entry         degree, mode (0 => encode, 1 => decode)
+//   encode__return        degree, mode
+//   process_share__entry  number, total
+//   process_share__return number, total, error
+//   get_share__entry      number, threshold
+//   get_share__return     number, threshold, found
+//
+// libcssss.a is static, so the probes are in each executable that links
+// it and a tracer attaches to that binary, for example ssss_bench:
+//
+//   bpftrace -e 'usdt:./ssss_bench:ssss:split__entry { @start[tid] = nsecs; }
+//                usdt:./ssss_bench:ssss:split__return /@start[tid]/ {
+//                    @ns[arg0] = hist(nsecs - @start[tid]); delete(@start[tid]); }' -c './ssss_bench -q'
+
+#if !defined(SSSS_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SSSS_USDT 1
+#endif
+#endif
+
+#if defined(SSSS_USDT)
+#define PROBE1(name, a) STAP_PROBE1(ssss, name, a)
+#define PROBE2(name, a, b) STAP_PROBE2(ssss, name, a, b)
+#define PROBE3(name, a, b, c) STAP_PROBE3(ssss, name, a, b, c)
+#define PROBE4(name, a, b, c, d) STAP_PROBE4(ssss, name, a, b, c, d)
+#else
+// arguments are referenced but never evaluated
+#define PROBE1(name, a) do { (void)sizeof(a); } while (0)
+#define PROBE2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#define PROBE4(name, a, b, c, d) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); } while (0)
+#endif
+
+#endif
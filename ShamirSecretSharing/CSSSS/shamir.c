@@ -28,16 +28,15 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <assert.h>
-
-#include "gmp.h"
+#include <pthread.h>
 
 #include "shamir.h"
-
-typedef struct {
-    unsigned int degree;
-    mpz_t poly;
-} poly_degree_t;
-
+#include "field.h"
+#include "pool.h"
+#include "field_fixed.h"
+#include "stats.h"
+#include "histogram.h"
+#include "probes.h"
 
 #define mpz_lshift(A, B, l) mpz_mul_2exp(A, B, l)
 #define mpz_sizeinbits(A) (mpz_cmp_ui(A, 0) ? mpz_sizeinbase(A, 2) : 0)
@@ -61,7 +60,10 @@ int field_size_valid(int deg) {
 
 void field_init(poly_degree_t *pd, int deg)
 {
-    // coefficients of some irreducible polynomials over GF(2)
+    // coefficients of some irreducible polynomials over GF(2), for each
+    // degree the pentanomial with the smallest k[0], then k[1], then k[2];
+    // past 1024 found and checked with Rabin's test (the same search
+    // gives the first 128 entries exactly)
     static const unsigned char irred_coeff[] = {
         4,3,1,5,3,1,4,3,1,7,3,2,5,4,3,5,3,2,7,4,2,4,3,1,10,9,3,9,4,2,7,6,2,10,9,
         6,4,3,1,5,4,3,4,3,1,7,2,1,5,3,2,7,4,2,6,3,2,5,3,2,15,3,2,11,3,2,9,8,7,7,
@@ -74,18 +76,154 @@ void field_init(poly_degree_t *pd, int deg)
         2,5,4,3,9,6,4,4,3,2,13,8,6,13,11,1,13,10,3,11,6,5,19,17,4,15,14,7,13,9,6,
         9,7,3,9,7,1,14,3,2,11,8,2,11,6,4,13,5,2,11,5,1,11,4,1,19,10,3,21,10,6,13,
         3,1,15,7,5,19,18,10,7,5,3,12,7,2,7,5,1,14,9,6,10,3,2,15,13,12,12,11,9,16,
-        9,7,12,9,3,9,5,2,17,10,6,24,9,3,17,15,13,5,4,3,19,17,8,15,6,3,19,6,1 };
+        9,7,12,9,3,9,5,2,17,10,6,24,9,3,17,15,13,5,4,3,19,17,8,15,6,3,19,6,1,
+        21,15,3,15,10,8,15,7,2,11,2,1,13,11,9,19,9,8,15,9,6,22,21,10,24,15,6,21,
+        9,6,15,8,6,13,9,6,7,3,1,9,4,2,11,9,7,15,3,2,15,11,2,12,7,2,11,9,3,5,3,2,
+        9,8,7,15,9,6,11,10,6,27,25,9,12,9,7,25,10,2,17,7,5,15,5,3,31,30,2,5,3,2,
+        16,9,7,12,7,5,23,16,6,15,14,2,20,17,15,15,14,2,12,9,3,21,11,3,8,3,2,15,
+        6,1,17,14,6,5,3,2,15,9,5,19,18,10,11,5,1,17,15,5,8,3,1,14,13,6,10,9,6,
+        11,6,2,11,10,6,14,13,7,11,3,2,9,4,2,12,9,3,11,4,1,11,10,2,9,8,6,13,11,4,
+        8,3,2,10,9,3,13,10,3,18,17,7,21,6,2,11,7,1,19,12,2,8,5,2,21,10,7,20,9,2,
+        21,19,13,12,7,5,14,11,1,15,13,1,13,4,3,13,11,5,17,15,3,7,5,1,18,13,1,19,
+        15,10,17,9,6,5,4,3,11,6,2,15,8,6,15,6,3,14,11,3,15,12,5,17,14,10,11,10,
+        5,19,14,6,19,18,2,6,3,2,8,3,2,25,6,5,10,9,3,23,21,6,17,14,3,22,5,2,19,
+        16,9,23,18,1,7,5,1,18,13,7,21,10,2,16,13,3,11,9,4,11,9,1,10,5,2,15,4,2,
+        17,13,2,26,11,2,12,11,1,20,15,10,11,3,2,17,16,7,15,10,1,27,22,18,15,14,
+        6,17,15,2,25,19,14,25,19,17,13,11,5,6,3,2,13,10,6,26,23,13,21,15,7,40,
+        35,9,7,6,2,7,2,1,19,14,13,13,12,3,17,9,2,13,10,3,4,3,1,18,11,5,19,4,2,
+        19,15,9,16,13,7,17,14,6,23,9,1,15,12,9,13,7,3,24,13,7,31,25,14,11,9,3,
+        15,8,1,11,10,5,8,5,3,20,15,5,21,16,6,24,7,2,21,19,5,19,17,4,23,7,1,9,4,
+        3,14,9,6,15,7,2,21,10,9,13,4,2,17,16,7,15,10,1,8,7,5,19,6,4,13,11,5,15,
+        9,2,15,10,8,27,26,14,23,20,2,19,10,8,13,11,8,7,5,4,21,19,1,31,13,3,20,
+        19,17,23,6,4,23,6,5,21,16,6,29,22,19,12,7,5,21,10,4,12,5,3,5,4,3,12,3,1,
+        20,5,2,23,13,9,12,3,1,19,8,6,29,21,7,31,15,13,19,9,4,21,10,9,21,20,6,28,
+        3,2,9,3,1,8,5,2,7,2,1,25,19,12,15,12,5,14,13,7,15,11,2,17,8,7,15,10,4,
+        19,5,3,23,11,9,15,8,1,19,11,5,27,21,19,18,7,1,15,9,4,21,10,6,17,15,12,
+        12,9,7,21,12,7,25,18,1,21,7,5,16,3,1,19,18,10,15,4,2,29,26,7,25,19,15,7,
+        3,2,29,21,15,12,7,2,17,14,6,15,13,1,21,19,8,15,14,10,27,18,1,20,15,9,15,
+        8,1,15,13,3,21,17,15,21,5,2,13,10,6,11,4,1,29,6,1,27,15,6,16,9,2,19,9,5,
+        24,21,11,5,3,2,5,3,2,17,13,2,12,3,2,29,27,4,21,10,3,17,9,6,23,3,1,15,12,
+        9,15,13,1,38,25,9,32,3,2,17,15,4,27,21,3,18,3,2,5,4,3,25,11,9,11,10,5,
+        21,19,16,20,13,11,33,29,14,23,9,5,17,15,1,18,17,11,30,19,11,15,12,10,23,
+        21,8,21,17,6,7,6,2,33,31,18,13,10,5,11,10,2,25,8,7,11,6,4,16,13,3,21,11,
+        3,23,19,1,12,9,7,12,3,2,15,8,1,31,26,2,17,5,2,23,10,1,16,15,6,21,18,11,
+        19,14,13,19,17,3,14,9,3,17,10,4,17,9,2,11,10,5,30,27,15,21,20,19,18,15,
+        5,7,5,1,11,9,1,21,9,3,23,13,6,14,13,6,16,15,6,28,27,1,22,15,6,25,2,1,27,
+        16,1,17,11,6,19,18,9,11,6,3,17,14,7,19,15,13,12,11,1,35,21,4,23,17,10,
+        37,35,6,32,29,3,25,18,7,12,7,5,21,14,2,15,9,6,17,3,2,21,12,10,19,10,3,
+        25,12,10,38,33,14,9,5,2,15,14,10,25,18,7,29,27,12,26,17,5,20,15,10,23,7,
+        2,17,12,11,35,24,14,19,17,8,14,13,7,32,13,11,36,33,22,14,13,1,13,12,7,
+        17,15,11,9,4,2,33,22,18,27,14,2,9,4,2,23,9,1,14,7,2,7,5,4,29,13,6,20,7,
+        5,24,23,21,29,18,4,19,13,9,19,13,2,35,13,2,27,9,1,29,18,13,39,25,3,19,
+        15,9,10,3,2,27,5,1,45,42,6,15,7,5,17,13,2,24,11,2,15,13,8,8,7,5,15,5,3,
+        31,29,28,11,6,5,29,15,2,25,18,14,36,3,1,19,5,2,27,8,6,31,18,17,24,9,6,
+        33,32,23,16,9,7,15,13,6,29,20,15,21,5,2,21,17,6,33,29,7,13,10,6,15,9,6,
+        15,7,2,27,15,1,30,13,3,23,12,1,26,17,9,31,2,1,31,29,15,15,10,1,25,13,3,
+        27,18,12,17,10,6,26,15,5,29,15,7,15,11,5,12,5,2,15,6,3,13,3,2,8,3,2,18,
+        13,7,31,6,1,11,6,2,15,13,8,15,14,5,11,8,1,17,14,5,5,4,3,14,5,2,12,7,2,
+        21,5,2,21,20,14,20,17,15,18,11,5,8,7,5,33,27,20,21,4,2,27,12,6,18,7,1,
+        27,19,17,20,19,5,37,35,3,9,8,7,31,10,6,21,19,13,25,5,3,26,21,14,11,9,8,
+        24,9,7,13,3,1,30,7,2,28,21,15,38,35,13,17,10,7,12,9,6,12,3,1,39,25,23,
+        23,13,9,25,11,7,25,14,7,34,27,18,14,13,7,22,17,6,26,19,9,19,15,9,21,16,
+        11,17,14,1,23,20,13,27,23,5,26,23,10,19,16,2,25,8,7,8,5,3,27,25,4,37,6,
+        5,27,25,23,10,9,3,13,7,6,18,17,11,11,8,1,25,16,6,24,19,9,26,21,14,15,10,
+        1,19,14,6,29,5,2,28,11,9,25,17,3,27,23,6,30,29,7,29,18,4,29,19,11,13,4,
+        2,33,31,25,25,16,3,33,30,5,25,21,2,28,27,6,27,23,21,29,22,17,24,9,2,32,
+        21,7,35,21,8,21,19,12,27,18,15,30,29,7,11,9,5,29,9,3,27,22,15,19,6,4,29,
+        11,5,25,20,6,26,25,17,42,7,1,23,16,9,15,8,6,17,15,7,21,10,3,15,12,9,33,
+        23,14,25,6,2,24,5,3,34,15,10,22,9,6,21,12,11,25,5,3,21,7,6,22,21,3,19,
+        18,13,30,13,2,42,33,9,33,27,5,24,15,6,27,25,4,15,11,5,15,8,1,35,31,13,
+        15,11,5,24,21,3,20,11,5,11,8,2,33,27,19,23,22,2,27,19,2,29,15,1,21,11,2,
+        33,27,21,27,18,1,9,5,2,16,11,9,29,18,10,13,11,1,11,10,1,8,3,2,27,6,5,22,
+        3,2,19,17,3,30,27,9,23,21,8,17,11,10,23,20,1,19,11,1,19,18,3,7,4,1,17,
+        15,4,7,3,2,33,17,3,30,23,1,34,31,19,16,15,13,37,34,23,24,15,10,43,33,15,
+        21,14,10,15,5,2,21,15,3,13,10,3,21,19,9,13,11,4,20,19,1,13,11,6,10,5,2,
+        25,18,14,20,5,3,11,10,2,15,9,8,55,46,10,33,22,7,27,23,6,13,9,7,29,20,7,
+        8,5,3,22,5,2,30,15,6,21,18,14,17,15,5,29,27,23,21,15,8,27,12,9,31,29,11,
+        26,25,10,40,17,2,41,20,11,26,21,14,27,25,14,10,9,3,32,11,2,25,24,7,25,
+        18,10,21,11,8,21,20,7,29,23,10,21,14,3,19,12,1,25,22,6,33,13,11,25,7,6,
+        43,10,1,17,15,7,23,17,10,21,18,13,23,14,2,19,8,6,23,15,6,27,11,10,19,15,
+        10,21,10,3,23,10,4,30,23,1,32,19,5,33,22,13,16,15,6,16,7,2,27,4,1,23,21,
+        14,25,23,2,37,35,25,21,14,4,18,9,6,17,7,1,29,9,2,23,21,12,30,27,15,35,
+        34,2,39,33,26,44,21,14,25,11,5,17,15,8,7,6,1,23,18,11,28,15,13,19,8,6,
+        23,10,3,20,11,2,13,11,6,35,12,1,4,3,1,34,15,2,17,7,5,26,7,1,28,27,13,38,
+        15,10,20,11,2,29,15,1,39,13,12,20,5,2,29,10,7,25,23,14,39,30,9,13,4,2,
+        17,3,1,11,10,2,18,7,2,11,10,5,17,16,7,17,10,6,9,7,5,34,25,5,35,19,10,13,
+        3,1,35,33,14,29,28,10,15,6,1,22,15,9,21,15,2,21,11,4,13,11,1,31,9,1,28,
+        27,5,34,29,7,39,34,10,37,12,3,31,12,10,29,15,7,29,18,5,26,13,7,21,18,14,
+        25,23,8,31,25,17,25,22,6,31,30,2,11,10,1,21,13,7,21,5,2,23,15,9,29,27,
+        13,37,29,11,16,7,2,25,10,9,19,15,1,27,22,6,19,13,11,19,15,1,27,25,19,37,
+        23,7,45,42,1,21,19,16,9,4,2,33,9,3,15,14,9,27,20,17,43,32,9,25,19,16,19,
+        15,1,24,15,6,26,21,5,29,7,3,55,32,9,45,19,7,11,10,6,31,26,2,12,9,7,21,8,
+        2,27,14,2,29,21,15,11,8,2,37,15,7,18,15,10,25,11,6,16,15,1,27,25,24,26,
+        25,1,37,19,13,22,5,2,21,14,10,35,32,25,14,9,3,29,22,18,30,29,17,11,5,2,
+        25,13,2,31,30,19,24,11,9,29,17,11,36,13,11,25,15,12,8,3,1,8,7,5,37,31,
+        30,23,21,8,32,21,19,14,9,3,35,32,17,19,18,9,8,3,2,27,11,9,27,26,11,33,
+        25,6,23,10,7,22,15,10,19,13,9,19,18,7,39,17,4,27,24,10,11,5,2,37,26,17,
+        27,18,16,32,5,2,27,17,13,15,10,4,35,5,2,17,15,5,19,13,2,16,3,2,33,13,3,
+        37,23,16,27,26,9,13,10,6,33,31,21,33,27,2,29,14,6,29,23,3,29,23,21,15,8,
+        1,15,12,10,35,12,9,33,14,2,17,7,4,22,21,7,41,36,19,23,10,4,37,6,4,25,23,
+        17,37,7,2,37,30,17,25,24,3,35,28,10,41,30,26,34,21,5,33,28,3,20,5,3,23,
+        18,2,19,13,11,41,22,16,31,26,9,33,27,21,19,9,5,13,3,1,35,23,9,18,13,7,
+        30,19,7,22,21,15,21,20,14,27,8,1,21,18,14,23,13,7,32,15,2,21,16,6,23,21,
+        12,45,17,2,22,21,3,19,9,7,18,13,1,42,21,14,23,13,7,17,8,3,41,21,3,15,5,
+        3,41,40,11,51,46,10,45,10,1,19,18,2,39,25,10,31,21,14,9,2,1,54,3,2,29,3,
+        2,37,33,10,30,13,7,30,23,5,39,5,1,27,9,3,35,16,6,17,16,15,15,12,10,27,
+        22,5,27,25,4,21,6,3,22,11,3,33,28,27,35,30,2,32,23,21,27,18,15,41,39,36,
+        7,4,2,47,31,29,11,10,5,25,24,10,20,3,2,39,36,14,37,19,3,33,29,23,34,31,
+        21,12,3,2,19,13,1,27,22,18,25,19,17,12,9,7,45,39,7,45,34,25,7,3,2,20,19,
+        5,23,15,5,40,23,21,14,7,1,19,13,2,19,13,12,27,13,12,44,5,3,37,18,2,26,
+        25,17,16,3,1,23,22,17,31,30,25,21,14,11,19,15,13,39,13,7,30,23,3,27,16,
+        5,27,23,9,23,11,6,39,14,11,25,10,8,32,11,2,30,23,17,15,12,2,8,3,2,25,24,
+        19,11,3,2,28,27,17,29,25,14,52,45,10,25,16,6,43,32,21,32,27,6,9,5,2 };
     
     assert(field_size_valid(deg));
+    assert(sizeof(irred_coeff) == 3 * (MAXDEGREE / 8));
+    assert(0 == memcmp(&irred_coeff[3 * (128 / 8 - 1)], "\7\2\1", 3));
+    assert(0 == memcmp(&irred_coeff[3 * (256 / 8 - 1)], "\12\5\2", 3));
+    assert(0 == memcmp(&irred_coeff[3 * (512 / 8 - 1)], "\10\5\2", 3));
     mpz_init_set_ui(pd->poly, 0);
     mpz_setbit(pd->poly, deg);
     mpz_setbit(pd->poly, irred_coeff[3 * (deg / 8 - 1) + 0]);
     mpz_setbit(pd->poly, irred_coeff[3 * (deg / 8 - 1) + 1]);
     mpz_setbit(pd->poly, irred_coeff[3 * (deg / 8 - 1) + 2]);
     mpz_setbit(pd->poly, 0);
+    memcpy(pd->k, &irred_coeff[3 * (deg / 8 - 1)], 3);
     pd->degree = deg;
 }
 
+// specialised arithmetic for the most used degrees, the coefficients
+// must match the irred_coeff entries (checked in field_init)
+FIELD_FIXED_DEFINE(128, 7, 2, 1)
+FIELD_FIXED_DEFINE(256, 10, 5, 2)
+FIELD_FIXED_DEFINE(512, 8, 5, 2)
+
+bool field_backend_available(field_backend_t backend, unsigned int degree) {
+    switch (backend) {
+        case FIELD_BACKEND_GENERIC:
+        case FIELD_BACKEND_LIMBS:
+            return true;
+        case FIELD_BACKEND_FIXED:
+            return 128 == degree || 256 == degree || 512 == degree;
+        default:
+            return false;
+    }
+}
+
+// copy a field element to limbs, false if it does not fit
+static bool to_limbs(uint64_t *limbs, int count, const mpz_t x) {
+    if (mpz_sizeinbase(x, 2) > 64 * (size_t)count) {
+        return false;
+    }
+    memset(limbs, 0, count * sizeof(uint64_t));
+    mpz_export(limbs, NULL, -1, sizeof(uint64_t), 0, 0, x);
+    return true;
+}
+
+static void from_limbs(mpz_t x, const uint64_t *limbs, int count) {
+    mpz_import(x, count, -1, sizeof(uint64_t), 0, 0, limbs);
+}
+
 void field_deinit(poly_degree_t *pd) {
     mpz_clear(pd->poly);
     pd->degree = 0;
@@ -150,10 +288,10 @@ error_t field_print(char *buffer, size_t size, const char *prefix, int format_le
     // share
     if (hexmode) {
         size_t s = mpz_sizeinbase(x, 16);
-        if (size < s + 2) {
+        if (size < (s > degree / 4 ? s : degree / 4) + 1) {  // digits padded to the degree, and '\0'
             return ERROR_BUFFER_TOO_SMALL;
         }
-        for(int i = degree / 4 - s; i; i--) {
+        for(size_t i = s; i < degree / 4; i++) {
             *buffer++ = '0';
             --size;
         }
@@ -163,7 +301,7 @@ error_t field_print(char *buffer, size_t size, const char *prefix, int format_le
         char buf[MAXDEGREE / 8 + 1];
         size_t t;
         int warn = 0;
-        memset(buf, degree / 8 + 1, 0);
+        memset(buf, 0, degree / 8 + 1);
         mpz_export(buf, &t, 1, 1, 0, 0, x);
         for(size_t i = 0; i < t; i++) {
             int printable = (buf[i] >= 32) && (buf[i] < 127);
@@ -182,6 +320,36 @@ error_t field_print(char *buffer, size_t size, const char *prefix, int format_le
     return ERROR_OK;
 }
 
+// raw bytes, most significant first, exactly degree / 8 of them so that
+// leading zero bytes are kept
+error_t field_import_bytes(const unsigned int degree, mpz_t x, const void *bytes, size_t length) {
+    if (length > degree / 8) {
+        return ERROR_INPUT_STRING_TOO_LONG;
+    }
+    if (length < degree / 8) {
+        return ERROR_INPUT_STRING_TOO_SHORT;
+    }
+    mpz_import(x, length, 1, 1, 0, 0, bytes);
+    return ERROR_OK;
+}
+
+error_t field_export_bytes(void *buffer, size_t size, const unsigned int degree, const mpz_t x) {
+    if (size < degree / 8) {
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+    uint8_t buf[MAXDEGREE / 8 + 1];
+    size_t t = 0;
+    mpz_export(buf, &t, 1, 1, 0, 0, x);
+    if (t > degree / 8) {
+        memset(buf, 0, sizeof(buf));
+        return ERROR_INVALID_SHARE;    // not a field element
+    }
+    memset(buffer, 0, degree / 8 - t);
+    memcpy((uint8_t *)buffer + degree / 8 - t, buf, t);
+    memset(buf, 0, t);
+    return ERROR_OK;
+}
+
 
 // basic field arithmetic in GF(2^deg)
 
@@ -189,10 +357,40 @@ void field_add(mpz_t z, const mpz_t x, const mpz_t y) {
     mpz_xor(z, x, y);
 }
 
+#define FIXED_MULT(N)                                                           \
+    case N:                                                                     \
+        if (to_limbs(a, N / 64, x) && to_limbs(c, N / 64, y)) {                 \
+            field##N##_mult(a, a, c);                                           \
+            from_limbs(z, a, N / 64);                                           \
+            return;                                                             \
+        }                                                                       \
+        break;
+
 void field_mult(mpz_t z, const mpz_t x, const mpz_t y, poly_degree_t *pd) {
     mpz_t b;
     unsigned int i;
     assert(z != y);
+    stats_increment(STATS_COUNT_MULT, 1);
+    uint64_t a[FIELD_LIMBS_MAX], c[FIELD_LIMBS_MAX];
+    int limbs = (pd->degree + 63) / 64;
+    switch (field_mult_backend(pd->degree)) {
+        case FIELD_BACKEND_FIXED:
+            switch (pd->degree) {
+                FIXED_MULT(128)
+                FIXED_MULT(256)
+                FIXED_MULT(512)
+            }
+            break;
+        case FIELD_BACKEND_LIMBS:
+            if (to_limbs(a, limbs, x) && to_limbs(c, limbs, y)) {
+                field_limbs_mult(a, a, c, pd->degree, pd->k);
+                from_limbs(z, a, limbs);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
     mpz_init_set(b, x);
     if (mpz_tstbit(y, 0)) {
         mpz_set(z, b);
@@ -211,10 +409,40 @@ void field_mult(mpz_t z, const mpz_t x, const mpz_t y, poly_degree_t *pd) {
     mpz_clear(b);
 }
 
+#define FIXED_INVERT(N)                                                         \
+    case N:                                                                     \
+        if (to_limbs(a, N / 64, x)) {                                           \
+            field##N##_invert(a, a);                                            \
+            from_limbs(z, a, N / 64);                                           \
+            return;                                                             \
+        }                                                                       \
+        break;
+
 void field_invert(mpz_t z, const mpz_t x, poly_degree_t *pd) {
     mpz_t u, v, g, h;
     int i;
     assert(mpz_cmp_ui(x, 0));
+    stats_increment(STATS_COUNT_INVERT, 1);
+    uint64_t a[FIELD_LIMBS_MAX];
+    int limbs = (pd->degree + 63) / 64;
+    switch (field_invert_backend(pd->degree)) {
+        case FIELD_BACKEND_FIXED:
+            switch (pd->degree) {
+                FIXED_INVERT(128)
+                FIXED_INVERT(256)
+                FIXED_INVERT(512)
+            }
+            break;
+        case FIELD_BACKEND_LIMBS:
+            if (to_limbs(a, limbs, x)) {
+                field_limbs_invert(a, a, pd->degree, pd->k);
+                from_limbs(z, a, limbs);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
     mpz_init_set(u, x);
     mpz_init_set(v, pd->poly);
     mpz_init_set_ui(g, 0);
@@ -246,17 +474,17 @@ void *internal_random_open() {
 }
 
 int internal_random_close(void *data) {
-    int fd = (int)data;
+    int fd = (int)(intptr_t)data;
     return close(fd);
 }
 
 ssize_t internal_random_read(void *data, void *buffer, size_t nbytes) {
-    int fd = (int)data;
+    int fd = (int)(intptr_t)data;
     return read(fd, buffer, nbytes);
 }
 
 // to use internal random number generator
-static const cprng_t internal_cprng = {
+const cprng_t internal_cprng = {
     .open = internal_random_open,
     .close = internal_random_close,
     .read = internal_random_read
@@ -285,24 +513,33 @@ error_t cprng_deinit(const cprng_t *cprng, void *data) {
     return ERROR_OK;
 }
 
-error_t cprng_read(const cprng_t *cprng, void *data, const unsigned int degree, mpz_t x) {
+error_t cprng_bytes(const cprng_t *cprng, void *data, void *buffer, size_t size) {
     if (NULL == cprng) {
         return ERROR_CANNOT_READ_RANDOM;
     }
-    char buf[MAXDEGREE / 8];
-    unsigned int count;
-    int n = 0;
-    for(count = 0; count < degree / 8; count += n) {
-        n = cprng->read(data, buf + count, degree / 8 - count);
-        if (n < 0) {
+    char *buf = (char *)buffer;
+    size_t count;
+    ssize_t n = 0;
+    for(count = 0; count < size; count += n) {
+        n = cprng->read(data, buf + count, size - count);
+        if (n <= 0) {
             cprng->close(data);
             return ERROR_CANNOT_READ_RANDOM;
         }
     }
-    mpz_import(x, degree / 8, 1, 1, 0, 0, buf);
     return ERROR_OK;
 }
 
+error_t cprng_read(const cprng_t *cprng, void *data, const unsigned int degree, mpz_t x) {
+    char buf[MAXDEGREE / 8];
+    error_t err = cprng_bytes(cprng, data, buf, degree / 8);
+    if (ERROR_OK == err) {
+        mpz_import(x, degree / 8, 1, 1, 0, 0, buf);
+    }
+    memset(buf, 0, degree / 8);
+    return err;
+}
+
 // a 64 bit pseudo random permutation (based on the XTEA cipher)
 
 void encipher_block(uint32_t *v) {
@@ -342,12 +579,12 @@ void encode_slice(uint8_t *data, int idx, int len,  void (*process_block)(uint32
     }
 }
 
-enum encdec {ENCODE, DECODE};
-
 void encode_mpz(const unsigned int degree, mpz_t x, enum encdec encdecmode) {
-    uint8_t v[(MAXDEGREE + 8) / 16 * 2];
+    uint8_t v[(MAXDEGREE + 8) / 16 * 2 + sizeof(uint64_t)];  // + a limb: mpz_export writes whole words
     size_t t;
     int i;
+    PROBE2(encode__entry, degree, encdecmode);
+    assert(mpz_sizeinbits(x) <= degree);
     memset(v, 0, (degree + 8) / 16 * 2);
     mpz_export(v, &t, -1, 2, 1, 0, x);
     if (degree % 16 == 8) {
@@ -368,12 +605,111 @@ void encode_mpz(const unsigned int degree, mpz_t x, enum encdec encdecmode) {
     }
     mpz_import(x, (degree + 8) / 16, -1, 2, 1, 0, v);
     assert(mpz_sizeinbits(x) <= degree);
+    PROBE2(encode__return, degree, encdecmode);
 }
 
 // evaluate polynomials efficiently
 
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+// the coefficients stay in limbs for the whole evaluation; the body is
+// inlined with a constant n for the small thresholds so the loops unroll
+#define FIXED_HORNER(N)                                                         \
+static ALWAYS_INLINE bool horner##N##_body(int n, mpz_t y, const mpz_t x, const mpz_t coeff[]) { \
+    uint64_t xl[N / 64], yl[N / 64], c[N / 64];                                 \
+    bool ok = to_limbs(xl, N / 64, x);                                          \
+    memcpy(yl, xl, sizeof(yl));                                                 \
+    for (int i = n - 1; ok && i; i--) {                                         \
+        ok = to_limbs(c, N / 64, coeff[i]);                                     \
+        for (int k = 0; k < N / 64; k++) {                                      \
+            yl[k] ^= c[k];                                                      \
+        }                                                                       \
+        field##N##_mult(yl, yl, xl);                                            \
+    }                                                                           \
+    ok = ok && to_limbs(c, N / 64, coeff[0]);                                   \
+    if (ok) {                                                                   \
+        for (int k = 0; k < N / 64; k++) {                                      \
+            yl[k] ^= c[k];                                                      \
+        }                                                                       \
+        from_limbs(y, yl, N / 64);                                              \
+    }                                                                           \
+    memset(c, 0, sizeof(c));                                                    \
+    memset(yl, 0, sizeof(yl));                                                  \
+    return ok;                                                                  \
+}                                                                               \
+                                                                                \
+static bool horner##N(int n, mpz_t y, const mpz_t x, const mpz_t coeff[]) {     \
+    switch (n) {                                                                \
+        case 2: return horner##N##_body(2, y, x, coeff);                        \
+        case 3: return horner##N##_body(3, y, x, coeff);                        \
+        case 4: return horner##N##_body(4, y, x, coeff);                        \
+        case 5: return horner##N##_body(5, y, x, coeff);                        \
+        case 6: return horner##N##_body(6, y, x, coeff);                        \
+        case 7: return horner##N##_body(7, y, x, coeff);                        \
+        case 8: return horner##N##_body(8, y, x, coeff);                        \
+        default: return horner##N##_body(n, y, x, coeff);                       \
+    }                                                                           \
+}
+
+FIXED_HORNER(128)
+FIXED_HORNER(256)
+FIXED_HORNER(512)
+
+static bool horner_limbs(int n, mpz_t y, const mpz_t x, const mpz_t coeff[], poly_degree_t *pd) {
+    int limbs = (pd->degree + 63) / 64;
+    uint64_t xl[FIELD_LIMBS_MAX], yl[FIELD_LIMBS_MAX], c[FIELD_LIMBS_MAX];
+    bool ok = to_limbs(xl, limbs, x);
+    memcpy(yl, xl, limbs * sizeof(uint64_t));
+    for (int i = n - 1; ok && i; i--) {
+        ok = to_limbs(c, limbs, coeff[i]);
+        for (int k = 0; k < limbs; k++) {
+            yl[k] ^= c[k];
+        }
+        field_limbs_mult(yl, yl, xl, pd->degree, pd->k);
+    }
+    ok = ok && to_limbs(c, limbs, coeff[0]);
+    if (ok) {
+        for (int k = 0; k < limbs; k++) {
+            yl[k] ^= c[k];
+        }
+        from_limbs(y, yl, limbs);
+    }
+    memset(c, 0, limbs * sizeof(uint64_t));
+    memset(yl, 0, limbs * sizeof(uint64_t));
+    return ok;
+}
+
 void horner(int n, mpz_t y, const mpz_t x, const mpz_t coeff[], poly_degree_t *pd) {
     int i;
+    bool done = false;
+    switch (field_mult_backend(pd->degree)) {
+        case FIELD_BACKEND_FIXED:
+            switch (pd->degree) {
+                case 128:
+                    done = horner128(n, y, x, coeff);
+                    break;
+                case 256:
+                    done = horner256(n, y, x, coeff);
+                    break;
+                case 512:
+                    done = horner512(n, y, x, coeff);
+                    break;
+            }
+            break;
+        case FIELD_BACKEND_LIMBS:
+            done = horner_limbs(n, y, x, coeff, pd);
+            break;
+        default:
+            break;
+    }
+    if (done) {
+        stats_increment(STATS_COUNT_MULT, n - 1);
+        return;
+    }
     mpz_set(y, x);
     for(i = n - 1; i; i--) {
         field_add(y, y, coeff[i]);
@@ -403,6 +739,7 @@ int restore_secret(int n, mpz_t (*A)[n], mpz_t b[], poly_degree_t *pd) {
                 }
             }
             if (! found) {
+                mpz_clear(h);
                 return -1;
             }
             for(k = i; k < n; k++) {
@@ -430,39 +767,339 @@ int restore_secret(int n, mpz_t (*A)[n], mpz_t b[], poly_degree_t *pd) {
 }
 
 
-// generate shares for a secret
-error_t split(const char *secret, process_share_t *process_share, void *data,
-                     int security, int threshold, int number, bool diffusion,
-                     const char *prefix, bool hexmode, const cprng_t *cprng) {
+// small thresholds: Lagrange interpolation at zero instead of the linear
+// system, the weights only depend on the share numbers so the last few
+// sets are kept per thread and a repeated combine costs t multiplications
+//
+// shares are y = x^t + c[t-1]x^(t-1) + ... + c[0], so the secret c[0] is
+// the sum over shares of (y + x^t) * w, w = product over the other shares of x' / (x + x')
+
+#define SMALL_THRESHOLD_MAX 8
+#define WEIGHT_CACHE_SIZE 4
+#define WEIGHT_CACHE_MAX_DEGREE 1024  // larger fields are not cached
+
+typedef struct {
+    unsigned int degree;           // zero => unused
+    int threshold;
+    int numbers[SMALL_THRESHOLD_MAX];
+    uint64_t weight[SMALL_THRESHOLD_MAX][WEIGHT_CACHE_MAX_DEGREE / 64];
+    uint64_t power[SMALL_THRESHOLD_MAX][WEIGHT_CACHE_MAX_DEGREE / 64];  // x^t
+} weight_set_t;
+
+static __thread weight_set_t weight_cache[WEIGHT_CACHE_SIZE];
+static __thread unsigned int weight_cache_next = 0;
+
+static bool small_threshold(int threshold) {
+    return threshold >= 2 && threshold <= SMALL_THRESHOLD_MAX;
+}
+
+static weight_set_t *find_weights(int t, const int numbers[], poly_degree_t *pd) {
+    for (int c = 0; c < WEIGHT_CACHE_SIZE; c++) {
+        weight_set_t *ws = &weight_cache[c];
+        if (ws->degree == pd->degree && ws->threshold == t && 0 == memcmp(ws->numbers, numbers, t * sizeof(int))) {
+            return ws;
+        }
+    }
+    return NULL;
+}
+
+// weights w and powers p = x^t for the share numbers, one inversion for
+// all weights; false if a share number is repeated
+error_t field_lagrange_weights(int t, const int numbers[], mpz_t w[], mpz_t p[], poly_degree_t *pd) {
+    if (t < 1) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    for (int i = 0; i < t; i++) {
+        for (int j = 0; j < i; j++) {
+            if (numbers[i] == numbers[j]) {
+                return ERROR_SHARES_INCONSISTENT;
+            }
+        }
+    }
     
-    mpz_t x, y, coeff[threshold];
+    mpz_t *x = (mpz_t *)malloc(3 * t * sizeof(mpz_t));
+    if (NULL == x) {
+        return ERROR_MALLOC_FAILED;
+    }
+    mpz_t *den = x + t, *prefix = x + 2 * t, h, inv;
+    mpz_init(h);
+    mpz_init(inv);
+    for (int i = 0; i < t; i++) {
+        mpz_init_set_ui(x[i], numbers[i]);
+    }
+    for (int i = 0; i < t; i++) {
+        mpz_set_ui(w[i], 1);
+        mpz_init_set_ui(den[i], 1);
+        for (int j = 0; j < t; j++) {
+            if (j != i) {
+                field_mult(w[i], w[i], x[j], pd);
+                field_add(h, x[i], x[j]);
+                field_mult(den[i], den[i], h, pd);
+            }
+        }
+        mpz_init(prefix[i]);
+        if (i) {
+            field_mult(prefix[i], prefix[i - 1], den[i], pd);
+        } else {
+            mpz_set(prefix[i], den[i]);
+        }
+        mpz_set_ui(p[i], 1);
+        for (int j = 0; j < t; j++) {
+            field_mult(p[i], p[i], x[i], pd);
+        }
+    }
     
-    if (0 == security) {
-        security = hexmode ? 4 * ((strlen(secret) + 1) & ~1): 8 * strlen(secret);
-        if (! field_size_valid(security)) {
-            return ERROR_INVALID_SECURITY_LEVEL;
+    // inv runs from 1 / (den[0] ... den[t-1]) down to 1 / den[0]
+    field_invert(inv, prefix[t - 1], pd);
+    for (int i = t - 1; i; i--) {
+        field_mult(h, inv, prefix[i - 1], pd);      // 1 / den[i]
+        field_mult(w[i], w[i], h, pd);
+        field_mult(inv, inv, den[i], pd);
+    }
+    field_mult(w[0], w[0], inv, pd);
+    
+    for (int i = 0; i < t; i++) {
+        mpz_clear(x[i]);
+        mpz_clear(den[i]);
+        mpz_clear(prefix[i]);
+    }
+    free(x);
+    mpz_clear(h);
+    mpz_clear(inv);
+    return ERROR_OK;
+}
+
+// field_lagrange_weights through the per thread cache, t <= SMALL_THRESHOLD_MAX
+static bool lagrange_weights(int t, const int numbers[], mpz_t w[], mpz_t p[], poly_degree_t *pd) {
+    int limbs = (pd->degree + 63) / 64;
+    weight_set_t *ws = pd->degree <= WEIGHT_CACHE_MAX_DEGREE ? find_weights(t, numbers, pd) : NULL;
+    if (NULL != ws) {
+        for (int i = 0; i < t; i++) {
+            from_limbs(w[i], ws->weight[i], limbs);
+            from_limbs(p[i], ws->power[i], limbs);
+        }
+        return true;
+    }
+    if (ERROR_OK != field_lagrange_weights(t, numbers, w, p, pd)) {
+        return false;
+    }
+    if (pd->degree <= WEIGHT_CACHE_MAX_DEGREE) {
+        ws = &weight_cache[weight_cache_next++ % WEIGHT_CACHE_SIZE];
+        ws->degree = pd->degree;
+        ws->threshold = t;
+        memcpy(ws->numbers, numbers, t * sizeof(int));
+        for (int i = 0; i < t; i++) {
+            to_limbs(ws->weight[i], limbs, w[i]);
+            to_limbs(ws->power[i], limbs, p[i]);
         }
     }
+    return true;
+}
+
+// same contract as restore_secret for 2 <= n <= SMALL_THRESHOLD_MAX,
+// the share numbers must be field elements
+static int restore_small(int n, const int numbers[], mpz_t b[], poly_degree_t *pd) {
+    mpz_t w[n], p[n], h, sum;
+    for (int i = 0; i < n; i++) {
+        mpz_init(w[i]);
+        mpz_init(p[i]);
+    }
+    mpz_init(h);
+    mpz_init_set_ui(sum, 0);
+    
+    int result = -1;
+    if (lagrange_weights(n, numbers, w, p, pd)) {
+        for (int i = 0; i < n; i++) {
+            field_add(b[i], b[i], p[i]);
+            field_mult(h, b[i], w[i], pd);
+            field_add(sum, sum, h);
+        }
+        mpz_set(b[n - 1], sum);
+        result = 0;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        mpz_clear(w[i]);
+        mpz_clear(p[i]);
+    }
+    mpz_clear(h);
+    mpz_clear(sum);
+    return result;
+}
+
+// parallel share evaluation: workers evaluate disjoint share numbers
+// with their own scratch values
+
+typedef struct {
+    const mpz_t *coeff;
+    int threshold;
+    int number;
+    poly_degree_t *pd;
+    const char *prefix;
+    unsigned int format_length;
+    process_share_t *process_share;
+    void *data;
+    mpz_t *x;                      // scratch, one per worker
+    mpz_t *y;                      // ..
+    bool ordered;
+    // reorder buffer, only for ordered delivery
+    pthread_mutex_t lock;
+    char *slot;                    // formatted shares waiting for delivery
+    size_t slot_size;              // SHARE_LINELEN of the degree
+    bool *ready;                   // slot is filled
+    int next;                      // next share to deliver (0 based)
+} share_eval_t;
+
+static void evaluate_share(void *context, size_t index, int worker) {
+    share_eval_t *se = (share_eval_t *)context;
+    int i = (int)index;
+    
+    mpz_set_ui(se->x[worker], i + 1);
+    uint64_t start = stats_start();
+    horner(se->threshold, se->y[worker], se->x[worker], se->coeff, se->pd);
+    stats_stop(STATS_EVALUATE, start);
+    
+    if (! se->ordered) {
+        char buffer[MAXLINELEN];
+        start = stats_start();
+        error_t err = field_print(buffer, sizeof(buffer), se->prefix, se->format_length, i + 1, se->pd->degree, se->y[worker], true);
+        stats_stop(STATS_PRINT, start);
+        if (ERROR_OK == err) {
+            start = stats_start();
+            PROBE2(process_share__entry, i + 1, se->number);
+            error_t result = se->process_share(se->data, buffer, strlen(buffer), i + 1, se->number);
+            PROBE3(process_share__return, i + 1, se->number, result);
+            stats_stop(STATS_CALLBACK, start);
+        }
+        memset(buffer, 0, sizeof(buffer));
+        return;
+    }
+    
+    start = stats_start();
+    char *slot = se->slot + i * se->slot_size;
+    bool ok = ERROR_OK == field_print(slot, se->slot_size, se->prefix, se->format_length, i + 1, se->pd->degree, se->y[worker], true);
+    stats_stop(STATS_PRINT, start);
+    if (! ok) {
+        slot[0] = '\0';  // nothing to deliver
+    }
+    
+    // deliver this and any following shares that are already waiting
+    pthread_mutex_lock(&se->lock);
+    se->ready[i] = true;
+    while (se->next < se->number && se->ready[se->next]) {
+        char *buffer = se->slot + se->next * se->slot_size;
+        size_t length = strlen(buffer);
+        if (0 != length) {
+            start = stats_start();
+            PROBE2(process_share__entry, se->next + 1, se->number);
+            error_t result = se->process_share(se->data, buffer, length, se->next + 1, se->number);
+            PROBE3(process_share__return, se->next + 1, se->number, result);
+            stats_stop(STATS_CALLBACK, start);
+        }
+        memset(buffer, 0, se->slot_size);
+        ++se->next;
+    }
+    pthread_mutex_unlock(&se->lock);
+}
+
+static error_t evaluate_shares(worker_pool_t *pool, bool ordered, const mpz_t coeff[], int threshold, int number,
+                               poly_degree_t *pd, const char *prefix, unsigned int format_length,
+                               process_share_t *process_share, void *data) {
+    int workers = worker_pool_size(pool);
+    share_eval_t se = {
+        .coeff = coeff,
+        .threshold = threshold,
+        .number = number,
+        .pd = pd,
+        .prefix = prefix,
+        .format_length = format_length,
+        .process_share = process_share,
+        .data = data,
+        .ordered = ordered,
+        .slot_size = SHARE_LINELEN(pd->degree),
+        .next = 0
+    };
+    se.x = (mpz_t *)malloc(workers * sizeof(mpz_t));
+    se.y = (mpz_t *)malloc(workers * sizeof(mpz_t));
+    if (ordered) {
+        se.slot = (char *)calloc(number, se.slot_size);
+        se.ready = (bool *)calloc(number, sizeof(bool));
+    }
+    if (NULL == se.x || NULL == se.y || (ordered && (NULL == se.slot || NULL == se.ready))) {
+        free(se.x);
+        free(se.y);
+        free(se.slot);
+        free(se.ready);
+        return ERROR_MALLOC_FAILED;
+    }
+    for (int w = 0; w < workers; ++w) {
+        mpz_init(se.x[w]);
+        mpz_init(se.y[w]);
+    }
+    pthread_mutex_init(&se.lock, NULL);
+    
+    worker_pool_run(pool, number, evaluate_share, NULL, &se);
+    
+    pthread_mutex_destroy(&se.lock);
+    for (int w = 0; w < workers; ++w) {
+        mpz_clear(se.x[w]);
+        mpz_clear(se.y[w]);
+    }
+    free(se.x);
+    free(se.y);
+    free(se.slot);     // all slots were cleared on delivery
+    free(se.ready);
+    return ERROR_OK;
+}
+
+
+// how split takes and combine returns the secret
+typedef enum {
+    SECRET_ASCII,
+    SECRET_HEX,
+    SECRET_BINARY                  // length raw bytes, split at 8 * length bits
+} secret_format_t;
+
+#define TEXT_FORMAT(hexmode) ((hexmode) ? SECRET_HEX : SECRET_ASCII)
+
+// generate shares for a secret
+static error_t split_polynomial(const void *secret, size_t length, process_share_t *process_share, void *data,
+                                int security, int threshold, int number, bool diffusion,
+                                const char *prefix, secret_format_t format, const cprng_t *cprng,
+                                worker_pool_t *pool, bool ordered, unsigned *degree) {
+    
+    mpz_t coeff[threshold];
+    int initialised = 0;           // coeff[0..initialised) to clear
     
     unsigned int format_length = 0;
     int i = 0;
     for(format_length = 1, i = number; i >= 10; i /= 10, ++format_length) {
     }
     
+    stats_increment(STATS_COUNT_SPLIT, 1);
+    
     poly_degree_t pd;
     field_init(&pd, security);
+    *degree = pd.degree;
     
     mpz_init(coeff[0]);
-    error_t err = field_import(pd.degree, coeff[0], secret, hexmode);
+    initialised = 1;
+    uint64_t start = stats_start();
+    error_t err = SECRET_BINARY == format ? field_import_bytes(pd.degree, coeff[0], secret, length)
+                                          : field_import(pd.degree, coeff[0], secret, SECRET_HEX == format);
+    stats_stop(STATS_IMPORT, start);
     if (ERROR_OK != err) {
-        return err;
+        goto cleanup;
     }
     
     if (diffusion) {
         if (pd.degree >= 64) {
+            start = stats_start();
             encode_mpz(pd.degree, coeff[0], ENCODE);
+            stats_stop(STATS_DIFFUSION, start);
         } else {
-            return ERROR_SECURITY_LEVEL_TOO_SMALL_FOR_DIFFUSION;
+            err = ERROR_SECURITY_LEVEL_TOO_SMALL_FOR_DIFFUSION;
+            goto cleanup;
         }
     }
     
@@ -473,126 +1110,485 @@ error_t split(const char *secret, process_share_t *process_share, void *data,
     void *cprng_data = NULL;
     err = cprng_init(cprng, &cprng_data);
     if (ERROR_OK != err) {
-        return err;
+        goto cleanup;
     }
     
     for(int i = 1; i < threshold; i++) {
         mpz_init(coeff[i]);
+        initialised = i + 1;
+        start = stats_start();
+        PROBE1(cprng__entry, pd.degree);
         err = cprng_read(cprng, cprng_data, pd.degree, coeff[i]);
+        PROBE2(cprng__return, pd.degree, err);
+        stats_stop(STATS_CPRNG, start);
         if (ERROR_OK != err) {
-            return err;
+            goto cleanup;          // cprng_read closed the cprng
         }
     }
     err = cprng_deinit(cprng, cprng_data);
     if (ERROR_OK != err) {
-        return err;
+        goto cleanup;
     }
     
-    mpz_init(x);
-    mpz_init(y);
-    for(int i = 0; i < number; i++) {
-        mpz_set_ui(x, i + 1);
-        horner(threshold, y, x, (const mpz_t*)coeff, &pd);
-        char buffer[MAXLINELEN];
-        err = field_print(buffer, sizeof(buffer), prefix, format_length, i + 1, pd.degree, y, true);
-        if (ERROR_OK == err) {
-            process_share(data, buffer, strlen(buffer), i + 1, number);
+    if (NULL == pool) {
+        mpz_t x, y;
+        mpz_init(x);
+        mpz_init(y);
+        for(int i = 0; i < number; i++) {
+            mpz_set_ui(x, i + 1);
+            start = stats_start();
+            horner(threshold, y, x, (const mpz_t*)coeff, &pd);
+            stats_stop(STATS_EVALUATE, start);
+            char buffer[MAXLINELEN];
+            start = stats_start();
+            err = field_print(buffer, sizeof(buffer), prefix, format_length, i + 1, pd.degree, y, true);
+            stats_stop(STATS_PRINT, start);
+            if (ERROR_OK == err) {
+                start = stats_start();
+                PROBE2(process_share__entry, i + 1, number);
+                error_t result = process_share(data, buffer, strlen(buffer), i + 1, number);
+                PROBE3(process_share__return, i + 1, number, result);
+                stats_stop(STATS_CALLBACK, start);
+            }
         }
+        mpz_clear(x);
+        mpz_clear(y);
+        err = ERROR_OK;
+    } else {
+        err = evaluate_shares(pool, ordered, (const mpz_t*)coeff, threshold, number, &pd,
+                              prefix, format_length, process_share, data);
     }
-    mpz_clear(x);
-    mpz_clear(y);
     
-    for(int i = 0; i < threshold; i++) {
+cleanup:
+    for(int i = 0; i < initialised; i++) {
         mpz_clear(coeff[i]);
     }
     field_deinit(&pd);
     
-    return ERROR_OK;
+    return err;
+}
+
+static error_t split_shares(const void *secret, size_t length, process_share_t *process_share, void *data,
+                            int security, int threshold, int number, bool diffusion,
+                            const char *prefix, secret_format_t format, const cprng_t *cprng,
+                            worker_pool_t *pool, bool ordered) {
+    
+    unsigned degree = 0;
+    error_t err = ERROR_OK;
+    uint64_t start = histogram_start();
+    
+    PROBE3(split__entry, security, threshold, number);
+    if (threshold < 1 || number < threshold) {
+        err = ERROR_INVALID_THRESHOLD;
+    } else if (SECRET_BINARY == format) {
+        security = length <= MAXDEGREE / 8 ? 8 * (int)length : 0;
+        if (! field_size_valid(security)) {
+            err = ERROR_INVALID_SECURITY_LEVEL;
+        }
+    } else if (0 == security) {
+        security = SECRET_HEX == format ? 4 * ((strlen(secret) + 1) & ~1): 8 * strlen(secret);
+        if (! field_size_valid(security)) {
+            err = ERROR_INVALID_SECURITY_LEVEL;
+        }
+    }
+    if (ERROR_OK == err) {
+        err = split_polynomial(secret, length, process_share, data, security, threshold, number, diffusion,
+                               prefix, format, cprng, pool, ordered, &degree);
+    }
+    PROBE4(split__return, degree, threshold, number, err);
+    if (0 != degree) {
+        histogram_stop(HISTOGRAM_SPLIT, degree, threshold, start);
+    }
+    
+    return err;
+}
+
+
+error_t split(const char *secret, process_share_t *process_share, void *data,
+                     int security, int threshold, int number, bool diffusion,
+                     const char *prefix, bool hexmode, const cprng_t *cprng) {
+    return split_shares(secret, 0, process_share, data, security, threshold, number, diffusion, prefix, TEXT_FORMAT(hexmode), cprng, NULL, false);
+}
+
+error_t split_binary(const void *secret, size_t length, process_share_t *process_share, void *data,
+                     int threshold, int number, bool diffusion, const char *prefix, const cprng_t *cprng) {
+    if (NULL == secret) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    return split_shares(secret, length, process_share, data, 0, threshold, number, diffusion, prefix, SECRET_BINARY, cprng, NULL, false);
+}
+
+error_t split_parallel(const char *secret, process_share_t *process_share, void *data,
+                       int security, int threshold, int number, bool diffusion,
+                       const char *prefix, bool hexmode, const cprng_t *cprng,
+                       worker_pool_t *pool, bool ordered) {
+    if (NULL == pool) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    return split_shares(secret, 0, process_share, data, security, threshold, number, diffusion, prefix, TEXT_FORMAT(hexmode), cprng, pool, ordered);
 }
 
 
 // calculate the secret from shares
 
-EXPORT error_t combine(char *secret, size_t secret_size, read_share_t *get_share, void *data, int threshold, bool diffusion, bool hexmode) {
+// fetch share number i into buffer and split it into its number (a) and value (b)
+static error_t fetch_share(char buffer[MAXLINELEN], char **a, char **b, read_share_t *get_share, void *data, int i, int threshold) {
+    uint64_t start = stats_start();
+    PROBE2(get_share__entry, i, threshold);
+    const char *input = get_share(data, i, threshold, MAXLINELEN - 1);
+    PROBE3(get_share__return, i, threshold, NULL != input);
+    stats_stop(STATS_CALLBACK, start);
+    if (NULL == input) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    strncpy(buffer, input, MAXLINELEN);
+    buffer[MAXLINELEN - 1] = '\0'; // ensure null terminated
+    buffer[strcspn(buffer, "\r\n")] = '\0';
+    
+    if (! (*a = strchr(buffer, '-'))) {
+        return ERROR_INVALID_SYNTAX;
+    }
+    *(*a)++ = 0;
+    if ((*b = strchr(*a, '-'))) {
+        *(*b)++ = 0;
+    } else {
+        *b = *a, *a = buffer;
+    }
+    return ERROR_OK;
+}
+
+static error_t combine_shares(void *secret, size_t secret_size, read_share_t *get_share, void *data, int threshold, bool diffusion, secret_format_t format, unsigned *degree) {
     
-    mpz_t A[threshold][threshold], y[threshold], x;
+    mpz_t (*A)[threshold] = NULL, y[threshold], x;    // A on the heap, large for MAXDEGREE
+    int numbers[threshold];
+    bool small = small_threshold(threshold);
     unsigned s = 0;
+    int imported = 0;              // y[0..imported) initialised
+    int columns = 0;               // A[..][0..columns) initialised
+    error_t err = ERROR_OK;
     
-    poly_degree_t pd;
+    poly_degree_t pd = { .degree = 0 };
     
+    if (threshold < 1) {
+        return ERROR_INVALID_THRESHOLD;
+    }
+    stats_increment(STATS_COUNT_COMBINE, 1);
     mpz_init(x);
     
     for (int i = 0; i < threshold; i++) {
         
         char buffer[MAXLINELEN];
-        const char *input = get_share(data, i + 1, threshold, sizeof(buffer) - 1);
-        if (NULL == input) {
-            return ERROR_INPUT_IS_NULL;
-        }
-        strncpy(buffer, input, sizeof(buffer));
-        buffer[sizeof(buffer) - 1] = '\0'; // ensure null terminated
-        buffer[strcspn(buffer, "\r\n")] = '\0';
-        
         char *a, *b;
-        
-        if (! (a = strchr(buffer, '-'))) {
-            return ERROR_INVALID_SYNTAX;
-        }
-        *a++ = 0;
-        if ((b = strchr(a, '-'))) {
-            *b++ = 0;
-        } else {
-            b = a, a = buffer;
+        err = fetch_share(buffer, &a, &b, get_share, data, i + 1, threshold);
+        if (ERROR_OK != err) {
+            goto cleanup;
         }
         if (! s) {
             s = 4 * strlen(b);
             if (! field_size_valid(s)) {
-                return ERROR_SHARE_HAS_ILLEGAL_LENGTH;
+                err = ERROR_SHARE_HAS_ILLEGAL_LENGTH;
+                goto cleanup;
             }
             field_init(&pd, s);
+            *degree = pd.degree;
+            if (RESTORE_GAUSS == field_restore(pd.degree)) {
+                small = false;
+            }
         } else {
             if (s != 4 * strlen(b)) {
-                return ERROR_SHARES_HAVE_DIFFERENT_SECURITY_LEVELS;
+                err = ERROR_SHARES_HAVE_DIFFERENT_SECURITY_LEVELS;
+                goto cleanup;
             }
         }
-        int j;
-        if (! (j = atoi(a))) {
-            return ERROR_INVALID_SHARE;
+        if (! (numbers[i] = atoi(a))) {
+            err = ERROR_INVALID_SHARE;
+            goto cleanup;
         }
-        mpz_set_ui(x, j);
-        mpz_init_set_ui(A[threshold - 1][i], 1);
-        for(j = threshold - 2; j >= 0; j--) {
-            mpz_init(A[j][i]);
-            field_mult(A[j][i], A[j + 1][i], x, &pd);
+        mpz_set_ui(x, numbers[i]);
+        if (mpz_sizeinbase(x, 2) > pd.degree) {
+            small = false;         // not a field element, leave it to the linear system
         }
         mpz_init(y[i]);
+        imported = i + 1;
+        uint64_t start = stats_start();
         field_import(pd.degree, y[i], b, 1);
-        field_mult(x, x, A[0][i], &pd);
-        field_add(y[i], y[i], x);
+        stats_stop(STATS_IMPORT, start);
     }
-    mpz_clear(x);
-    if (restore_secret(threshold, A, y, &pd)) {
-        return ERROR_SHARES_INCONSISTENT;
+    uint64_t start = stats_start();
+    PROBE2(restore__entry, pd.degree, threshold);
+    if (small) {
+        int result = restore_small(threshold, numbers, y, &pd);
+        PROBE3(restore__return, pd.degree, threshold, result);
+        if (result) {
+            err = ERROR_SHARES_INCONSISTENT;
+            goto cleanup;
+        }
+    } else {
+        A = malloc(threshold * sizeof(*A));
+        if (NULL == A) {
+            err = ERROR_MALLOC_FAILED;
+            goto cleanup;
+        }
+        for (int i = 0; i < threshold; i++) {
+            mpz_set_ui(x, numbers[i]);
+            mpz_init_set_ui(A[threshold - 1][i], 1);
+            for(int j = threshold - 2; j >= 0; j--) {
+                mpz_init(A[j][i]);
+                field_mult(A[j][i], A[j + 1][i], x, &pd);
+            }
+            columns = i + 1;
+            field_mult(x, x, A[0][i], &pd);
+            field_add(y[i], y[i], x);
+        }
+        int result = restore_secret(threshold, A, y, &pd);
+        PROBE3(restore__return, pd.degree, threshold, result);
+        if (result) {
+            err = ERROR_SHARES_INCONSISTENT;
+            goto cleanup;
+        }
     }
+    stats_stop(STATS_RESTORE, start);
     if (diffusion) {
         if (pd.degree >= 64) {
+            start = stats_start();
             encode_mpz(pd.degree, y[threshold - 1], DECODE);
+            stats_stop(STATS_DIFFUSION, start);
         } else {
-            return ERROR_SECURITY_LEVEL_TOO_SMALL_FOR_DIFFUSION;
-            
+            err = ERROR_SECURITY_LEVEL_TOO_SMALL_FOR_DIFFUSION;
+            goto cleanup;
         }
     }
     
-    error_t err = field_print(secret, secret_size, NULL, 0, 0, pd.degree, y[threshold - 1], hexmode);
+    start = stats_start();
+    err = SECRET_BINARY == format ? field_export_bytes(secret, secret_size, pd.degree, y[threshold - 1])
+                                  : field_print(secret, secret_size, NULL, 0, 0, pd.degree, y[threshold - 1], SECRET_HEX == format);
+    stats_stop(STATS_PRINT, start);
     
-    // clean up
+cleanup:
     for (int i = 0; i < threshold; i++) {
-        for (int j = 0; j < threshold; j++) {
+        for (int j = 0; j < columns; j++) {
             mpz_clear(A[i][j]);
         }
+    }
+    for (int i = 0; i < imported; i++) {
         mpz_clear(y[i]);
     }
-    field_deinit(&pd);
+    mpz_clear(x);
+    free(A);
+    if (0 != pd.degree) {
+        field_deinit(&pd);
+    }
+    
+    return err;
+}
+
+static error_t combine_secret(void *secret, size_t secret_size, read_share_t *get_share, void *data, int threshold, bool diffusion, secret_format_t format, unsigned *degree) {
+    uint64_t start = histogram_start();
+    PROBE1(combine__entry, threshold);
+    error_t err = combine_shares(secret, secret_size, get_share, data, threshold, diffusion, format, degree);
+    PROBE3(combine__return, *degree, threshold, err);
+    if (0 != *degree) {
+        histogram_stop(HISTOGRAM_COMBINE, *degree, threshold, start);
+    }
+    return err;
+}
+
+EXPORT error_t combine(char *secret, size_t secret_size, read_share_t *get_share, void *data, int threshold, bool diffusion, bool hexmode) {
+    unsigned degree = 0;
+    return combine_secret(secret, secret_size, get_share, data, threshold, diffusion, TEXT_FORMAT(hexmode), &degree);
+}
+
+EXPORT error_t combine_binary(void *secret, size_t secret_size, size_t *length, read_share_t *get_share, void *data, int threshold, bool diffusion) {
+    unsigned degree = 0;
+    if (NULL == secret || NULL == length) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    error_t err = combine_secret(secret, secret_size, get_share, data, threshold, diffusion, SECRET_BINARY, &degree);
+    *length = ERROR_OK == err ? degree / 8 : 0;
+    return err;
+}
+
+
+// parallel reconstruction: Lagrange interpolation at zero with the
+// weights and the multiply-accumulate spread over the workers
+//
+// shares are y = x^t + c[t-1]x^(t-1) + ... + c[0], so the secret c[0] is
+// the sum over shares of (y + x^t) * w, w = product over the other shares of x' / (x + x')
+
+typedef struct {
+    int threshold;
+    const mpz_t *x;                // share numbers
+    const mpz_t *y;                // share values
+    poly_degree_t *pd;
+    mpz_t *sum;                    // partial sums, one per worker
+    mpz_t *scratch;                // three per worker
+} lagrange_t;
+
+static void lagrange_term(void *context, size_t index, int worker) {
+    lagrange_t *lt = (lagrange_t *)context;
+    int i = (int)index;
+    mpz_t *num = &lt->scratch[3 * worker];
+    mpz_t *den = &lt->scratch[3 * worker + 1];
+    mpz_t *h = &lt->scratch[3 * worker + 2];
+    
+    mpz_set_ui(*num, 1);
+    mpz_set_ui(*den, 1);
+    for (int j = 0; j < lt->threshold; j++) {
+        if (j != i) {
+            field_mult(*num, *num, lt->x[j], lt->pd);
+            field_add(*h, lt->x[i], lt->x[j]);
+            field_mult(*den, *den, *h, lt->pd);
+        }
+    }
+    field_invert(*h, *den, lt->pd);
+    field_mult(*num, *num, *h, lt->pd);    // num is now the weight
+    
+    // h = y + x^t
+    mpz_set_ui(*h, 1);
+    for (int j = 0; j < lt->threshold; j++) {
+        field_mult(*h, *h, lt->x[i], lt->pd);
+    }
+    field_add(*h, *h, lt->y[i]);
+    
+    field_mult(*den, *h, *num, lt->pd);
+    field_add(lt->sum[worker], lt->sum[worker], *den);
+}
+
+static error_t combine_lagrange(mpz_t result, int threshold, const mpz_t x[], const mpz_t y[], poly_degree_t *pd, worker_pool_t *pool) {
+    int workers = worker_pool_size(pool);
+    lagrange_t lt = {
+        .threshold = threshold,
+        .x = x,
+        .y = y,
+        .pd = pd
+    };
+    lt.sum = (mpz_t *)malloc(workers * sizeof(mpz_t));
+    lt.scratch = (mpz_t *)malloc(3 * workers * sizeof(mpz_t));
+    if (NULL == lt.sum || NULL == lt.scratch) {
+        free(lt.sum);
+        free(lt.scratch);
+        return ERROR_MALLOC_FAILED;
+    }
+    for (int w = 0; w < workers; ++w) {
+        mpz_init_set_ui(lt.sum[w], 0);
+    }
+    for (int k = 0; k < 3 * workers; ++k) {
+        mpz_init(lt.scratch[k]);
+    }
+    
+    worker_pool_run(pool, threshold, lagrange_term, NULL, &lt);
+    
+    mpz_set_ui(result, 0);
+    for (int w = 0; w < workers; ++w) {
+        field_add(result, result, lt.sum[w]);
+        mpz_clear(lt.sum[w]);
+    }
+    for (int k = 0; k < 3 * workers; ++k) {
+        mpz_clear(lt.scratch[k]);
+    }
+    free(lt.sum);
+    free(lt.scratch);
+    return ERROR_OK;
+}
+
+EXPORT error_t combine_parallel(char *secret, size_t secret_size, read_share_t *get_share, void *data, int threshold, bool diffusion, bool hexmode, worker_pool_t *pool, int cutoff) {
+    
+    if (0 == cutoff) {
+        cutoff = PARALLEL_COMBINE_CUTOFF;
+    }
+    if (NULL == pool || cutoff < 0 || threshold < cutoff) {
+        return combine(secret, secret_size, get_share, data, threshold, diffusion, hexmode);
+    }
+    
+    stats_increment(STATS_COUNT_COMBINE, 1);
+    uint64_t started = histogram_start();
+    PROBE1(combine__entry, threshold);
+    
+    mpz_t x[threshold], y[threshold], result;
+    int numbers[threshold];
+    unsigned s = 0;
+    int count = 0;                 // shares imported so far
+    error_t err = ERROR_OK;
+    
+    poly_degree_t pd = { .degree = 0 };
+    
+    for (int i = 0; i < threshold; i++) {
+        
+        char buffer[MAXLINELEN];
+        char *a, *b;
+        err = fetch_share(buffer, &a, &b, get_share, data, i + 1, threshold);
+        if (ERROR_OK != err) {
+            break;
+        }
+        if (! s) {
+            s = 4 * strlen(b);
+            if (! field_size_valid(s)) {
+                err = ERROR_SHARE_HAS_ILLEGAL_LENGTH;
+                break;
+            }
+            field_init(&pd, s);
+        } else {
+            if (s != 4 * strlen(b)) {
+                err = ERROR_SHARES_HAVE_DIFFERENT_SECURITY_LEVELS;
+                break;
+            }
+        }
+        if (! (numbers[i] = atoi(a))) {
+            err = ERROR_INVALID_SHARE;
+            break;
+        }
+        for (int j = 0; j < i; j++) {
+            if (numbers[j] == numbers[i]) {
+                err = ERROR_SHARES_INCONSISTENT;
+                break;
+            }
+        }
+        if (ERROR_OK != err) {
+            break;
+        }
+        mpz_init_set_ui(x[i], numbers[i]);
+        mpz_init(y[i]);
+        count++;
+        uint64_t start = stats_start();
+        field_import(pd.degree, y[i], b, 1);
+        stats_stop(STATS_IMPORT, start);
+        memset(buffer, 0, sizeof(buffer));
+    }
+    
+    if (ERROR_OK == err) {
+        mpz_init(result);
+        uint64_t start = stats_start();
+        PROBE2(restore__entry, pd.degree, threshold);
+        err = combine_lagrange(result, threshold, (const mpz_t *)x, (const mpz_t *)y, &pd, pool);
+        PROBE3(restore__return, pd.degree, threshold, err);
+        stats_stop(STATS_RESTORE, start);
+        if (ERROR_OK == err && diffusion) {
+            if (pd.degree >= 64) {
+                start = stats_start();
+                encode_mpz(pd.degree, result, DECODE);
+                stats_stop(STATS_DIFFUSION, start);
+            } else {
+                err = ERROR_SECURITY_LEVEL_TOO_SMALL_FOR_DIFFUSION;
+            }
+        }
+        if (ERROR_OK == err) {
+            start = stats_start();
+            err = field_print(secret, secret_size, NULL, 0, 0, pd.degree, result, hexmode);
+            stats_stop(STATS_PRINT, start);
+        }
+        mpz_clear(result);
+    }
+    
+    // clean up
+    for (int i = 0; i < count; i++) {
+        mpz_clear(x[i]);
+        mpz_clear(y[i]);
+    }
+    PROBE3(combine__return, pd.degree, threshold, err);
+    if (s) {
+        histogram_stop(HISTOGRAM_COMBINE, pd.degree, threshold, started);
+        field_deinit(&pd);
+    }
     
     return err;
 }
@@ -634,15 +1630,25 @@ ssize_t buffered_random_read(void *data, void *buffer, size_t nbytes) {
 error_t internal_split_cb(void* data, const char *buffer, size_t length, int number, int total) {
     char **shares = (char **)data;
     (void)total;
-    strncpy(shares[number - 1], buffer, length); // array is 0 based, number is 1..N
+    if (length >= MAXLINELEN) {
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+    char *share = shares[number - 1];  // array is 0 based, number is 1..N
+    memcpy(share, buffer, length);
+    memset(share + length, 0, MAXLINELEN - length);  // terminated, and no tail of a longer earlier share
     return ERROR_OK;
 }
 
 
-error_t wrapped_split(char **shares, const char *secret, int security, int threshold, int number, bool diffusion, const char *prefix, bool hexmode, const char *random_bytes, size_t byte_count) {
-    if (NULL == shares) {
+static error_t wrapped_split_secret(char **shares, const void *secret, size_t length, int security, int threshold, int number, bool diffusion, const char *prefix, secret_format_t format, const char *random_bytes, size_t byte_count) {
+    if (NULL == shares || NULL == secret) {
         return 	ERROR_INPUT_IS_NULL;
     }
+    for (int i = 0; i < number; ++i) {
+        if (NULL == shares[i]) {
+            return ERROR_INPUT_IS_NULL;
+        }
+    }
     
     random_buffer_t buffer = {
         .buffer = random_bytes,
@@ -657,8 +1663,15 @@ error_t wrapped_split(char **shares, const char *secret, int security, int thres
         .argument = &buffer
     };
     
-    return split(secret, internal_split_cb, shares, security, threshold, number, diffusion, prefix, hexmode, NULL == random_bytes ? NULL : &buffered_cprng);
-    
+    return split_shares(secret, length, internal_split_cb, shares, security, threshold, number, diffusion, prefix, format, NULL == random_bytes ? NULL : &buffered_cprng, NULL, false);
+}
+
+error_t wrapped_split(char **shares, const char *secret, int security, int threshold, int number, bool diffusion, const char *prefix, bool hexmode, const char *random_bytes, size_t byte_count) {
+    return wrapped_split_secret(shares, secret, 0, security, threshold, number, diffusion, prefix, TEXT_FORMAT(hexmode), random_bytes, byte_count);
+}
+
+error_t wrapped_split_binary(char **shares, const void *secret, size_t length, int threshold, int number, bool diffusion, const char *prefix, const char *random_bytes, size_t byte_count) {
+    return wrapped_split_secret(shares, secret, length, 0, threshold, number, diffusion, prefix, SECRET_BINARY, random_bytes, byte_count);
 }
 
 char **wrapped_allocate_shares(int number) {
@@ -675,9 +1688,9 @@ char **wrapped_allocate_shares(int number) {
     // make all pointer initially NULL
     memset(p, 0, number * sizeof(char *));
     
-    // allocate buffers
+    // allocate buffers, SHARE_LINELEN(MAXDEGREE) each as a split may be at any degree
     for (int i = 0; i < number ; ++i) {
-        p[i] = (char *)malloc(MAXLINELEN);
+        p[i] = (char *)calloc(1, MAXLINELEN);
         if (NULL == p[i]) {
             for (int j = 0; j < i; ++j) {
                 free(p[j]);
@@ -685,8 +1698,6 @@ char **wrapped_allocate_shares(int number) {
             free(p);
             return NULL;
         }
-        memset(p[i], 0, MAXLINELEN);
-        
     }
     return p;
 }
@@ -700,9 +1711,11 @@ error_t wrapped_free_shares(char **shares, int number) {
     }
     for (int j = 0; j < number; ++j) {
         char * s = shares[j];
-        size_t n =  strnlen(s, MAXLINELEN);
-        memset(s, 0, n); // clear sensitive data
-        free(s);
+        if (NULL != s) {
+            size_t n =  strnlen(s, MAXLINELEN);
+            memset(s, 0, n); // clear sensitive data
+            free(s);
+        }
     }
     free(shares);
     return ERROR_OK;
@@ -725,3 +1738,99 @@ error_t wrapped_combine(char *secret, size_t secret_size, const char **shares, i
     }
     return combine(secret, secret_size, internal_combine_cb, shares, threshold, diffusion, hexmode);
 }
+
+error_t wrapped_combine_binary(void *secret, size_t secret_size, size_t *length, const char **shares, int threshold, bool diffusion) {
+    if (NULL == shares) {
+        return 	ERROR_INPUT_IS_NULL;
+    }
+    return combine_binary(secret, secret_size, length, internal_combine_cb, shares, threshold, diffusion);
+}
+
+
+// batch API
+
+// rough cost of one field_mult: degree shift steps over degree/64 limbs
+static uint64_t field_mult_cost(unsigned int degree) {
+    return (uint64_t)degree * ((degree + 63) / 64);
+}
+
+// the degree a secret will be split at, mirroring the automatic choice in split
+static unsigned int estimated_degree(const char *secret, int security, bool hexmode) {
+    if (0 != security) {
+        return security;
+    }
+    if (NULL == secret) {
+        return 8;
+    }
+    size_t length = strlen(secret);
+    size_t degree = hexmode ? 4 * ((length + 1) & ~1) : 8 * length;
+    return degree < 8 ? 8 : degree > MAXDEGREE ? MAXDEGREE : (unsigned int)degree;
+}
+
+uint64_t split_job_cost(const split_job_t *job) {
+    unsigned int degree = estimated_degree(job->secret, job->security, job->hexmode);
+    uint64_t t = job->threshold > 1 ? job->threshold : 1;
+    uint64_t n = job->number > 1 ? job->number : 1;
+    return (n * t + 1) * field_mult_cost(degree);
+}
+
+static uint64_t split_item_cost(void *context, size_t index) {
+    return split_job_cost(&((const split_job_t *)context)[index]);
+}
+
+static void split_item(void *context, size_t index, int worker) {
+    (void)worker;
+    split_job_t *job = &((split_job_t *)context)[index];
+    job->error = split(job->secret, job->process_share, job->data,
+                       job->security, job->threshold, job->number, job->diffusion,
+                       job->prefix, job->hexmode, job->cprng);
+}
+
+error_t split_batch(split_job_t *jobs, size_t count, worker_pool_t *pool) {
+    if (NULL == jobs) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    uint64_t start = histogram_start();
+    worker_pool_run(pool, count, split_item, split_item_cost, jobs);
+    histogram_stop(HISTOGRAM_SPLIT_BATCH, 0, 0, start);
+    for (size_t i = 0; i < count; ++i) {
+        if (ERROR_OK != jobs[i].error) {
+            return jobs[i].error;
+        }
+    }
+    return ERROR_OK;
+}
+
+uint64_t combine_job_cost(const combine_job_t *job) {
+    // the share length is not known until it is read, the output size bounds it
+    size_t bits = job->hexmode ? 4 * job->secret_size : 8 * job->secret_size;
+    unsigned int degree = bits < 8 ? 8 : bits > MAXDEGREE ? MAXDEGREE : (unsigned int)bits;
+    uint64_t t = job->threshold > 1 ? job->threshold : 1;
+    return (t * t * t + t * t) * field_mult_cost(degree);
+}
+
+static uint64_t combine_item_cost(void *context, size_t index) {
+    return combine_job_cost(&((const combine_job_t *)context)[index]);
+}
+
+static void combine_item(void *context, size_t index, int worker) {
+    (void)worker;
+    combine_job_t *job = &((combine_job_t *)context)[index];
+    job->error = combine(job->secret, job->secret_size, job->get_share, job->data,
+                         job->threshold, job->diffusion, job->hexmode);
+}
+
+error_t combine_batch(combine_job_t *jobs, size_t count, worker_pool_t *pool) {
+    if (NULL == jobs) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    uint64_t start = histogram_start();
+    worker_pool_run(pool, count, combine_item, combine_item_cost, jobs);
+    histogram_stop(HISTOGRAM_COMBINE_BATCH, 0, 0, start);
+    for (size_t i = 0; i < count; ++i) {
+        if (ERROR_OK != jobs[i].error) {
+            return jobs[i].error;
+        }
+    }
+    return ERROR_OK;
+}
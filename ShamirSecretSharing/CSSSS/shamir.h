@@ -26,14 +26,20 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/types.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
 
 #define VERSION "0.5"
 
 #define RANDOM_SOURCE "/dev/random"
 
-#define MAXDEGREE 1024
+#define MAXDEGREE 8192
 #define MAXTOKENLEN 128
-#define MAXLINELEN (MAXTOKENLEN + 1 + 10 + 1 + MAXDEGREE / 4 + 10)
+#define SHARE_LINELEN(degree) (MAXTOKENLEN + 1 + 10 + 1 + (degree) / 4 + 10)  // a share line at degree bits
+#define MAXLINELEN SHARE_LINELEN(MAXDEGREE)
 
 // errors
 typedef enum {
@@ -54,6 +60,11 @@ typedef enum {
     ERROR_SHARES_HAVE_DIFFERENT_SECURITY_LEVELS,  // ie different bit counts
     ERROR_SHARES_INCONSISTENT,     // possibly a single share was used twice
     ERROR_MALLOC_FAILED,
+    ERROR_QUEUE_FULL,              // async submission ring has no space
+    ERROR_CANNOT_WRITE_OUTPUT,     // histogram export failed
+    ERROR_INVALID_THRESHOLD,       // threshold or number of shares out of range
+    ERROR_CANNOT_READ_INPUT,       // a stream input callback failed
+    ERROR_AUTHENTICATION_FAILED,   // shares altered or from different splits
     
     // no errors after here
     ERROR_maximum
@@ -77,6 +88,23 @@ typedef struct {
 } cprng_t;
 
 
+// worker pool
+// ===========
+
+// opaque pool of worker threads used by the batch and parallel routines
+typedef struct worker_pool worker_pool_t;
+
+typedef struct {
+    int workers;             // number of threads, zero => one per online CPU
+    const int *cpus;         // NULL => no affinity, otherwise worker i is pinned to cpus[i % cpu_count] (Linux only)
+    int cpu_count;           // entries in cpus
+    uint64_t chunk_cost;     // estimated cost of work taken from a queue at once, zero => auto
+} pool_config_t;
+
+worker_pool_t *worker_pool_create(const pool_config_t *config);  // NULL config => defaults, NULL return => failed
+void worker_pool_destroy(worker_pool_t *pool);                   // waits for the workers to exit
+
+
 // callback for split
 typedef error_t process_share_t(void* data,          // for passing file handle etc
 const char *buffer,  // the share as a string
@@ -99,6 +127,23 @@ error_t split(const char *secret,                // hex or ASCII secret to split
 );
 
 
+// split with the shares evaluated in parallel on a worker pool, for large numbers of shares
+// ordered => process_share is called for shares 1..N in turn, from any of the workers
+// otherwise => process_share is called as each share is ready and may run concurrently
+error_t split_parallel(const char *secret,       // hex or ASCII secret to split
+                       process_share_t *process_share,  // called for each share to be saved
+                       void *data,               // just passed to callback
+                       int security,             // bits or zero for auto, e.g. 512 => 64 bytes
+                       int threshold,            // shares to reconstruct secret
+                       int number,               // total shares
+                       bool diffusion,           // ? extra eccoding
+                       const char *prefix,       // for output like: prefix-N-share
+                       bool hexmode,             // false => ASCII
+                       const cprng_t *cprng,     // NULL => internal RANDOM_SOURCE
+                       worker_pool_t *pool,      // workers to evaluate the shares on
+                       bool ordered);            // deliver shares in number order
+
+
 // callback for combine
 typedef const char *read_share_t(void* data,     // for passing file handle etc
 int number,     // share number 1..N
@@ -115,6 +160,42 @@ error_t combine(char *secret,                    // the reconstituted secret
                 bool hexmode);                   // false => ASCII
 
 
+// binary secrets: any bytes, split at 8 * length bits (length 1..MAXDEGREE/8)
+// so leading zero bytes come back; the shares are the usual text lines
+error_t split_binary(const void *secret,         // raw secret bytes
+                     size_t length,              // bytes in secret
+                     process_share_t *process_share,  // called for each share to be saved
+                     void *data,                 // just passed to callback
+                     int threshold,              // shares to reconstruct secret
+                     int number,                 // total shares
+                     bool diffusion,             // ? extra eccoding
+                     const char *prefix,         // for output like: prefix-N-share
+                     const cprng_t *cprng);      // NULL => internal RANDOM_SOURCE
+
+error_t combine_binary(void *secret,             // the reconstituted secret, not terminated
+                       size_t secret_size,       // at least the share bits / 8
+                       size_t *length,           // returns bytes written to secret
+                       read_share_t *get_share,  // fetch a share string
+                       void *data,               // just passed to callback
+                       int threshold,            // shares to reconstruct secret
+                       bool diffusion);          // ?
+
+
+// threshold from which combine_parallel uses the workers by default
+#define PARALLEL_COMBINE_CUTOFF 32
+
+// combine with the reconstruction spread over a worker pool, for large thresholds
+error_t combine_parallel(char *secret,           // the reconstituted secret
+                         size_t secret_size,     // size of secret, must include space for '\0'
+                         read_share_t *get_share,  // fetch a share string
+                         void *data,             // just passed to callback
+                         int threshold,          // shares to reconstruct secret
+                         bool diffusion,         // ?
+                         bool hexmode,           // false => ASCII
+                         worker_pool_t *pool,    // workers for the reconstruction, NULL => as combine
+                         int cutoff);            // use the workers from this threshold, zero => PARALLEL_COMBINE_CUTOFF, negative => never
+
+
 // wrapper API
 // ===========
 
@@ -127,9 +208,10 @@ error_t wrapped_split(char **shares,             // returns pointer to allocated
                       const char *prefix,        // for output like: prefix-N-share
                       bool hexmode,              // false => ASCII
                       const char *random_bytes,  // NULL => internal RANDOM_SOURCE, otherwise array of random data
-                      size_t byte_count);        // ... must be: threshold * MAX_DEGREE/8 bytes long
+                      size_t byte_count);        // ... at least (threshold - 1) * degree/8 bytes, degree being
+                                                 //     security or the one chosen for the secret
 
-char **wrapped_allocate_shares(int number);      // allocate a sutable array for wrapped_split
+char **wrapped_allocate_shares(int number);      // allocate a sutable array for wrapped_split, MAXLINELEN per share
 
 error_t wrapped_free_shares(char **shares,       // to clear and release share allocation
                             int number);         // must be original allocation size
@@ -141,6 +223,515 @@ error_t wrapped_combine(char *secret,            // the reconstituted secret
                         bool diffusion,          // ?
                         bool hexmode);           // false => ASCII
 
+error_t wrapped_split_binary(char **shares,      // as wrapped_split
+                             const void *secret, // raw secret bytes
+                             size_t length,      // bytes in secret, the security is 8 * length
+                             int threshold,      // shares to reconstruct secret
+                             int number,         // total shares
+                             bool diffusion,     // ? extra eccoding
+                             const char *prefix, // for output like: prefix-N-share
+                             const char *random_bytes,  // NULL => internal RANDOM_SOURCE, otherwise array of random data
+                             size_t byte_count); // ... at least (threshold - 1) * length bytes
+
+error_t wrapped_combine_binary(void *secret,     // the reconstituted secret, not terminated
+                               size_t secret_size,  // at least the share bits / 8
+                               size_t *length,   // returns bytes written to secret
+                               const char **shares,  // must contain threshold * '\0' terminated entries
+                               int threshold,    // shares to reconstruct secret
+                               bool diffusion);  // ?
+
+
+// batch API
+// =========
+
+// one split of a batch, parameters as for split
+// callbacks for different jobs may run concurrently on different threads
+typedef struct {
+    const char *secret;
+    process_share_t *process_share;
+    void *data;
+    int security;
+    int threshold;
+    int number;
+    bool diffusion;
+    const char *prefix;
+    bool hexmode;
+    const cprng_t *cprng;
+    error_t error;           // result of this split
+} split_job_t;
+
+// one combine of a batch, parameters as for combine
+typedef struct {
+    char *secret;
+    size_t secret_size;
+    read_share_t *get_share;
+    void *data;
+    int threshold;
+    bool diffusion;
+    bool hexmode;
+    error_t error;           // result of this combine
+} combine_job_t;
+
+// run all jobs, each job's error is set and the first failure (in job order) is returned
+error_t split_batch(split_job_t *jobs,           // jobs to run
+                    size_t count,                // number of jobs
+                    worker_pool_t *pool);        // NULL => run in calling thread
+
+error_t combine_batch(combine_job_t *jobs,       // jobs to run
+                      size_t count,              // number of jobs
+                      worker_pool_t *pool);      // NULL => run in calling thread
+
+
+// asynchronous API
+// ================
+
+// jobs are posted to a bounded submission ring, run on a worker pool and
+// their results collected from a completion ring, the secret, shares and
+// callback data of a job must stay valid until its completion is reaped
+
+typedef struct async_queue async_queue_t;
+
+typedef enum {
+    ASYNC_SPLIT,
+    ASYNC_COMBINE
+} async_op_t;
+
+typedef struct {
+    async_op_t op;
+    uint64_t user_data;
+    error_t error;           // result of the split or combine
+} async_completion_t;
+
+// called on the worker that ran the job, instead of posting to the completion ring
+typedef void async_complete_t(void *data, const async_completion_t *completion);
+
+typedef struct {
+    async_op_t op;
+    uint64_t user_data;      // returned unchanged in the completion
+    union {
+        split_job_t split;   // for ASYNC_SPLIT
+        combine_job_t combine;  // for ASYNC_COMBINE
+    } job;
+    async_complete_t *complete;  // NULL => completion goes to the completion ring
+    void *complete_data;     // just passed to complete
+} async_submission_t;
+
+async_queue_t *async_queue_create(worker_pool_t *pool,   // workers to run the jobs on
+                                  unsigned int entries); // maximum jobs submitted and not yet reaped
+
+void async_queue_destroy(async_queue_t *queue);          // runs the jobs already submitted first
+
+// post a job, when the queue is full wait up to timeout_ms
+// (zero => return ERROR_QUEUE_FULL at once, negative => wait for space)
+error_t async_submit(async_queue_t *queue, const async_submission_t *submission, int timeout_ms);
+
+// collect up to max completions, waiting up to timeout_ms for the first one
+// (zero => do not wait, negative => wait for a completion), returns the number collected
+unsigned int async_reap(async_queue_t *queue, async_completion_t *completions, unsigned int max, int timeout_ms);
+
+// file descriptor that becomes readable when completions are waiting,
+// for epoll/kqueue integration (eventfd on Linux, a pipe otherwise)
+int async_queue_fd(const async_queue_t *queue);
+
+
+// statistics API
+// ==============
+
+// per thread counters of where split and combine spend their time, off
+// until enabled; reading sums every thread's counters without locking,
+// the counters are cumulative, take differences between reads for rates
+
+typedef enum {
+    STATS_CPRNG,             // cprng_read
+    STATS_IMPORT,            // field_import of the secret or the shares
+    STATS_DIFFUSION,         // encode_mpz
+    STATS_EVALUATE,          // horner, one call per share
+    STATS_RESTORE,           // solving for the secret in combine
+    STATS_PRINT,             // field_print
+    STATS_CALLBACK,          // process_share and get_share
+    STATS_maximum
+} stats_phase_t;
+
+typedef struct {
+    uint64_t splits;
+    uint64_t combines;
+    uint64_t calls[STATS_maximum];
+    uint64_t nanoseconds[STATS_maximum];
+    uint64_t field_mults;
+    uint64_t field_inverts;
+} stats_t;
+
+void stats_enable(bool enable);                  // applies to all threads
+bool stats_enabled(void);
+
+void stats_read(stats_t *stats);                 // totals over all threads, including finished ones
+void stats_read_thread(stats_t *stats);          // the calling thread only
+
+const char *stats_phase_name(stats_phase_t phase);  // e.g. "cprng", for export
+
+
+// latency histogram API
+// =====================
+
+// HDR style histograms of the wall time of each split and combine, one
+// series per operation, field degree and threshold bucket; off until
+// enabled, recorded in per thread shards and merged when a snapshot is
+// taken, values are cumulative like the statistics counters
+//
+// buckets are log-linear: 32 linear sub-buckets per power of two, so a
+// recorded value is within about 3% of the bucket bounds; values from
+// 2^40 ns (about 18 minutes) up land in the last bucket
+
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+#define HISTOGRAM_VALUE_BITS 40
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS + 1) << HISTOGRAM_SUB_BUCKET_BITS)
+
+typedef enum {
+    HISTOGRAM_SPLIT,         // split and split_parallel
+    HISTOGRAM_COMBINE,       // combine and combine_parallel
+    HISTOGRAM_SPLIT_BATCH,   // a whole split_batch, degree and threshold are 0
+    HISTOGRAM_COMBINE_BATCH, // a whole combine_batch, degree and threshold are 0
+    HISTOGRAM_maximum
+} histogram_op_t;
+
+typedef struct {
+    histogram_op_t op;
+    unsigned int degree;     // field degree in bits
+    int threshold;           // largest threshold of the bucket: 2, 4, 8, 16, ...
+    uint64_t count;          // sum of buckets
+    uint64_t sum;            // nanoseconds
+    uint64_t min;            // nanoseconds
+    uint64_t max;            // nanoseconds
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+typedef struct {
+    size_t count;
+    histogram_t *histograms; // sorted by op, degree and threshold
+} histogram_snapshot_t;
+
+void histogram_enable(bool enable);              // applies to all threads
+bool histogram_enabled(void);
+
+// merge every thread's series, free the result with histogram_snapshot_free
+error_t histogram_snapshot(histogram_snapshot_t *snapshot);
+void histogram_snapshot_free(histogram_snapshot_t *snapshot);
+
+uint64_t histogram_bucket_limit(size_t bucket);  // largest value counted in bucket, in nanoseconds
+uint64_t histogram_percentile(const histogram_t *histogram, double percentile);  // e.g. 99.9 => p999
+const char *histogram_op_name(histogram_op_t op);   // e.g. "split", for export
+
+// text exposition: Prometheus style cumulative buckets (non-empty ones
+// and +Inf) with _sum and _count per series, in nanoseconds
+typedef error_t histogram_output_t(void *data, const char *text, size_t length);
+
+error_t histogram_export(histogram_output_t *output, void *data);   // called once per line
+error_t histogram_write_file(const char *path);  // written beside path and renamed over it
+
+
+// tuning API
+// ==========
+
+// the field arithmetic has several implementations whose speed depends
+// on the degree and the CPU; tune micro-benchmarks them for every valid
+// degree to 1024 bits and every 512 bits above, interpolating between,
+// and keeps the fastest; call it at startup before other threads use the
+// library (untuned degrees use the built-in choice)
+
+typedef enum {
+    FIELD_BACKEND_AUTO,      // built-in choice
+    FIELD_BACKEND_GENERIC,   // bit serial shift and add on mpz values
+    FIELD_BACKEND_LIMBS,     // limb arrays, any degree
+    FIELD_BACKEND_FIXED,     // limb arrays specialised for 128, 256 and 512 bits
+    FIELD_BACKEND_maximum
+} field_backend_t;
+
+typedef enum {
+    RESTORE_AUTO,            // built-in choice
+    RESTORE_GAUSS,           // solve the linear system
+    RESTORE_LAGRANGE,        // Lagrange weights, thresholds 2 to 8 only
+    RESTORE_maximum
+} restore_t;
+
+typedef struct {
+    unsigned int degree;
+    field_backend_t mult;
+    field_backend_t invert;
+    restore_t restore;
+    uint64_t mult_ns;        // measured or interpolated, zero until tuned
+    uint64_t invert_ns;      // ..
+} tuning_t;
+
+// load the tuning file at path when it was written for this build and CPU,
+// otherwise benchmark every degree and (re)write it; NULL path => benchmark only
+error_t tune(const char *path);
+
+error_t tuning_read(unsigned int degree, tuning_t *tuning);
+
+const char *field_backend_name(field_backend_t backend);   // e.g. "limbs", as in the tuning file
+const char *restore_name(restore_t restore);
+
+// estimated nanoseconds of field arithmetic in one split or combine, for
+// capacity planning, from the timings of tune; zero for a degree not tuned
+uint64_t split_cost(unsigned int degree, int threshold, int number);
+uint64_t combine_cost(unsigned int degree, int threshold);
+
+
+// byte-wise API
+// =============
+
+// every byte of a binary secret of any length is shared on its own over
+// GF(2^8) (x^8 + x^4 + x^3 + x + 1, as AES) with log/exp tables, so a
+// share is a small header and one byte per secret byte; there is no
+// security level to choose and no diffusion
+
+#define GF256_VERSION 1
+#define GF256_HEADER_SIZE 3          // version, threshold, share number
+#define GF256_MAX_SHARES 255
+
+size_t gf256_share_size(size_t length);          // length + GF256_HEADER_SIZE
+
+// share i (0 based) is written to shares[i], which must hold gf256_share_size(length) bytes
+error_t gf256_split(uint8_t *const *shares,      // number buffers
+                    const void *secret,          // binary secret
+                    size_t length,               // bytes in secret
+                    int threshold,               // shares to reconstruct secret, 1..number
+                    int number,                  // total shares, up to GF256_MAX_SHARES
+                    const cprng_t *cprng);       // NULL => internal RANDOM_SOURCE
+
+error_t gf256_combine(void *secret,              // the reconstituted secret, length bytes
+                      size_t length,             // bytes in secret
+                      const uint8_t *const *shares,  // threshold shares of gf256_share_size(length) bytes
+                      int threshold);            // shares to reconstruct secret
+
+// region multiply kernels, chosen at first use from what the CPU supports
+// (SIMD ones on x86-64 Linux only); setting one is for benchmarks and
+// tests and must not race a split or combine
+typedef enum {
+    GF256_KERNEL_AUTO = 0,         // the widest available
+    GF256_KERNEL_SCALAR,           // 256 byte product tables
+    GF256_KERNEL_SSSE3,            // PSHUFB nibble tables, 16 bytes a step
+    GF256_KERNEL_AVX2,             // PSHUFB nibble tables, 32 bytes a step
+    GF256_KERNEL_GFNI,             // GF2P8MULB, 32 bytes a step
+    GF256_KERNEL_AVX512_GFNI,      // GF2P8MULB, 64 bytes a step
+
+    // no kernels after here
+    GF256_KERNEL_maximum
+} gf256_kernel_t;
+
+bool gf256_kernel_available(gf256_kernel_t kernel);
+bool gf256_set_kernel(gf256_kernel_t kernel);    // false => not available, unchanged
+gf256_kernel_t gf256_kernel(void);               // in use
+const char *gf256_kernel_name(gf256_kernel_t kernel);  // e.g. "avx2"
+
+// streaming byte-wise API
+// =======================
+
+// secrets of any size in constant memory, a few blocks per share; the
+// share streams are the same bytes as gf256_split produces, header first
+
+// callback for the share (split) or secret (combine) output
+typedef error_t gf256_output_t(void *data,       // for passing file handles etc
+                               const uint8_t *buffer,  // the next bytes of the stream
+                               size_t length,    // bytes in buffer
+                               int number,       // share number 1..N, zero => the secret
+                               int total);       // total shares (split) or threshold (combine)
+
+// callback for combine to read the next bytes of a share stream
+typedef ssize_t gf256_input_t(void *data,        // for passing file handles etc
+                              int index,         // which share stream, 0..threshold-1
+                              void *buffer,
+                              size_t size);      // bytes wanted, 0 => end of stream, < 0 => error
+
+typedef struct gf256_split_stream gf256_split_stream_t;
+
+// begin outputs the share headers, update a block of every share for
+// each whole block of secret fed in and end the rest; a failure is
+// returned again by later calls and end must still be called to free
+// the stream
+error_t gf256_split_begin(gf256_split_stream_t **stream,  // NULL unless the headers were attempted
+                          int threshold,         // shares to reconstruct secret, 1..number
+                          int number,            // total shares, up to GF256_MAX_SHARES
+                          const cprng_t *cprng,  // NULL => internal RANDOM_SOURCE
+                          gf256_output_t *output,  // called with each piece of each share
+                          void *data);           // just passed to callback
+error_t gf256_split_update(gf256_split_stream_t *stream, const void *chunk, size_t length);
+error_t gf256_split_end(gf256_split_stream_t *stream);  // frees stream
+
+// read threshold share streams to their end, writing the secret to output
+error_t gf256_combine_stream(int threshold,      // shares to reconstruct secret
+                             gf256_input_t *input,
+                             gf256_output_t *output,
+                             void *data);        // just passed to callbacks
+
+// files: the secret is mapped and the engine writes straight into the
+// preallocated, mapped share files, so the secret is never copied and
+// there are no read or write calls (POSIX)
+
+// callback for naming each share file, as process_share_t is for placing
+// the text shares, e.g. snprintf(path, size, "%s-%d", prefix, number)
+typedef error_t gf256_share_path_t(void *data,   // for passing a prefix etc
+                                   char *path,   // to be set to the share file path
+                                   size_t size,  // bytes in path
+                                   int number,   // share number 1..N
+                                   int total);   // total shares
+
+// share files are gf256_share_size(secret size) bytes, and removed again on failure
+error_t gf256_split_file(const char *secret_path,
+                         gf256_share_path_t *share_path,  // called for each share file
+                         void *data,             // just passed to callback
+                         int threshold,          // shares to reconstruct secret, 1..number
+                         int number,             // total shares, up to GF256_MAX_SHARES
+                         const cprng_t *cprng);  // NULL => internal RANDOM_SOURCE
+
+// the secret file is replaced, and removed again on failure
+error_t gf256_combine_file(const char *secret_path,
+                           const char *const *share_paths,  // threshold share files
+                           int threshold);       // shares to reconstruct secret
+
+
+// share file I/O API
+// ==================
+
+// buffered appends and reads of many share files for dealers writing
+// the shares of many objects; writes are gathered in a fixed set of
+// buffers and go out in batches, through io_uring (registered buffers,
+// raw system calls) on Linux when the kernel allows it and otherwise as
+// pwrite batches on a worker pool
+
+typedef struct share_io share_io_t;
+
+typedef enum {
+    SHARE_IO_BACKEND_AUTO = 0,     // io_uring if available, otherwise pwrite
+    SHARE_IO_BACKEND_URING,        // io_uring or fail
+    SHARE_IO_BACKEND_PWRITE,       // pwrite batches on config pool, pread
+} share_io_backend_t;
+
+typedef struct {
+    share_io_backend_t backend;
+    unsigned int depth;            // buffers, zero => 64; two per file read, any number of files written
+    size_t buffer_size;            // bytes per buffer, zero => 64 KiB
+    worker_pool_t *pool;           // pwrite workers, NULL => in the calling thread
+} share_io_config_t;
+
+share_io_t *share_io_create(const share_io_config_t *config);  // NULL config => defaults, NULL return => failed
+error_t share_io_destroy(share_io_t *io);       // writes what is buffered, closes files, first error
+share_io_backend_t share_io_backend(const share_io_t *io);
+
+int share_io_open(share_io_t *io, const char *path, bool write);  // file handle, < 0 => failed; write truncates
+error_t share_io_close(share_io_t *io, int file);  // waits for its writes, first error
+error_t share_io_flush(share_io_t *io);         // waits for all writes, first error
+
+// appends to a file opened for writing; thread safe, an append is never
+// interleaved with another; a failure is returned again by later calls
+error_t share_io_append(share_io_t *io, int file, const void *buffer, size_t length);
+
+// next bytes of a file opened for reading, 0 => end of file, < 0 => error
+ssize_t share_io_read(share_io_t *io, int file, void *buffer, size_t size);
+
+// adapters, data is a share_io_files_t
+typedef struct {
+    share_io_t *io;
+    int files[GF256_MAX_SHARES];   // share number n is files[n - 1], combine share index k is files[k]
+    int secret;                    // combined secret
+} share_io_files_t;
+
+error_t share_io_output(void *data, const uint8_t *buffer, size_t length, int number, int total);  // gf256_output_t
+ssize_t share_io_input(void *data, int index, void *buffer, size_t size);                         // gf256_input_t
+error_t share_io_process_share(void *data, const char *buffer, size_t length, int number, int total);  // process_share_t, a line per share
+
+
+// computational secret sharing API
+// ================================
+
+// Krawczyk's scheme for large secrets: the secret is encrypted under a
+// fresh key with ChaCha20-Poly1305, the ciphertext is dispersed so that
+// any threshold shares rebuild it, and only the 32 byte key is Shamir
+// shared (byte-wise, at the share's x); so a share is about
+// length / threshold bytes, not length, and is only computationally
+// secure
+
+#define KRAWCZYK_VERSION 2               // first byte, as GF256_VERSION
+#define KRAWCZYK_HEADER_SIZE 55          // version, threshold, x, length, nonce, key share
+
+size_t krawczyk_share_size(size_t length, int threshold);
+size_t krawczyk_secret_length(const uint8_t *share);   // as recorded in the header
+
+// share i (0 based) is written to shares[i], which must hold krawczyk_share_size(length, threshold) bytes
+error_t krawczyk_split(uint8_t *const *shares,   // number buffers
+                       const void *secret,       // binary secret
+                       size_t length,            // bytes in secret
+                       int threshold,            // shares to reconstruct secret, 1..number
+                       int number,               // total shares, up to GF256_MAX_SHARES
+                       const cprng_t *cprng);    // NULL => internal RANDOM_SOURCE
+
+error_t krawczyk_combine(void *secret,           // the reconstituted secret, length bytes
+                         size_t length,          // bytes in secret, krawczyk_secret_length
+                         const uint8_t *const *shares,  // threshold shares
+                         int threshold);         // shares to reconstruct secret
+
+
+// share bundle API
+// ================
+
+// one holder's shares of many secrets in one file, keyed by a 64 bit
+// secret id: binary share records appended as they come, then an index
+// sorted by id written on close; readers map the file and look shares up
+// by binary search (see bundle.c for the layout)
+
+#define BUNDLE_VERSION 1
+
+typedef struct bundle bundle_t;
+typedef struct bundle_writer bundle_writer_t;
+
+typedef struct {
+    uint64_t id;
+    int number;                    // share number 1..N, 0 => a combined secret
+    size_t length;                 // value bytes, the share bits / 8
+    const uint8_t *value;          // into the mapping, valid until bundle_close
+} bundle_share_t;
+
+bundle_t *bundle_open(const char *path);        // NULL => cannot read or not a finished bundle
+void bundle_close(bundle_t *bundle);
+size_t bundle_count(const bundle_t *bundle);    // secrets, one share each
+
+error_t bundle_find(const bundle_t *bundle, uint64_t id, bundle_share_t *share);  // ERROR_INVALID_SHARE => no such id
+error_t bundle_entry(const bundle_t *bundle, size_t index, bundle_share_t *share);  // index 0..count-1 in id order
+size_t bundle_search(const bundle_t *bundle, uint64_t id);  // first index with an id >= id
+
+// as a split share line, number-hex, for combine
+error_t bundle_print_share(char *buffer, size_t size, const bundle_share_t *share);
+
+// append => add to an existing bundle (a new id replaces an older share of
+// the same id), otherwise truncate; NULL return => failed
+bundle_writer_t *bundle_writer_open(const char *path, bool append);
+error_t bundle_writer_close(bundle_writer_t *writer);  // writes the index, first error
+
+// thread safe; a failure is returned again by later calls and by close
+error_t bundle_append(bundle_writer_t *writer, uint64_t id, int number, const void *value, size_t length);
+error_t bundle_append_share(bundle_writer_t *writer, uint64_t id, const char *share, size_t length);  // a split share line
+
+// process_share_t adapter for split and split_batch: share number n goes
+// to bundles[n - 1] under id, numbers past count (or NULL bundles) are dropped
+typedef struct {
+    bundle_writer_t *const *bundles;
+    int count;
+    uint64_t id;
+} bundle_target_t;
+
+error_t bundle_process_share(void *data, const char *buffer, size_t length, int number, int total);  // data is a bundle_target_t
+
+// combine every secret whose id is in all threshold bundles, one bundle
+// per share holder, and append it to output as a record with number 0 and
+// the secret bytes of combine_binary; ids missing from a bundle are
+// skipped, an id that fails is left out and the first such error returned
+error_t bundle_combine(bundle_writer_t *output,     // secrets
+                       bundle_t *const *bundles,    // threshold open bundles
+                       int threshold,               // shares to reconstruct secret
+                       bool diffusion,              // as for split
+                       worker_pool_t *pool,         // NULL => run in calling thread
+                       size_t *combined);           // secrets written, NULL => not wanted
+
 
 // for use by main routine (not really for export)
 // ===============================================
@@ -148,4 +739,8 @@ error_t wrapped_combine(char *secret,            // the reconstituted secret
 int field_size_valid(int deg);
 
 
+#if defined(__cplusplus)
+}
+#endif
+
 #endif
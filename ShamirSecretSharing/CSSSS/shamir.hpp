@@ -0,0 +1,562 @@
+/*
+ *  C++ ownership types for the shamir.h API
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_SSSS_HPP_)
+#define _SSSS_HPP_ 1
+
+// glibc declares its own error_t when _GNU_SOURCE is set (always so for
+// g++), so the C API is declared in ssss::c rather than the global
+// namespace; its system headers come first so they stay global
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#if defined(_SSSS_H_)
+#error "include shamir.hpp instead of shamir.h in C++"
+#endif
+
+namespace ssss {
+namespace c {
+#include "shamir.h"
+} // namespace c
+using namespace c;
+} // namespace ssss
+
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <utility>
+
+// requires C++20 (std::span)
+//
+// usage:
+//
+//   ssss::SplitResult r = ssss::split(std::as_bytes(std::span(key)), 3, 5);
+//   std::string_view first = r.shares[0];
+//   ssss::CombineResult c = ssss::combine_binary(r.shares, 3);
+//   std::span<const std::byte> recovered = c.secret.bytes();
+//
+// byte spans are split as binary secrets (split_binary) and must be
+// combined with combine_binary, strings as hex or ASCII text
+//
+// all types but ShareView are move-only and wipe their storage when
+// destroyed, views returned from them (and ShareView) are valid while the
+// owner is; shares held elsewhere combine through ShareView without a
+// copy; the C API is in
+// ssss::c and visible from ssss (ssss::error_t, ssss::c::split, ...)
+
+namespace ssss {
+
+// clear memory that held secret material, not optimised away
+inline void wipe(void *p, size_t n) noexcept {
+    volatile unsigned char *v = static_cast<volatile unsigned char *>(p);
+    while (n--) {
+        *v++ = 0;
+    }
+}
+
+namespace detail {
+
+// one allocation of bytes, wiped before release
+class Storage {
+public:
+    Storage() noexcept = default;
+
+    explicit Storage(size_t size)
+        : size_(size), data_(size > 0 ? new char[size]() : nullptr) {
+    }
+
+    Storage(Storage &&other) noexcept
+        : size_(std::exchange(other.size_, 0)),
+          data_(std::exchange(other.data_, nullptr)) {
+    }
+
+    Storage &operator=(Storage &&other) noexcept {
+        if (this != &other) {
+            release();
+            size_ = std::exchange(other.size_, 0);
+            data_ = std::exchange(other.data_, nullptr);
+        }
+        return *this;
+    }
+
+    Storage(const Storage &) = delete;
+    Storage &operator=(const Storage &) = delete;
+
+    ~Storage() {
+        release();
+    }
+
+    char *data() const noexcept {
+        return data_;
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    void release() noexcept {
+        if (nullptr != data_) {
+            wipe(data_, size_);
+            delete[] data_;
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    size_t size_ = 0;
+    char *data_ = nullptr;
+};
+
+// bytes followed by a '\0' for the C API
+class Text {
+public:
+    Text() noexcept = default;
+
+    explicit Text(std::span<const std::byte> bytes)
+        : storage_(bytes.size() + 1), length_(bytes.size()) {
+        if (!bytes.empty()) {
+            std::memcpy(storage_.data(), bytes.data(), bytes.size());
+        }
+    }
+
+    explicit Text(std::string_view text)
+        : Text(std::as_bytes(std::span<const char>(text.data(), text.size()))) {
+    }
+
+    Text(Text &&other) noexcept
+        : storage_(std::move(other.storage_)),
+          length_(std::exchange(other.length_, 0)) {
+    }
+
+    Text &operator=(Text &&other) noexcept {
+        storage_ = std::move(other.storage_);
+        length_ = std::exchange(other.length_, 0);
+        return *this;
+    }
+
+    // room for capacity - 1 characters, filled in by the C API
+    static Text with_capacity(size_t capacity) {
+        Text t;
+        t.storage_ = Storage(capacity);
+        return t;
+    }
+
+    // take the length from the '\0' written by the C API
+    void settle() noexcept {
+        length_ = nullptr == storage_.data() ? 0 : strnlen(storage_.data(), storage_.size());
+    }
+
+    // binary contents of length bytes, as written by the C API
+    void settle(size_t length) noexcept {
+        length_ = length < storage_.size() ? length : 0;
+    }
+
+    char *data() noexcept {
+        return storage_.data();
+    }
+
+    size_t capacity() const noexcept {
+        return storage_.size();
+    }
+
+    const char *c_str() const noexcept {
+        return nullptr == storage_.data() ? "" : storage_.data();
+    }
+
+    size_t size() const noexcept {
+        return length_;
+    }
+
+    std::string_view view() const noexcept {
+        return std::string_view(c_str(), length_);
+    }
+
+    std::span<const std::byte> bytes() const noexcept {
+        return std::as_bytes(std::span<const char>(c_str(), length_));
+    }
+
+private:
+    Storage storage_;
+    size_t length_ = 0;
+};
+
+} // namespace detail
+
+// a secret: hex or ASCII text as split and combine take it, or the bytes
+// of a binary secret
+class Secret {
+public:
+    // large enough for any secret combine or combine_binary can produce
+    static constexpr size_t capacity = MAXDEGREE / 4 + 2;
+
+    Secret() noexcept = default;
+
+    explicit Secret(std::span<const std::byte> bytes)
+        : text_(bytes) {
+    }
+
+    explicit Secret(std::string_view text)
+        : text_(text) {
+    }
+
+    // empty buffer for combine to write into
+    static Secret buffer() {
+        Secret s;
+        s.text_ = detail::Text::with_capacity(capacity);
+        return s;
+    }
+
+    char *data() noexcept {
+        return text_.data();
+    }
+
+    void settle() noexcept {
+        text_.settle();
+    }
+
+    void settle(size_t length) noexcept {
+        text_.settle(length);
+    }
+
+    const char *c_str() const noexcept {
+        return text_.c_str();
+    }
+
+    size_t size() const noexcept {
+        return text_.size();
+    }
+
+    std::string_view view() const noexcept {
+        return text_.view();
+    }
+
+    std::span<const std::byte> bytes() const noexcept {
+        return text_.bytes();
+    }
+
+private:
+    detail::Text text_;
+};
+
+// a single share, for example one holder's share read back from storage
+class Share {
+public:
+    Share() noexcept = default;
+
+    explicit Share(std::span<const std::byte> bytes)
+        : text_(bytes) {
+    }
+
+    explicit Share(std::string_view text)
+        : text_(text) {
+    }
+
+    // share number from "prefix-N-share" or "N-share", zero if malformed
+    int number() const noexcept {
+        std::string_view s = text_.view();
+        size_t a = s.find('-');
+        if (std::string_view::npos == a) {
+            return 0;
+        }
+        size_t b = s.find('-', a + 1);
+        std::string_view n = std::string_view::npos == b ? s.substr(0, a) : s.substr(a + 1, b - a - 1);
+        int value = 0;
+        for (char c : n) {
+            if (c < '0' || c > '9') {
+                return 0;
+            }
+            value = 10 * value + (c - '0');
+        }
+        return value;
+    }
+
+    const char *c_str() const noexcept {
+        return text_.c_str();
+    }
+
+    std::string_view view() const noexcept {
+        return text_.view();
+    }
+
+    std::span<const std::byte> bytes() const noexcept {
+        return text_.bytes();
+    }
+
+private:
+    detail::Text text_;
+};
+
+// a share line held elsewhere and not copied, '\0' terminated: a Share,
+// a ShareSet entry or std::string::c_str(); valid while that is
+class ShareView {
+public:
+    ShareView() noexcept = default;
+
+    explicit ShareView(const char *line) noexcept
+        : line_(line) {
+    }
+
+    ShareView(const Share &share) noexcept
+        : line_(share.c_str()) {
+    }
+
+    const char *c_str() const noexcept {
+        return line_;
+    }
+
+    std::string_view view() const noexcept {
+        return nullptr == line_ ? std::string_view() : std::string_view(line_);
+    }
+
+private:
+    const char *line_ = nullptr;
+};
+
+// the shares of one split in a single allocation: their lengths
+// followed by number slots of SHARE_LINELEN(degree), each '\0' terminated
+class ShareSet {
+public:
+    ShareSet() noexcept = default;
+
+    // degree as split will choose it, beyond MAXDEGREE split fails anyway
+    explicit ShareSet(int number, unsigned int degree = MAXDEGREE)
+        : number_(number > 0 ? number : 0),
+          slot_size_(SHARE_LINELEN(degree < MAXDEGREE ? degree : MAXDEGREE)),
+          storage_(static_cast<size_t>(number_) * (slot_size_ + sizeof(size_t))) {
+    }
+
+    ShareSet(ShareSet &&other) noexcept
+        : number_(std::exchange(other.number_, 0)),
+          slot_size_(std::exchange(other.slot_size_, 0)),
+          storage_(std::move(other.storage_)) {
+    }
+
+    ShareSet &operator=(ShareSet &&other) noexcept {
+        number_ = std::exchange(other.number_, 0);
+        slot_size_ = std::exchange(other.slot_size_, 0);
+        storage_ = std::move(other.storage_);
+        return *this;
+    }
+
+    int size() const noexcept {
+        return number_;
+    }
+
+    bool empty() const noexcept {
+        return 0 == number_;
+    }
+
+    // share i (0 based), empty until filled
+    std::string_view operator[](int i) const noexcept {
+        return std::string_view(c_str(i), lengths()[i]);
+    }
+
+    const char *c_str(int i) const noexcept {
+        return slot(i);
+    }
+
+    std::span<const std::byte> bytes(int i) const noexcept {
+        return std::as_bytes(std::span<const char>(c_str(i), lengths()[i]));
+    }
+
+    ShareView line(int i) const noexcept {
+        return ShareView(c_str(i));
+    }
+
+    // store share number (1..N), as called back from split; false if it
+    // does not fit
+    bool set(int number, const char *buffer, size_t length) noexcept {
+        if (number < 1 || number > number_ || length >= slot_size_) {
+            return false;
+        }
+        char *s = slot(number - 1);
+        std::memcpy(s, buffer, length);
+        s[length] = '\0';
+        lengths()[number - 1] = length;
+        return true;
+    }
+
+    // process_share_t adaptor, data is the ShareSet
+    static error_t collect(void *data, const char *buffer, size_t length, int number, int total) {
+        (void)total;
+        return static_cast<ShareSet *>(data)->set(number, buffer, length) ? ERROR_OK : ERROR_BUFFER_TOO_SMALL;
+    }
+
+private:
+    size_t *lengths() const noexcept {
+        return reinterpret_cast<size_t *>(storage_.data());
+    }
+
+    char *slot(int i) const noexcept {
+        return storage_.data() + static_cast<size_t>(number_) * sizeof(size_t) + static_cast<size_t>(i) * slot_size_;
+    }
+
+    int number_ = 0;
+    size_t slot_size_ = 0;
+    detail::Storage storage_;
+};
+
+struct SplitOptions {
+    int security = 0;              // bits or zero for auto
+    bool diffusion = false;
+    const char *prefix = nullptr;  // for output like: prefix-N-share
+    bool hexmode = false;          // false => ASCII
+    const cprng_t *cprng = nullptr;  // NULL => internal RANDOM_SOURCE
+};
+
+struct CombineOptions {
+    bool diffusion = false;
+    bool hexmode = false;          // false => ASCII
+};
+
+struct SplitResult {
+    error_t error = ERROR_OK;
+    ShareSet shares;
+};
+
+struct CombineResult {
+    error_t error = ERROR_OK;
+    Secret secret;
+};
+
+namespace detail {
+
+inline const char *set_share(void *data, int number, int threshold, size_t size) {
+    (void)threshold;
+    (void)size;
+    return static_cast<const ShareSet *>(data)->c_str(number - 1);
+}
+
+inline const char *span_share(void *data, int number, int threshold, size_t size) {
+    (void)threshold;
+    (void)size;
+    return (*static_cast<std::span<const Share> *>(data))[number - 1].c_str();
+}
+
+inline const char *view_share(void *data, int number, int threshold, size_t size) {
+    (void)threshold;
+    (void)size;
+    return (*static_cast<std::span<const ShareView> *>(data))[number - 1].c_str();
+}
+
+// the degree split chooses for a text secret, as in split_shares
+inline unsigned int text_degree(std::string_view secret, const SplitOptions &options) {
+    if (options.security > 0) {
+        return static_cast<unsigned int>(options.security);
+    }
+    size_t bits = options.hexmode ? 4 * ((secret.size() + 1) & ~static_cast<size_t>(1)) : 8 * secret.size();
+    return bits < MAXDEGREE ? static_cast<unsigned int>(bits) : MAXDEGREE;
+}
+
+} // namespace detail
+
+// split a binary secret of any bytes at 8 * size bits, so embedded and
+// leading zero bytes come back from combine_binary; options.security and
+// options.hexmode do not apply
+inline SplitResult split(std::span<const std::byte> secret, int threshold, int number, const SplitOptions &options = {}) {
+    SplitResult result;
+    result.shares = ShareSet(number, secret.size() < MAXDEGREE / 8 ? 8 * static_cast<unsigned int>(secret.size()) : MAXDEGREE);
+    result.error = c::split_binary(secret.data(), secret.size(), &ShareSet::collect, &result.shares,
+                                   threshold, number, options.diffusion, options.prefix, options.cprng);
+    if (ERROR_OK != result.error) {
+        result.shares = ShareSet();
+    }
+    return result;
+}
+
+// split a hex or ASCII secret, the C API needs it '\0' terminated so it
+// is staged once in wiped storage; the shares are written straight into
+// the result
+inline SplitResult split(std::string_view secret, int threshold, int number, const SplitOptions &options = {}) {
+    SplitResult result;
+    result.shares = ShareSet(number, detail::text_degree(secret, options));
+    detail::Text staged(secret);
+    result.error = c::split(staged.c_str(), &ShareSet::collect, &result.shares,
+                            options.security, threshold, number, options.diffusion,
+                            options.prefix, options.hexmode, options.cprng);
+    if (ERROR_OK != result.error) {
+        result.shares = ShareSet();
+    }
+    return result;
+}
+
+namespace detail {
+
+// shares read in place without copying, the first threshold are used
+inline CombineResult combine(read_share_t *get_share, void *data, size_t available, int threshold, bool binary, const CombineOptions &options) {
+    CombineResult result;
+    if (threshold < 1 || static_cast<size_t>(threshold) > available) {
+        result.error = ERROR_INVALID_THRESHOLD;
+        return result;
+    }
+    result.secret = Secret::buffer();
+    if (binary) {
+        size_t length = 0;
+        result.error = c::combine_binary(result.secret.data(), Secret::capacity, &length,
+                                         get_share, data, threshold, options.diffusion);
+        result.secret.settle(length);
+    } else {
+        result.error = c::combine(result.secret.data(), Secret::capacity,
+                                  get_share, data, threshold, options.diffusion, options.hexmode);
+        result.secret.settle();
+    }
+    if (ERROR_OK != result.error) {
+        result.secret = Secret();
+    }
+    return result;
+}
+
+} // namespace detail
+
+// combine the first threshold shares of a text secret
+inline CombineResult combine(const ShareSet &shares, int threshold, const CombineOptions &options = {}) {
+    return detail::combine(&detail::set_share, const_cast<ShareSet *>(&shares), static_cast<size_t>(shares.size()),
+                           threshold, false, options);
+}
+
+inline CombineResult combine(std::span<const Share> shares, int threshold, const CombineOptions &options = {}) {
+    return detail::combine(&detail::span_share, &shares, shares.size(), threshold, false, options);
+}
+
+// the same without copying the shares first
+inline CombineResult combine(std::span<const ShareView> shares, int threshold, const CombineOptions &options = {}) {
+    return detail::combine(&detail::view_share, &shares, shares.size(), threshold, false, options);
+}
+
+// combine the first threshold shares of a binary secret, options.hexmode does not apply
+inline CombineResult combine_binary(const ShareSet &shares, int threshold, const CombineOptions &options = {}) {
+    return detail::combine(&detail::set_share, const_cast<ShareSet *>(&shares), static_cast<size_t>(shares.size()),
+                           threshold, true, options);
+}
+
+inline CombineResult combine_binary(std::span<const Share> shares, int threshold, const CombineOptions &options = {}) {
+    return detail::combine(&detail::span_share, &shares, shares.size(), threshold, true, options);
+}
+
+inline CombineResult combine_binary(std::span<const ShareView> shares, int threshold, const CombineOptions &options = {}) {
+    return detail::combine(&detail::view_share, &shares, shares.size(), threshold, true, options);
+}
+
+} // namespace ssss
+
+#endif
@@ -0,0 +1,253 @@
+/*
+ *  C++20 coroutine awaitables for split and combine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_SSSS_CORO_HPP_)
+#define _SSSS_CORO_HPP_ 1
+
+#include "shamir.hpp"
+
+#include <concepts>
+#include <coroutine>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// usage:
+//
+//   ssss::Engine engine;
+//   auto post = [&loop](std::coroutine_handle<> h) { loop.post(h); };
+//   ssss::SplitResult r = co_await ssss::split(engine, post, "secret", 3, 5);
+//
+// the job runs on the engine's worker pool and the coroutine is handed to
+// the executor when it completes, nothing blocks and no thread is started
+// per request; a full queue completes at once with ERROR_QUEUE_FULL
+
+namespace ssss {
+
+// schedules a suspended coroutine to be resumed
+template <typename E>
+concept Executor = std::invocable<E &, std::coroutine_handle<>>;
+
+// resumes directly on the worker that finished the job
+struct InlineExecutor {
+    void operator()(std::coroutine_handle<> h) const {
+        h.resume();
+    }
+};
+
+// worker pool and the asynchronous queue feeding it
+class Engine {
+public:
+    explicit Engine(const pool_config_t *config = nullptr, unsigned int entries = 4096)
+        : pool_(worker_pool_create(config)),
+          queue_(nullptr != pool_ ? async_queue_create(pool_, entries) : nullptr) {
+    }
+
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
+
+    ~Engine() {
+        async_queue_destroy(queue_);  // before the pool it runs on
+        worker_pool_destroy(pool_);
+    }
+
+    // false if the workers could not be started
+    explicit operator bool() const noexcept {
+        return nullptr != queue_;
+    }
+
+    worker_pool_t *pool() const noexcept {
+        return pool_;
+    }
+
+    async_queue_t *queue() const noexcept {
+        return queue_;
+    }
+
+private:
+    worker_pool_t *pool_;
+    async_queue_t *queue_;
+};
+
+// common part: submit on suspend, hand the coroutine to the executor on completion
+template <Executor E>
+class Operation {
+public:
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+protected:
+    Operation(Engine &engine, E executor)
+        : queue_(engine.queue()), executor_(std::move(executor)) {
+    }
+
+    // false => not submitted, error_ is set and the coroutine continues at once
+    bool submit(std::coroutine_handle<> handle, async_submission_t &submission) {
+        handle_ = handle;
+        submission.complete = &Operation::completed;
+        submission.complete_data = this;
+        error_t error = async_submit(queue_, &submission, 0);
+        if (ERROR_OK != error) {
+            error_ = error;        // completed() will not run
+            return false;
+        }
+        // completed() may already have run and the coroutine resumed and
+        // destroyed this object, so it must not be touched from here on
+        return true;
+    }
+
+    error_t error_ = ERROR_OK;
+
+private:
+    static void completed(void *data, const async_completion_t *completion) {
+        Operation *op = static_cast<Operation *>(data);
+        op->error_ = completion->error;
+        // the coroutine may finish and destroy op as soon as it is scheduled
+        E executor = std::move(op->executor_);
+        executor(op->handle_);
+    }
+
+    async_queue_t *queue_;
+    E executor_;
+    std::coroutine_handle<> handle_;
+};
+
+template <Executor E>
+class SplitAwaitable : public Operation<E> {
+public:
+    SplitAwaitable(Engine &engine, E executor, std::string_view secret, int threshold, int number, const SplitOptions &options)
+        : Operation<E>(engine, std::move(executor)),
+          secret_(secret), shares_(number), threshold_(threshold), options_(options) {
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        async_submission_t submission = {};
+        submission.op = ASYNC_SPLIT;
+        submission.job.split.secret = secret_.c_str();
+        submission.job.split.process_share = &ShareSet::collect;
+        submission.job.split.data = &shares_;
+        submission.job.split.security = options_.security;
+        submission.job.split.threshold = threshold_;
+        submission.job.split.number = shares_.size();
+        submission.job.split.diffusion = options_.diffusion;
+        submission.job.split.prefix = options_.prefix;
+        submission.job.split.hexmode = options_.hexmode;
+        submission.job.split.cprng = options_.cprng;
+        return this->submit(handle, submission);
+    }
+
+    SplitResult await_resume() {
+        SplitResult result;
+        result.error = this->error_;
+        if (ERROR_OK == result.error) {
+            result.shares = std::move(shares_);
+        }
+        return result;
+    }
+
+private:
+    Secret secret_;
+    ShareSet shares_;
+    int threshold_;
+    SplitOptions options_;
+};
+
+template <Executor E>
+class CombineAwaitable : public Operation<E> {
+public:
+    CombineAwaitable(Engine &engine, E executor, std::span<const char *const> shares, int threshold, const CombineOptions &options)
+        : Operation<E>(engine, std::move(executor)),
+          shares_(shares.begin(), shares.end()), secret_(Secret::buffer()), threshold_(threshold), options_(options) {
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        if (threshold_ < 1 || static_cast<size_t>(threshold_) > shares_.size()) {
+            this->error_ = ERROR_INVALID_THRESHOLD;
+            return false;
+        }
+        async_submission_t submission = {};
+        submission.op = ASYNC_COMBINE;
+        submission.job.combine.secret = secret_.data();
+        submission.job.combine.secret_size = Secret::capacity;
+        submission.job.combine.get_share = &CombineAwaitable::share;
+        submission.job.combine.data = &shares_;
+        submission.job.combine.threshold = threshold_;
+        submission.job.combine.diffusion = options_.diffusion;
+        submission.job.combine.hexmode = options_.hexmode;
+        return this->submit(handle, submission);
+    }
+
+    CombineResult await_resume() {
+        CombineResult result;
+        result.error = this->error_;
+        if (ERROR_OK == result.error) {
+            secret_.settle();
+            result.secret = std::move(secret_);
+        }
+        return result;
+    }
+
+private:
+    static const char *share(void *data, int number, int threshold, size_t size) {
+        (void)threshold;
+        (void)size;
+        return (*static_cast<std::vector<const char *> *>(data))[number - 1];
+    }
+
+    std::vector<const char *> shares_;
+    Secret secret_;
+    int threshold_;
+    CombineOptions options_;
+};
+
+// co_await ssss::split(...) => SplitResult
+template <Executor E>
+SplitAwaitable<E> split(Engine &engine, E executor, std::string_view secret, int threshold, int number, const SplitOptions &options = {}) {
+    return SplitAwaitable<E>(engine, std::move(executor), secret, threshold, number, options);
+}
+
+// co_await ssss::combine(...) => CombineResult, the first threshold shares are used
+template <Executor E>
+CombineAwaitable<E> combine(Engine &engine, E executor, std::span<const char *const> shares, int threshold, const CombineOptions &options = {}) {
+    return CombineAwaitable<E>(engine, std::move(executor), shares, threshold, options);
+}
+
+template <Executor E>
+CombineAwaitable<E> combine(Engine &engine, E executor, const ShareSet &shares, int threshold, const CombineOptions &options = {}) {
+    std::vector<const char *> pointers;
+    for (int i = 0; i < shares.size(); ++i) {
+        pointers.push_back(shares.c_str(i));
+    }
+    return CombineAwaitable<E>(engine, std::move(executor), pointers, threshold, options);
+}
+
+template <Executor E>
+CombineAwaitable<E> combine(Engine &engine, E executor, std::span<const Share> shares, int threshold, const CombineOptions &options = {}) {
+    std::vector<const char *> pointers;
+    for (const Share &share : shares) {
+        pointers.push_back(share.c_str());
+    }
+    return CombineAwaitable<E>(engine, std::move(executor), pointers, threshold, options);
+}
+
+} // namespace ssss
+
+#endif
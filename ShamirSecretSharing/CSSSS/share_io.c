@@ -0,0 +1,810 @@
+/*
+ *  buffered share file I/O over io_uring, or pwrite on the worker pool
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#if defined(__linux__) && !defined(SSSS_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SHARE_IO_URING 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#include "shamir.h"
+#include "pool.h"
+
+// appends to each file gather in a fixed set of buffers, one filling
+// per file; full buffers are queued and written half a ring at a time,
+// by one io_uring_enter for the lot or as one batch of pwrites on the
+// pool.  Every buffer carries its own file offset, so writes may finish
+// in any order and a file is complete once its buffers have come back;
+// with more files than buffers the oldest partly filled buffer is
+// written early to make room.
+// Reads keep SHARE_IO_READ_AHEAD buffers of each file in flight and hand
+// them out in offset order.  One lock covers everything, io_uring system
+// calls included: the callers are share callbacks from several workers
+// and the cost is in the device, not here
+
+#define SHARE_IO_DEPTH 64
+#define SHARE_IO_BUFFER_SIZE (64 * 1024)
+#define SHARE_IO_READ_AHEAD 2
+
+typedef enum {
+    BUFFER_FREE,
+    BUFFER_FILLING,                // appends going in
+    BUFFER_QUEUED,                 // waiting to be submitted
+    BUFFER_IN_FLIGHT,
+    BUFFER_READY                   // read completed
+} buffer_state_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t length;                 // bytes filled, to read, or read
+    size_t done;                   // bytes written, or handed out
+    uint64_t offset;               // file offset of data[0]
+    uint64_t started;              // when filling began, oldest first out
+    int file;
+    buffer_state_t state;
+    bool read;
+    error_t err;                   // pwrite batch result
+} io_buffer_t;
+
+typedef struct {
+    int fd;                        // -1 => slot unused
+    bool write;
+    uint64_t offset;               // next append or read ahead
+    int filling;                   // buffer being appended to, -1 => none
+    int ahead[SHARE_IO_READ_AHEAD];  // reads in offset order
+    int ahead_head;
+    int ahead_count;
+    bool eof;                      // no reads beyond the queued ones
+} io_file_t;
+
+#if defined(SHARE_IO_URING)
+typedef struct {
+    int fd;
+    unsigned int entries;
+    bool fixed;                    // buffers registered
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+} uring_t;
+#endif
+
+struct share_io {
+    share_io_backend_t backend;
+    worker_pool_t *pool;
+    pthread_mutex_t lock;
+
+    io_buffer_t *buffers;
+    unsigned int depth;
+    size_t buffer_size;
+    uint8_t *memory;               // all the buffers
+
+    io_file_t *files;
+    int file_count;
+
+    unsigned int queued;
+    unsigned int in_flight;
+    uint64_t fills;                // buffers started filling, for started
+    error_t err;                   // first failure, reported by flush and close
+
+    int *batch;                    // pwrite batch, depth entries
+#if defined(SHARE_IO_URING)
+    uring_t ring;
+#endif
+};
+
+static void fail(share_io_t *io, error_t err) {
+    if (ERROR_OK == io->err) {
+        io->err = err;
+    }
+}
+
+
+// io_uring
+// ========
+
+#if defined(SHARE_IO_URING)
+
+static int uring_setup(unsigned int entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned int submit, unsigned int complete, unsigned int flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned int opcode, const void *arg, unsigned int count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static void uring_deinit(uring_t *r) {
+    if (NULL != r->sqes) {
+        munmap(r->sqes, r->sqes_size);
+    }
+    if (NULL != r->cq_ring && r->cq_ring != r->sq_ring) {
+        munmap(r->cq_ring, r->cq_ring_size);
+    }
+    if (NULL != r->sq_ring) {
+        munmap(r->sq_ring, r->sq_ring_size);
+    }
+    if (r->fd >= 0) {
+        close(r->fd);
+    }
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+static bool uring_init(uring_t *r, unsigned int entries) {
+    memset(r, 0, sizeof(*r));
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    r->fd = uring_setup(entries, &p);
+    if (r->fd < 0) {
+        r->fd = -1;
+        return false;
+    }
+    r->entries = p.sq_entries;
+
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    r->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_size > r->sq_ring_size) {
+            r->sq_ring_size = r->cq_ring_size;
+        }
+        r->cq_ring_size = r->sq_ring_size;
+    }
+    r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == r->sq_ring) {
+        r->sq_ring = NULL;
+        uring_deinit(r);
+        return false;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == r->cq_ring) {
+            r->cq_ring = NULL;
+            uring_deinit(r);
+            return false;
+        }
+    }
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (MAP_FAILED == r->sqes) {
+        r->sqes = NULL;
+        uring_deinit(r);
+        return false;
+    }
+
+    uint8_t *sq = (uint8_t *)r->sq_ring;
+    r->sq_head = (unsigned int *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned int *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned int *)(sq + p.sq_off.array);
+    uint8_t *cq = (uint8_t *)r->cq_ring;
+    r->cq_head = (unsigned int *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned int *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return true;
+}
+
+// no more than entries are ever in flight, so there is always an entry
+static void uring_prepare(share_io_t *io, int index) {
+    uring_t *r = &io->ring;
+    io_buffer_t *b = &io->buffers[index];
+    unsigned int tail = *r->sq_tail;
+    unsigned int slot = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[slot];
+
+    memset(sqe, 0, sizeof(*sqe));
+    if (b->read) {
+        sqe->opcode = r->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    } else {
+        sqe->opcode = r->fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    }
+    sqe->fd = io->files[b->file].fd;
+    sqe->addr = (uint64_t)(uintptr_t)(b->data + b->done);
+    sqe->len = (uint32_t)(b->length - b->done);
+    sqe->off = b->offset + b->done;
+    sqe->buf_index = (uint16_t)index;
+    sqe->user_data = (uint64_t)index;
+
+    r->sq_array[slot] = slot;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void uring_complete(share_io_t *io, int index, int res) {
+    io_buffer_t *b = &io->buffers[index];
+    --io->in_flight;
+    if (b->read) {
+        if (res < 0) {
+            fail(io, ERROR_CANNOT_READ_INPUT);
+            res = 0;
+        }
+        b->length = (size_t)res;
+        b->done = 0;
+        b->state = BUFFER_READY;
+        return;
+    }
+    if (res <= 0) {
+        fail(io, ERROR_CANNOT_WRITE_OUTPUT);
+        b->state = BUFFER_FREE;
+        return;
+    }
+    b->done += (size_t)res;
+    if (b->done < b->length) {
+        b->state = BUFFER_QUEUED;  // short write, the rest goes again
+        ++io->queued;
+    } else {
+        b->state = BUFFER_FREE;
+    }
+}
+
+static void uring_reap(share_io_t *io) {
+    uring_t *r = &io->ring;
+    unsigned int head = *r->cq_head;
+    unsigned int tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        uring_complete(io, (int)cqe->user_data, cqe->res);
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static void uring_enter_all(share_io_t *io, unsigned int submit, unsigned int complete) {
+    unsigned int flags = 0 != complete ? IORING_ENTER_GETEVENTS : 0;
+    while (uring_enter(io->ring.fd, submit, complete, flags) < 0) {
+        if (EINTR == errno) {
+            continue;
+        }
+        if (EAGAIN == errno || EBUSY == errno) {
+            uring_reap(io);
+            continue;
+        }
+        fail(io, ERROR_CANNOT_WRITE_OUTPUT);
+        return;
+    }
+}
+
+#endif
+
+
+// pwrite
+// ======
+
+static bool pwrite_all(int fd, const uint8_t *data, size_t length, uint64_t offset) {
+    while (0 != length) {
+        ssize_t n = pwrite(fd, data, length, (off_t)offset);
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+static void pwrite_item(void *context, size_t index, int worker) {
+    (void)worker;
+    share_io_t *io = (share_io_t *)context;
+    io_buffer_t *b = &io->buffers[io->batch[index]];
+    bool ok = pwrite_all(io->files[b->file].fd, b->data + b->done, b->length - b->done, b->offset + b->done);
+    b->err = ok ? ERROR_OK : ERROR_CANNOT_WRITE_OUTPUT;
+}
+
+static uint64_t pwrite_cost(void *context, size_t index) {
+    share_io_t *io = (share_io_t *)context;
+    const io_buffer_t *b = &io->buffers[io->batch[index]];
+    return b->length - b->done;
+}
+
+
+// buffers
+// =======
+
+// everything queued goes to the kernel, or is written
+static void submit(share_io_t *io) {
+    if (0 == io->queued) {
+        return;
+    }
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < io->depth; ++i) {
+        if (BUFFER_QUEUED != io->buffers[i].state) {
+            continue;
+        }
+#if defined(SHARE_IO_URING)
+        if (SHARE_IO_BACKEND_URING == io->backend) {
+            uring_prepare(io, (int)i);
+            io->buffers[i].state = BUFFER_IN_FLIGHT;
+            ++io->in_flight;
+            ++count;
+            continue;
+        }
+#endif
+        io->batch[count++] = (int)i;
+    }
+    io->queued = 0;
+
+#if defined(SHARE_IO_URING)
+    if (SHARE_IO_BACKEND_URING == io->backend) {
+        uring_enter_all(io, count, 0);
+        return;
+    }
+#endif
+    worker_pool_run(io->pool, count, pwrite_item, pwrite_cost, io);
+    for (unsigned int k = 0; k < count; ++k) {
+        io_buffer_t *b = &io->buffers[io->batch[k]];
+        if (ERROR_OK != b->err) {
+            fail(io, b->err);
+        }
+        b->state = BUFFER_FREE;
+    }
+}
+
+// block for at least one completion
+static void wait_some(share_io_t *io) {
+#if defined(SHARE_IO_URING)
+    if (SHARE_IO_BACKEND_URING == io->backend && 0 != io->in_flight) {
+        uring_enter_all(io, 0, 1);
+        uring_reap(io);
+    }
+#else
+    (void)io;
+#endif
+}
+
+static void queue_buffer(share_io_t *io, int index) {
+    io->buffers[index].state = BUFFER_QUEUED;
+    if (++io->queued >= io->depth / 2) {
+        submit(io);
+    }
+}
+
+static int acquire(share_io_t *io) {
+    for (;;) {
+        for (unsigned int i = 0; i < io->depth; ++i) {
+            if (BUFFER_FREE == io->buffers[i].state) {
+                return (int)i;
+            }
+        }
+        if (0 == io->queued && 0 == io->in_flight) {
+            // all filling or holding reads: write the oldest partly
+            // filled buffer now, its file starts another at its offset
+            int oldest = -1;
+            for (unsigned int i = 0; i < io->depth; ++i) {
+                io_buffer_t *b = &io->buffers[i];
+                if (BUFFER_FILLING == b->state && (oldest < 0 || b->started < io->buffers[oldest].started)) {
+                    oldest = (int)i;
+                }
+            }
+            if (oldest < 0) {
+                return -1;         // all holding reads
+            }
+            io->files[io->buffers[oldest].file].filling = -1;
+            queue_buffer(io, oldest);
+        }
+        submit(io);
+        wait_some(io);
+    }
+}
+
+// submit and wait until nothing is in flight
+static void drain(share_io_t *io) {
+    for (int f = 0; f < io->file_count; ++f) {
+        io_file_t *file = &io->files[f];
+        if (file->fd >= 0 && file->write && file->filling >= 0) {
+            queue_buffer(io, file->filling);
+            file->filling = -1;
+        }
+    }
+    submit(io);
+    while (0 != io->in_flight || 0 != io->queued) {
+        submit(io);
+        wait_some(io);
+    }
+}
+
+
+// API
+// ===
+
+share_io_t *share_io_create(const share_io_config_t *config) {
+    share_io_config_t defaults = { .backend = SHARE_IO_BACKEND_AUTO };
+    if (NULL == config) {
+        config = &defaults;
+    }
+    share_io_t *io = calloc(1, sizeof(share_io_t));
+    if (NULL == io) {
+        return NULL;
+    }
+    io->pool = config->pool;
+    io->depth = 0 != config->depth ? config->depth : SHARE_IO_DEPTH;
+    if (io->depth < 2) {
+        io->depth = 2;
+    }
+    io->buffer_size = 0 != config->buffer_size ? config->buffer_size : SHARE_IO_BUFFER_SIZE;
+    io->buffers = calloc(io->depth, sizeof(io_buffer_t));
+    io->batch = calloc(io->depth, sizeof(int));
+    if (NULL == io->buffers || NULL == io->batch ||
+        0 != posix_memalign((void **)&io->memory, 4096, io->depth * io->buffer_size)) {
+        free(io->buffers);
+        free(io->batch);
+        free(io);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < io->depth; ++i) {
+        io->buffers[i].data = io->memory + i * io->buffer_size;
+        io->buffers[i].state = BUFFER_FREE;
+    }
+    pthread_mutex_init(&io->lock, NULL);
+
+    io->backend = SHARE_IO_BACKEND_PWRITE;
+#if defined(SHARE_IO_URING)
+    io->ring.fd = -1;
+    if (SHARE_IO_BACKEND_PWRITE != config->backend && uring_init(&io->ring, io->depth)) {
+        io->backend = SHARE_IO_BACKEND_URING;
+        if (io->ring.entries < io->depth) {
+            io->depth = io->ring.entries;
+        }
+
+        // without registered buffers, say under a small RLIMIT_MEMLOCK,
+        // the plain read and write operations do
+        struct iovec *iov = calloc(io->depth, sizeof(struct iovec));
+        if (NULL != iov) {
+            for (unsigned int i = 0; i < io->depth; ++i) {
+                iov[i].iov_base = io->buffers[i].data;
+                iov[i].iov_len = io->buffer_size;
+            }
+            io->ring.fixed = 0 == uring_register(io->ring.fd, IORING_REGISTER_BUFFERS, iov, io->depth);
+            free(iov);
+        }
+    }
+#endif
+    if (SHARE_IO_BACKEND_URING == config->backend && SHARE_IO_BACKEND_URING != io->backend) {
+        share_io_destroy(io);
+        return NULL;
+    }
+    return io;
+}
+
+error_t share_io_destroy(share_io_t *io) {
+    if (NULL == io) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    pthread_mutex_lock(&io->lock);
+    drain(io);
+    error_t err = io->err;
+    for (int f = 0; f < io->file_count; ++f) {
+        if (io->files[f].fd >= 0 && 0 != close(io->files[f].fd) && io->files[f].write) {
+            fail(io, ERROR_CANNOT_WRITE_OUTPUT);
+            err = io->err;
+        }
+    }
+    pthread_mutex_unlock(&io->lock);
+
+#if defined(SHARE_IO_URING)
+    if (io->ring.fd >= 0) {
+        uring_deinit(&io->ring);  // also unregisters the buffers
+    }
+#endif
+    pthread_mutex_destroy(&io->lock);
+    free(io->files);
+    free(io->batch);
+    free(io->buffers);
+    free(io->memory);
+    free(io);
+    return err;
+}
+
+share_io_backend_t share_io_backend(const share_io_t *io) {
+    return io->backend;
+}
+
+int share_io_open(share_io_t *io, const char *path, bool write) {
+    if (NULL == io || NULL == path) {
+        return -1;
+    }
+    int fd = write ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600) : open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&io->lock);
+    int f;
+    for (f = 0; f < io->file_count && io->files[f].fd >= 0; ++f) {
+    }
+    if (f == io->file_count) {
+        io_file_t *files = realloc(io->files, sizeof(io_file_t) * (size_t)(io->file_count + 1));
+        if (NULL == files) {
+            pthread_mutex_unlock(&io->lock);
+            close(fd);
+            return -1;
+        }
+        io->files = files;
+        ++io->file_count;
+    }
+    io_file_t *file = &io->files[f];
+    memset(file, 0, sizeof(*file));
+    file->fd = fd;
+    file->write = write;
+    file->filling = -1;
+    pthread_mutex_unlock(&io->lock);
+    return f;
+}
+
+static bool valid_file(const share_io_t *io, int file, bool write) {
+    return file >= 0 && file < io->file_count && io->files[file].fd >= 0 && io->files[file].write == write;
+}
+
+// with the lock held
+static error_t append(share_io_t *io, int file, const void *buffer, size_t length) {
+    if (!valid_file(io, file, true)) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    io_file_t *f = &io->files[file];
+    const uint8_t *in = (const uint8_t *)buffer;
+    while (0 != length) {
+        if (f->filling < 0) {
+            int b = acquire(io);
+            if (b < 0) {
+                fail(io, ERROR_BUFFER_TOO_SMALL);  // every buffer holds reads
+                return io->err;
+            }
+            io_buffer_t *buf = &io->buffers[b];
+            buf->file = file;
+            buf->offset = f->offset;
+            buf->started = io->fills++;
+            buf->length = 0;
+            buf->done = 0;
+            buf->read = false;
+            buf->state = BUFFER_FILLING;
+            f->filling = b;
+        }
+        io_buffer_t *buf = &io->buffers[f->filling];
+        size_t n = io->buffer_size - buf->length < length ? io->buffer_size - buf->length : length;
+        memcpy(buf->data + buf->length, in, n);
+        buf->length += n;
+        f->offset += n;
+        in += n;
+        length -= n;
+        if (io->buffer_size == buf->length) {
+            int b = f->filling;
+            f->filling = -1;
+            queue_buffer(io, b);
+        }
+    }
+    return io->err;
+}
+
+error_t share_io_append(share_io_t *io, int file, const void *buffer, size_t length) {
+    if (NULL == io || (NULL == buffer && 0 != length)) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    pthread_mutex_lock(&io->lock);
+    error_t err = append(io, file, buffer, length);
+    pthread_mutex_unlock(&io->lock);
+    return err;
+}
+
+// top up the reads ahead of file, with the lock held
+static void read_ahead(share_io_t *io, int file) {
+    io_file_t *f = &io->files[file];
+    while (!f->eof && f->ahead_count < SHARE_IO_READ_AHEAD) {
+        int b = acquire(io);
+        if (b < 0) {
+            if (0 == f->ahead_count) {
+                fail(io, ERROR_BUFFER_TOO_SMALL);  // more files being read than buffers
+            }
+            break;
+        }
+        io_buffer_t *buf = &io->buffers[b];
+        buf->file = file;
+        buf->offset = f->offset;
+        buf->length = io->buffer_size;
+        buf->done = 0;
+        buf->read = true;
+        f->offset += io->buffer_size;
+        f->ahead[(f->ahead_head + f->ahead_count) % SHARE_IO_READ_AHEAD] = b;
+        ++f->ahead_count;
+#if defined(SHARE_IO_URING)
+        if (SHARE_IO_BACKEND_URING == io->backend) {
+            buf->state = BUFFER_QUEUED;
+            ++io->queued;
+            continue;
+        }
+#endif
+        // pread straight away, there is nothing to overlap it with
+        ssize_t n;
+        do {
+            n = pread(f->fd, buf->data, buf->length, (off_t)buf->offset);
+        } while (n < 0 && EINTR == errno);
+        if (n < 0) {
+            fail(io, ERROR_CANNOT_READ_INPUT);
+            n = 0;
+        }
+        buf->length = (size_t)n;
+        buf->state = BUFFER_READY;
+    }
+    submit(io);
+}
+
+// the oldest read of file is finished with
+static void pop_read(share_io_t *io, io_file_t *f) {
+    io->buffers[f->ahead[f->ahead_head]].state = BUFFER_FREE;
+    f->ahead_head = (f->ahead_head + 1) % SHARE_IO_READ_AHEAD;
+    --f->ahead_count;
+}
+
+ssize_t share_io_read(share_io_t *io, int file, void *buffer, size_t size) {
+    if (NULL == io || NULL == buffer) {
+        return -1;
+    }
+    pthread_mutex_lock(&io->lock);
+    if (!valid_file(io, file, false)) {
+        pthread_mutex_unlock(&io->lock);
+        return -1;
+    }
+    io_file_t *f = &io->files[file];
+    uint8_t *out = (uint8_t *)buffer;
+    size_t count = 0;
+    while (count < size) {
+        if (0 == f->ahead_count) {
+            read_ahead(io, file);
+            if (0 == f->ahead_count) {
+                break;             // end of file, or an error
+            }
+        }
+        io_buffer_t *b = &io->buffers[f->ahead[f->ahead_head]];
+        while (BUFFER_READY != b->state) {
+            submit(io);
+            wait_some(io);
+        }
+        if (ERROR_OK != io->err) {
+            break;
+        }
+
+        size_t n = b->length - b->done < size - count ? b->length - b->done : size - count;
+        memcpy(out + count, b->data + b->done, n);
+        b->done += n;
+        count += n;
+        if (b->done < b->length) {
+            continue;
+        }
+
+        // a short read is the end of the file, or the later reads are
+        // at the wrong offsets and go again from where this one stopped
+        bool full = b->length == io->buffer_size;
+        bool empty = 0 == b->length;
+        uint64_t next = b->offset + b->length;
+        pop_read(io, f);
+        if (!full) {
+            while (0 != f->ahead_count) {
+                io_buffer_t *later = &io->buffers[f->ahead[f->ahead_head]];
+                while (BUFFER_READY != later->state) {
+                    submit(io);
+                    wait_some(io);
+                }
+                pop_read(io, f);
+            }
+            f->eof = empty;
+            f->offset = next;
+            if (f->eof) {
+                break;
+            }
+        }
+        read_ahead(io, file);
+    }
+    ssize_t result = ERROR_OK != io->err ? -1 : (ssize_t)count;
+    pthread_mutex_unlock(&io->lock);
+    return result;
+}
+
+error_t share_io_flush(share_io_t *io) {
+    if (NULL == io) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    pthread_mutex_lock(&io->lock);
+    drain(io);
+    error_t err = io->err;
+    pthread_mutex_unlock(&io->lock);
+    return err;
+}
+
+error_t share_io_close(share_io_t *io, int file) {
+    if (NULL == io) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    pthread_mutex_lock(&io->lock);
+    if (file < 0 || file >= io->file_count || io->files[file].fd < 0) {
+        pthread_mutex_unlock(&io->lock);
+        return ERROR_INPUT_IS_NULL;
+    }
+    io_file_t *f = &io->files[file];
+    drain(io);
+    while (0 != f->ahead_count) {
+        pop_read(io, f);           // drained, so all ready
+    }
+    if (0 != close(f->fd) && f->write) {
+        fail(io, ERROR_CANNOT_WRITE_OUTPUT);
+    }
+    f->fd = -1;
+    error_t err = io->err;
+    pthread_mutex_unlock(&io->lock);
+    return err;
+}
+
+
+// adapters
+// ========
+
+error_t share_io_output(void *data, const uint8_t *buffer, size_t length, int number, int total) {
+    (void)total;
+    share_io_files_t *files = (share_io_files_t *)data;
+    int file = 0 == number ? files->secret : files->files[number - 1];
+    return share_io_append(files->io, file, buffer, length);
+}
+
+ssize_t share_io_input(void *data, int index, void *buffer, size_t size) {
+    share_io_files_t *files = (share_io_files_t *)data;
+    return share_io_read(files->io, files->files[index], buffer, size);
+}
+
+error_t share_io_process_share(void *data, const char *buffer, size_t length, int number, int total) {
+    (void)total;
+    share_io_files_t *files = (share_io_files_t *)data;
+    share_io_t *io = files->io;
+
+    // share and newline together, other workers append to the same files
+    pthread_mutex_lock(&io->lock);
+    error_t err = append(io, files->files[number - 1], buffer, length);
+    if (ERROR_OK == err) {
+        err = append(io, files->files[number - 1], "\n", 1);
+    }
+    pthread_mutex_unlock(&io->lock);
+    return err;
+}
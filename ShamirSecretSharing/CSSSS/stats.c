@@ -0,0 +1,151 @@
+/*
+ *  per thread phase timings and operation counters
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "shamir.h"
+#include "stats.h"
+
+// every thread that records gets a shard, pushed once onto a lock-free
+// list and never removed so the totals keep the work of finished threads;
+// only the owning thread writes a shard, readers load the same words
+// atomically and never block it
+
+typedef struct stats_shard {
+    struct stats_shard *next;
+    stats_t counters;
+} stats_shard_t;
+
+int stats_on = 0;
+
+static stats_shard_t *shards = NULL;
+static __thread stats_shard_t *local_shard = NULL;
+
+static const char *phase_names[STATS_maximum] = {
+    [STATS_CPRNG] = "cprng",
+    [STATS_IMPORT] = "import",
+    [STATS_DIFFUSION] = "diffusion",
+    [STATS_EVALUATE] = "evaluate",
+    [STATS_RESTORE] = "restore",
+    [STATS_PRINT] = "print",
+    [STATS_CALLBACK] = "callback"
+};
+
+static stats_shard_t *shard(void) {
+    if (NULL == local_shard) {
+        stats_shard_t *s = (stats_shard_t *)calloc(1, sizeof(stats_shard_t));
+        if (NULL == s) {
+            return NULL;           // this thread goes uncounted
+        }
+        stats_shard_t *head = __atomic_load_n(&shards, __ATOMIC_ACQUIRE);
+        do {
+            s->next = head;
+        } while (!__atomic_compare_exchange_n(&shards, &head, s, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+        local_shard = s;
+    }
+    return local_shard;
+}
+
+// single writer, so no read-modify-write is needed
+static void add(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+uint64_t stats_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void stats_record(stats_phase_t phase, uint64_t nanoseconds) {
+    stats_shard_t *s = shard();
+    if (NULL != s) {
+        add(&s->counters.calls[phase], 1);
+        add(&s->counters.nanoseconds[phase], nanoseconds);
+    }
+}
+
+void stats_count(stats_counter_t counter, uint64_t n) {
+    stats_shard_t *s = shard();
+    if (NULL == s) {
+        return;
+    }
+    switch (counter) {
+        case STATS_COUNT_SPLIT:
+            add(&s->counters.splits, n);
+            break;
+        case STATS_COUNT_COMBINE:
+            add(&s->counters.combines, n);
+            break;
+        case STATS_COUNT_MULT:
+            add(&s->counters.field_mults, n);
+            break;
+        case STATS_COUNT_INVERT:
+            add(&s->counters.field_inverts, n);
+            break;
+    }
+}
+
+void stats_enable(bool enable) {
+    __atomic_store_n(&stats_on, enable ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+bool stats_enabled(void) {
+    return __atomic_load_n(&stats_on, __ATOMIC_RELAXED);
+}
+
+// stats_t is all uint64_t, so it can be summed as an array
+#define STATS_WORDS (sizeof(stats_t) / sizeof(uint64_t))
+
+static void accumulate(stats_t *total, const stats_shard_t *s) {
+    uint64_t *t = (uint64_t *)total;
+    const uint64_t *c = (const uint64_t *)&s->counters;
+    for (size_t i = 0; i < STATS_WORDS; ++i) {
+        t[i] += __atomic_load_n(&c[i], __ATOMIC_RELAXED);
+    }
+}
+
+void stats_read(stats_t *stats) {
+    if (NULL == stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(stats_t));
+    for (stats_shard_t *s = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); NULL != s; s = s->next) {
+        accumulate(stats, s);
+    }
+}
+
+void stats_read_thread(stats_t *stats) {
+    if (NULL == stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(stats_t));
+    if (NULL != local_shard) {
+        accumulate(stats, local_shard);
+    }
+}
+
+const char *stats_phase_name(stats_phase_t phase) {
+    return phase < STATS_maximum ? phase_names[phase] : "unknown";
+}
@@ -0,0 +1,66 @@
+/*
+ *  recording side of the statistics API
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_STATS_H_)
+#define _STATS_H_ 1
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "shamir.h"
+
+// usage:
+//
+//   uint64_t start = stats_start();
+//   ... phase ...
+//   stats_stop(STATS_PRINT, start);
+//
+// when disabled each call is one relaxed load and a branch
+
+typedef enum {
+    STATS_COUNT_SPLIT,
+    STATS_COUNT_COMBINE,
+    STATS_COUNT_MULT,
+    STATS_COUNT_INVERT
+} stats_counter_t;
+
+extern int stats_on;                             // read relaxed
+
+uint64_t stats_clock(void);                      // nanoseconds, monotonic
+void stats_record(stats_phase_t phase, uint64_t nanoseconds);
+void stats_count(stats_counter_t counter, uint64_t n);
+
+// zero when disabled, so a phase that started before enabling is not recorded
+static inline uint64_t stats_start(void) {
+    return __atomic_load_n(&stats_on, __ATOMIC_RELAXED) ? stats_clock() : 0;
+}
+
+static inline void stats_stop(stats_phase_t phase, uint64_t start) {
+    if (0 != start) {
+        stats_record(phase, stats_clock() - start);
+    }
+}
+
+static inline void stats_increment(stats_counter_t counter, uint64_t n) {
+    if (__atomic_load_n(&stats_on, __ATOMIC_RELAXED)) {
+        stats_count(counter, n);
+    }
+}
+
+#endif
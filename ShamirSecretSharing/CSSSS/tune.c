@@ -0,0 +1,460 @@
+/*
+ *  start up tuning of the field arithmetic and cost estimates
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+#include "shamir.h"
+#include "field.h"
+#include "stats.h"
+#include "histogram.h"
+
+// every candidate is timed in doubling batches until a batch takes
+// TUNE_MIN_NS, the best per operation time of TUNE_REPEATS batches is
+// kept; the secret restore is timed with whole combines at TUNE_THRESHOLD
+// over rotating share sets, so the weight cache does not flatter Lagrange
+//
+// every degree up to TUNE_DENSE_MAX is timed; above it only one degree in
+// TUNE_SPARSE_STEP bits is, the degrees in between take the choices of
+// the timed degree above them and timings interpolated between the two,
+// which keeps a first tune to about a second
+//
+// the tuning file is plain text, a header naming the format, the build
+// and the CPU followed by one line per degree:
+//
+//   ssss-tuning 1
+//   build gmp
+//   cpu Intel(R) Xeon(R) ...
+//   128 fixed fixed lagrange 95 5210
+//   ...        (degree mult invert restore mult_ns invert_ns)
+
+#define TUNE_MIN_NS 20000
+#define TUNE_REPEATS 3
+#define TUNE_THRESHOLD 4
+#define TUNE_DENSE_MAX 1024
+#define TUNE_SPARSE_STEP 512
+#define TUNE_FORMAT "ssss-tuning 1"
+#define DEGREES (MAXDEGREE / 8)
+
+#if defined(SSSS_NO_GMP)
+#define TUNE_BUILD "fixed"
+#else
+#define TUNE_BUILD "gmp"
+#endif
+
+field_choice_t field_choice[MAXDEGREE / 8 + 1];
+
+static uint64_t mult_ns[MAXDEGREE / 8 + 1];       // zero => not tuned
+static uint64_t invert_ns[MAXDEGREE / 8 + 1];
+
+static const char *backend_names[FIELD_BACKEND_maximum] = {
+    [FIELD_BACKEND_AUTO] = "auto",
+    [FIELD_BACKEND_GENERIC] = "generic",
+    [FIELD_BACKEND_LIMBS] = "limbs",
+    [FIELD_BACKEND_FIXED] = "fixed"
+};
+
+static const char *restore_names[RESTORE_maximum] = {
+    [RESTORE_AUTO] = "auto",
+    [RESTORE_GAUSS] = "gauss",
+    [RESTORE_LAGRANGE] = "lagrange"
+};
+
+const char *field_backend_name(field_backend_t backend) {
+    return backend < FIELD_BACKEND_maximum ? backend_names[backend] : "unknown";
+}
+
+const char *restore_name(restore_t restore) {
+    return restore < RESTORE_maximum ? restore_names[restore] : "unknown";
+}
+
+static int lookup(const char *name, const char **names, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (0 == strcmp(name, names[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+// timing
+
+typedef void tune_run_t(void *context, unsigned long iterations);
+
+static uint64_t measure(tune_run_t *run, void *context) {
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < TUNE_REPEATS; ++r) {
+        unsigned long iterations = 1;
+        for (;;) {
+            uint64_t start = stats_clock();
+            run(context, iterations);
+            uint64_t elapsed = stats_clock() - start;
+            if (elapsed >= TUNE_MIN_NS) {
+                if (elapsed / iterations < best) {
+                    best = elapsed / iterations;
+                }
+                break;
+            }
+            iterations *= 2;
+        }
+    }
+    return best > 0 ? best : 1;
+}
+
+typedef struct {
+    poly_degree_t pd;
+    mpz_t x, y, z;
+} field_bench_t;
+
+static void run_mult(void *context, unsigned long iterations) {
+    field_bench_t *b = (field_bench_t *)context;
+    for (unsigned long i = 0; i < iterations; ++i) {
+        field_mult(b->z, b->z, b->y, &b->pd);
+    }
+}
+
+static void run_invert(void *context, unsigned long iterations) {
+    field_bench_t *b = (field_bench_t *)context;
+    for (unsigned long i = 0; i < iterations; ++i) {
+        field_invert(b->z, b->x, &b->pd);
+    }
+}
+
+// a fixed pseudo random field element, never zero
+static void element(mpz_t x, unsigned int degree, uint64_t seed) {
+    unsigned char bytes[MAXDEGREE / 8];
+    for (unsigned int i = 0; i < degree / 8; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        bytes[i] = (unsigned char)seed;
+    }
+    mpz_import(x, degree / 8, 1, 1, 0, 0, bytes);
+    mpz_setbit(x, 0);
+}
+
+typedef struct {
+    const char **shares;           // 2 * number entries, the list twice
+    int number;
+    unsigned long next;
+} combine_bench_t;
+
+static void run_combine(void *context, unsigned long iterations) {
+    combine_bench_t *b = (combine_bench_t *)context;
+    char secret[MAXDEGREE / 4 + 2];
+    for (unsigned long i = 0; i < iterations; ++i) {
+        wrapped_combine(secret, sizeof(secret), b->shares + b->next++ % b->number, TUNE_THRESHOLD, false, true);
+    }
+}
+
+static void tune_field(unsigned int degree) {
+    field_choice_t *choice = &field_choice[degree / 8];
+    field_bench_t b;
+    field_init(&b.pd, degree);
+    mpz_init(b.x);
+    mpz_init(b.y);
+    mpz_init(b.z);
+    element(b.x, degree, 0x9e3779b97f4a7c15ULL ^ degree);
+    element(b.y, degree, 0xc2b2ae3d27d4eb4fULL ^ degree);
+    mpz_set(b.z, b.x);
+
+    uint64_t best_mult = UINT64_MAX;
+    uint64_t best_invert = UINT64_MAX;
+    field_backend_t mult = FIELD_BACKEND_GENERIC;
+    field_backend_t invert = FIELD_BACKEND_GENERIC;
+    for (int backend = FIELD_BACKEND_GENERIC; backend < FIELD_BACKEND_maximum; ++backend) {
+        if (! field_backend_available((field_backend_t)backend, degree)) {
+            continue;
+        }
+        choice->mult = backend;
+        choice->invert = backend;
+        uint64_t m = measure(run_mult, &b);
+        uint64_t v = measure(run_invert, &b);
+        if (m < best_mult) {
+            best_mult = m;
+            mult = (field_backend_t)backend;
+        }
+        if (v < best_invert) {
+            best_invert = v;
+            invert = (field_backend_t)backend;
+        }
+    }
+    choice->mult = mult;
+    choice->invert = invert;
+    mult_ns[degree / 8] = best_mult;
+    invert_ns[degree / 8] = best_invert;
+
+    mpz_clear(b.x);
+    mpz_clear(b.y);
+    mpz_clear(b.z);
+    field_deinit(&b.pd);
+}
+
+static error_t tune_restore(unsigned int degree) {
+    char random_bytes[TUNE_THRESHOLD * MAXDEGREE / 8];
+    uint64_t seed = 0x2545f4914f6cdd1dULL ^ degree;
+    for (size_t i = 0; i < sizeof(random_bytes); ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        random_bytes[i] = (char)seed;
+    }
+    int number = 2 * TUNE_THRESHOLD;
+    char secret[MAXDEGREE / 4 + 1];
+    memset(secret, 'a', degree / 4);
+    secret[degree / 4] = '\0';
+
+    char **shares = wrapped_allocate_shares(number);
+    if (NULL == shares) {
+        return ERROR_MALLOC_FAILED;
+    }
+    error_t err = wrapped_split(shares, secret, degree, TUNE_THRESHOLD, number, false, NULL, true,
+                                random_bytes, sizeof(random_bytes));
+    const char *list[2 * number];
+    for (int i = 0; i < 2 * number; ++i) {
+        list[i] = shares[i % number];
+    }
+
+    combine_bench_t b = { .shares = list, .number = number, .next = 0 };
+    uint64_t best = UINT64_MAX;
+    restore_t restore = RESTORE_LAGRANGE;
+    for (int r = RESTORE_GAUSS; ERROR_OK == err && r < RESTORE_maximum; ++r) {
+        field_choice[degree / 8].restore = r;
+        uint64_t t = measure(run_combine, &b);
+        if (t < best) {
+            best = t;
+            restore = (restore_t)r;
+        }
+    }
+    field_choice[degree / 8].restore = restore;
+    wrapped_free_shares(shares, number);
+    return err;
+}
+
+static error_t tune_degree(unsigned int degree) {
+    // the benchmarks are not the application's work
+    int stats = __atomic_exchange_n(&stats_on, 0, __ATOMIC_RELAXED);
+    int histogram = __atomic_exchange_n(&histogram_on, 0, __ATOMIC_RELAXED);
+    tune_field(degree);
+    error_t err = tune_restore(degree);
+    __atomic_store_n(&stats_on, stats, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram_on, histogram, __ATOMIC_RELAXED);
+    return err;
+}
+
+
+// the degrees between the timed degrees low and high
+static void interpolate(unsigned int low, unsigned int high) {
+    const field_choice_t *above = &field_choice[high / 8];
+    for (unsigned int degree = low + 8; degree < high; degree += 8) {
+        field_choice_t *choice = &field_choice[degree / 8];
+        choice->mult = field_backend_available(above->mult, degree) ? above->mult : FIELD_BACKEND_LIMBS;
+        choice->invert = field_backend_available(above->invert, degree) ? above->invert : FIELD_BACKEND_LIMBS;
+        choice->restore = above->restore;
+        uint64_t offset = degree - low, span = high - low;
+        mult_ns[degree / 8] = (mult_ns[low / 8] * (span - offset) + mult_ns[high / 8] * offset) / span;
+        invert_ns[degree / 8] = (invert_ns[low / 8] * (span - offset) + invert_ns[high / 8] * offset) / span;
+    }
+}
+
+
+// tuning file
+
+static void cpu_name(char *buffer, size_t size) {
+    snprintf(buffer, size, "unknown");
+#if defined(__APPLE__)
+    size_t length = size;
+    if (0 != sysctlbyname("machdep.cpu.brand_string", buffer, &length, NULL, 0)) {
+        snprintf(buffer, size, "unknown");
+    }
+#else
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (NULL == f) {
+        return;
+    }
+    char line[256];
+    while (NULL != fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        if (0 == strncmp(line, "model name", 10) && NULL != colon) {
+            colon += strspn(colon + 1, " \t") + 1;
+            colon[strcspn(colon, "\r\n")] = '\0';
+            snprintf(buffer, size, "%s", colon);
+            break;
+        }
+    }
+    fclose(f);
+#endif
+}
+
+// true if every degree was read and is usable in this build
+static bool load(const char *path, const char *cpu) {
+    FILE *f = fopen(path, "r");
+    if (NULL == f) {
+        return false;
+    }
+    field_choice_t choice[MAXDEGREE / 8 + 1];
+    uint64_t mult[MAXDEGREE / 8 + 1], invert[MAXDEGREE / 8 + 1];
+    memset(choice, 0, sizeof(choice));
+
+    char line[256];
+    bool ok = NULL != fgets(line, sizeof(line), f) && 0 == strcmp(line, TUNE_FORMAT "\n");
+    ok = ok && NULL != fgets(line, sizeof(line), f) && 0 == strcmp(line, "build " TUNE_BUILD "\n");
+    ok = ok && NULL != fgets(line, sizeof(line), f) && 0 == strncmp(line, "cpu ", 4);
+    if (ok) {
+        line[strcspn(line, "\r\n")] = '\0';
+        ok = 0 == strcmp(line + 4, cpu);
+    }
+    int count = 0;
+    while (ok && NULL != fgets(line, sizeof(line), f)) {
+        unsigned int degree;
+        char m[16], v[16], r[16];
+        uint64_t mns, vns;
+        if (6 != sscanf(line, "%u %15s %15s %15s %" SCNu64 " %" SCNu64, &degree, m, v, r, &mns, &vns)) {
+            ok = false;
+            break;
+        }
+        int mb = lookup(m, backend_names, FIELD_BACKEND_maximum);
+        int vb = lookup(v, backend_names, FIELD_BACKEND_maximum);
+        int rb = lookup(r, restore_names, RESTORE_maximum);
+        ok = field_size_valid(degree) && 0 == choice[degree / 8].mult && 0 != mns && 0 != vns
+            && mb > 0 && vb > 0 && rb > 0
+            && field_backend_available((field_backend_t)mb, degree)
+            && field_backend_available((field_backend_t)vb, degree);
+        if (ok) {
+            choice[degree / 8].mult = mb;
+            choice[degree / 8].invert = vb;
+            choice[degree / 8].restore = rb;
+            mult[degree / 8] = mns;
+            invert[degree / 8] = vns;
+            ++count;
+        }
+    }
+    fclose(f);
+    if (! ok || DEGREES != count) {
+        return false;
+    }
+    memcpy(field_choice, choice, sizeof(choice));
+    memcpy(mult_ns, mult, sizeof(mult));
+    memcpy(invert_ns, invert, sizeof(invert));
+    return true;
+}
+
+static error_t save(const char *path, const char *cpu) {
+    size_t length = strlen(path) + sizeof(".tmp");
+    char temporary[length];
+    snprintf(temporary, length, "%s.tmp", path);
+    FILE *f = fopen(temporary, "w");
+    if (NULL == f) {
+        return ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    bool ok = fprintf(f, TUNE_FORMAT "\nbuild " TUNE_BUILD "\ncpu %s\n", cpu) > 0;
+    for (unsigned int degree = 8; ok && degree <= MAXDEGREE; degree += 8) {
+        const field_choice_t *c = &field_choice[degree / 8];
+        ok = fprintf(f, "%u %s %s %s %" PRIu64 " %" PRIu64 "\n", degree,
+                     backend_names[c->mult], backend_names[c->invert], restore_names[c->restore],
+                     mult_ns[degree / 8], invert_ns[degree / 8]) > 0;
+    }
+    ok = 0 == fclose(f) && ok && 0 == rename(temporary, path);
+    if (! ok) {
+        remove(temporary);
+        return ERROR_CANNOT_WRITE_OUTPUT;
+    }
+    return ERROR_OK;
+}
+
+error_t tune(const char *path) {
+    char cpu[128];
+    cpu_name(cpu, sizeof(cpu));
+    if (NULL != path && load(path, cpu)) {
+        return ERROR_OK;
+    }
+    unsigned int previous = 0;
+    for (unsigned int degree = 8; degree <= MAXDEGREE; degree += 8) {
+        bool timed = degree <= TUNE_DENSE_MAX || MAXDEGREE == degree
+            || 0 == (degree - TUNE_DENSE_MAX) % TUNE_SPARSE_STEP;
+        if (! timed) {
+            continue;
+        }
+        error_t err = tune_degree(degree);
+        if (ERROR_OK != err) {
+            return err;
+        }
+        interpolate(previous, degree);
+        previous = degree;
+    }
+    return NULL != path ? save(path, cpu) : ERROR_OK;
+}
+
+error_t tuning_read(unsigned int degree, tuning_t *tuning) {
+    if (NULL == tuning) {
+        return ERROR_INPUT_IS_NULL;
+    }
+    if (! field_size_valid(degree)) {
+        return ERROR_INVALID_SECURITY_LEVEL;
+    }
+    tuning->degree = degree;
+    tuning->mult = field_mult_backend(degree);
+    tuning->invert = field_invert_backend(degree);
+    tuning->restore = field_restore(degree);
+    tuning->mult_ns = mult_ns[degree / 8];
+    tuning->invert_ns = invert_ns[degree / 8];
+    return ERROR_OK;
+}
+
+
+// cost estimates, counting the field operations of split and combine;
+// they only read the timings, benchmarking is left to tune, which would
+// change field_choice and pause the statistics under running threads
+
+static bool measured(unsigned int degree) {
+    return field_size_valid(degree) && 0 != mult_ns[degree / 8];
+}
+
+uint64_t split_cost(unsigned int degree, int threshold, int number) {
+    if (! measured(degree) || threshold < 1 || number < 1) {
+        return 0;
+    }
+    // horner: threshold - 1 multiplications per share
+    return (uint64_t)number * (uint64_t)(threshold - 1) * mult_ns[degree / 8];
+}
+
+uint64_t combine_cost(unsigned int degree, int threshold) {
+    if (! measured(degree) || threshold < 1) {
+        return 0;
+    }
+    uint64_t t = (uint64_t)threshold;
+    uint64_t mults;
+    if (RESTORE_LAGRANGE == field_restore(degree) && threshold >= 2 && threshold <= 8) {
+        // weights, powers and the batch inversion, not cached, then one per share
+        mults = 3 * t * t + 4 * t;
+    } else {
+        // the Vandermonde rows, then sum over m < t of m * (2m + 2) for the elimination
+        mults = t * t + 2 * (t - 1) * t * (2 * t - 1) / 6 + (t - 1) * t + 1;
+    }
+    return mults * mult_ns[degree / 8] + invert_ns[degree / 8];
+}
@@ -12,19 +12,24 @@ import CSSSS
 
 public class ShamirSecretSharing {
     
-    fileprivate static let maxDegree = 1024
+    fileprivate static let maxDegree = 8192
     
     public static func split(secret: String, threshold t: Int, numberOfShare n: Int) -> [String]? {
-        guard let randomByteString = generateRandomBytes(length: t * 128) else {
+        // the split at 8 * secret.utf8.count bits draws that many bytes per coefficient
+        guard var randomBytes = generateRandomBytes(length: t * secret.utf8.count) else {
             return nil
         }
+        defer {
+            randomBytes.resetBytes(in: 0..<randomBytes.count)
+        }
         
-        let randomBytesPointer = randomByteString.utf8String
         guard let sharesCPointer = CSSSS.wrapped_allocate_shares(Int32(n)) else {
             return nil
         }
         
-        let error = CSSSS.wrapped_split(sharesCPointer, secret.utf8String, 0, Int32(t), Int32(n), false, nil, false, randomBytesPointer, randomByteString.characters.count)
+        let error = randomBytes.withUnsafeBytes { (randomBytesPointer: UnsafePointer<Int8>) in
+            CSSSS.wrapped_split(sharesCPointer, secret.utf8String, 0, Int32(t), Int32(n), false, nil, false, randomBytesPointer, randomBytes.count)
+        }
         
         defer {
             // Free memory
@@ -32,15 +37,9 @@ public class ShamirSecretSharing {
         }
 
         if error.rawValue == 0 {
-            var i = 0
             var shares = [String]()
-            while sharesCPointer[i] != nil {
-                let shareCPointer = sharesCPointer[i]!
-                
-                let share = String(cString: shareCPointer)
-                shares.append(share)
-                
-                i += 1
+            for i in 0..<n {
+                shares.append(String(cString: sharesCPointer[i]!))
             }
             
             return shares
@@ -63,6 +62,62 @@ public class ShamirSecretSharing {
         
         return nil
     }
+    
+    public static func split(secret: Data, threshold t: Int, numberOfShare n: Int) -> [String]? {
+        // the split at 8 * secret.count bits draws secret.count bytes per coefficient
+        guard var randomBytes = generateRandomBytes(length: t * secret.count) else {
+            return nil
+        }
+        defer {
+            randomBytes.resetBytes(in: 0..<randomBytes.count)
+        }
+        
+        guard let sharesCPointer = CSSSS.wrapped_allocate_shares(Int32(n)) else {
+            return nil
+        }
+        
+        let error = secret.withUnsafeBytes { (secretPointer: UnsafePointer<UInt8>) in
+            randomBytes.withUnsafeBytes { (randomBytesPointer: UnsafePointer<Int8>) in
+                CSSSS.wrapped_split_binary(sharesCPointer, secretPointer, secret.count, Int32(t), Int32(n), false, nil, randomBytesPointer, randomBytes.count)
+            }
+        }
+        
+        defer {
+            // Free memory
+            _ = CSSSS.wrapped_free_shares(sharesCPointer, Int32(n))
+        }
+        
+        if error.rawValue == 0 {
+            var shares = [String]()
+            for i in 0..<n {
+                shares.append(String(cString: sharesCPointer[i]!))
+            }
+            
+            return shares
+        }
+        
+        return nil
+    }
+    
+    public static func combineData(shares: [String]) -> Data? {
+        
+        let tempSize = maxDegree / 8
+        
+        let resultCPointer = UnsafeMutablePointer<UInt8>.allocate(capacity: tempSize)
+        defer {
+            resultCPointer.initialize(to: 0, count: tempSize)
+            resultCPointer.deallocate(capacity: tempSize)
+        }
+        
+        var length = 0
+        let error = CSSSS.wrapped_combine_binary(resultCPointer, tempSize, &length, arrayToPointer(shares), Int32(shares.count), false)
+        
+        if error.rawValue == 0 {
+            return Data(bytes: resultCPointer, count: length)
+        }
+        
+        return nil
+    }
 }
 
 extension ShamirSecretSharing {
@@ -84,14 +139,14 @@ extension ShamirSecretSharing {
         return buffer
     }
     
-    fileprivate static func generateRandomBytes(length: Int) -> String? {
+    fileprivate static func generateRandomBytes(length: Int) -> Data? {
         
         var keyData = Data(count: length)
         let result = keyData.withUnsafeMutableBytes {
             SecRandomCopyBytes(kSecRandomDefault, keyData.count, $0)
         }
         if result == errSecSuccess {
-            return keyData.base64EncodedString()
+            return keyData
         } else {
             print("Problem generating random bytes")
             return nil
@@ -0,0 +1,130 @@
+/*
+ *  checks and share helpers for the C library tests
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#if !defined(_TEST_H_)
+#define _TEST_H_ 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shamir.h"
+
+// every test is one executable run by ctest, main returns test_result()
+
+static int test_failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++test_failures;                                                    \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_ERROR(expected, call)                                             \
+    do {                                                                        \
+        error_t e_ = (call);                                                    \
+        if ((expected) != e_) {                                                 \
+            fprintf(stderr, "%s:%d: %s returned %d, expected %d\n", __FILE__, __LINE__, #call, (int)e_, (int)(expected)); \
+            ++test_failures;                                                    \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_OK(call) CHECK_ERROR(ERROR_OK, call)
+
+static inline int test_result(void) {
+    if (test_failures) {
+        fprintf(stderr, "%d check(s) failed\n", test_failures);
+    }
+    return test_failures ? 1 : 0;
+}
+
+// deterministic test data, not for keys
+static inline uint32_t test_random(void) {
+    static uint64_t state = 0x9e3779b97f4a7c15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint32_t)(state >> 32);
+}
+
+static inline void test_fill(void *buffer, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        ((uint8_t *)buffer)[i] = (uint8_t)test_random();
+    }
+}
+
+
+// a cprng_t whose bytes repeat from the seed in argument, so two splits
+// with it draw the same coefficients
+static inline void *test_cprng_open(void *argument) {
+    uint64_t *state = malloc(sizeof(uint64_t));
+    if (NULL != state) {
+        *state = *(const uint64_t *)argument;
+    }
+    return state;
+}
+
+static inline int test_cprng_close(void *data) {
+    free(data);
+    return 0;
+}
+
+static inline ssize_t test_cprng_read(void *data, void *buffer, size_t nbytes) {
+    uint64_t *state = (uint64_t *)data;
+    for (size_t i = 0; i < nbytes; ++i) {
+        *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+        ((uint8_t *)buffer)[i] = (uint8_t)(*state >> 56);
+    }
+    return (ssize_t)nbytes;
+}
+
+#define TEST_CPRNG(seed) { .open = test_cprng_open, .close = test_cprng_close, .read = test_cprng_read, .argument = (void *)(seed) }
+
+// share lines kept in memory: a process_share_t that stores share n in
+// line[n - 1] and a read_share_t that returns the shares from first on
+
+#define TEST_MAX_SHARES 16
+
+typedef struct {
+    char line[TEST_MAX_SHARES][MAXLINELEN];
+    int first;                     // read_share returns line[first + number - 1]
+} share_store_t;
+
+static inline error_t store_share(void *data, const char *buffer, size_t length, int number, int total) {
+    share_store_t *store = (share_store_t *)data;
+    (void)total;
+    if (number < 1 || number > TEST_MAX_SHARES || length >= MAXLINELEN) {
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+    memcpy(store->line[number - 1], buffer, length);
+    store->line[number - 1][length] = '\0';
+    return ERROR_OK;
+}
+
+static inline const char *read_stored_share(void *data, int number, int threshold, size_t size) {
+    share_store_t *store = (share_store_t *)data;
+    (void)threshold;
+    (void)size;
+    int i = store->first + number - 1;
+    return i >= 0 && i < TEST_MAX_SHARES ? store->line[i] : NULL;
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ *  ChaCha20-Poly1305 against RFC 8439
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+#include "aead.h"
+
+static size_t from_hex(uint8_t *out, const char *hex) {
+    size_t n = 0;
+    for (; hex[0] && hex[1]; hex += 2) {
+        unsigned int v;
+        sscanf(hex, "%2x", &v);
+        out[n++] = (uint8_t)v;
+    }
+    return n;
+}
+
+// RFC 8439 section 2.8.2
+static const char plaintext[] =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+static const char key_hex[] = "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f";
+static const char nonce_hex[] = "070000004041424344454647";
+static const char ad_hex[] = "50515253c0c1c2c3c4c5c6c7";
+static const char ciphertext_hex[] =
+    "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+    "3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+    "92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+    "3ff4def08e4b7a9de576d26586cec64b6116";
+static const char tag_hex[] = "1ae10b594f09e26a7e902ecbd0600691";
+
+// one ChaCha20 block as RFC 8439 section 2.3 writes it, one word at a time
+#define ROTL(v, n) ((uint32_t)((v) << (n) | (v) >> (32 - (n))))
+#define QUARTER(a, b, c, d)                                 \
+    do {                                                    \
+        a += b; d ^= a; d = ROTL(d, 16);                    \
+        c += d; b ^= c; b = ROTL(b, 12);                    \
+        a += b; d ^= a; d = ROTL(d, 8);                     \
+        c += d; b ^= c; b = ROTL(b, 7);                     \
+    } while (0)
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void reference_block(uint8_t out[64], const uint8_t key[32], const uint8_t nonce[12], uint32_t counter) {
+    uint32_t s[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+    for (int i = 0; i < 8; ++i) {
+        s[4 + i] = le32(key + 4 * i);
+    }
+    s[12] = counter;
+    for (int i = 0; i < 3; ++i) {
+        s[13 + i] = le32(nonce + 4 * i);
+    }
+    uint32_t x[16];
+    memcpy(x, s, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        QUARTER(x[0], x[4], x[8], x[12]);
+        QUARTER(x[1], x[5], x[9], x[13]);
+        QUARTER(x[2], x[6], x[10], x[14]);
+        QUARTER(x[3], x[7], x[11], x[15]);
+        QUARTER(x[0], x[5], x[10], x[15]);
+        QUARTER(x[1], x[6], x[11], x[12]);
+        QUARTER(x[2], x[7], x[8], x[13]);
+        QUARTER(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        uint32_t v = x[i] + s[i];
+        out[4 * i] = (uint8_t)v;
+        out[4 * i + 1] = (uint8_t)(v >> 8);
+        out[4 * i + 2] = (uint8_t)(v >> 16);
+        out[4 * i + 3] = (uint8_t)(v >> 24);
+    }
+}
+
+// the AEAD ciphertext is the plaintext xor the key stream from counter 1
+static void reference_encrypt(uint8_t *out, const uint8_t *in, size_t length, const uint8_t key[32], const uint8_t nonce[12]) {
+    uint8_t block[64];
+    for (size_t i = 0; i < length; ++i) {
+        if (0 == i % 64) {
+            reference_block(block, key, nonce, (uint32_t)(1 + i / 64));
+        }
+        out[i] = in[i] ^ block[i % 64];
+    }
+}
+
+int main(void) {
+    uint8_t key[AEAD_KEY_SIZE];
+    uint8_t nonce[AEAD_NONCE_SIZE];
+    uint8_t ad[12];
+    uint8_t expected[sizeof(plaintext)];
+    uint8_t expected_tag[AEAD_TAG_SIZE];
+    from_hex(key, key_hex);
+    from_hex(nonce, nonce_hex);
+    from_hex(ad, ad_hex);
+    size_t length = from_hex(expected, ciphertext_hex);
+    from_hex(expected_tag, tag_hex);
+    CHECK(strlen(plaintext) == length);
+
+    // the RFC vector, and the reference key stream agrees with it
+    uint8_t out[sizeof(plaintext)];
+    uint8_t tag[AEAD_TAG_SIZE];
+    aead_encrypt(out, tag, (const uint8_t *)plaintext, length, ad, sizeof(ad), key, nonce);
+    CHECK(0 == memcmp(expected, out, length));
+    CHECK(0 == memcmp(expected_tag, tag, AEAD_TAG_SIZE));
+    reference_encrypt(out, (const uint8_t *)plaintext, length, key, nonce);
+    CHECK(0 == memcmp(expected, out, length));
+
+    uint8_t back[sizeof(plaintext)];
+    CHECK(aead_decrypt(back, expected, length, expected_tag, ad, sizeof(ad), key, nonce));
+    CHECK(0 == memcmp(plaintext, back, length));
+    expected[5] ^= 1;
+    memset(back, 0, sizeof(back));
+    CHECK(!aead_decrypt(back, expected, length, expected_tag, ad, sizeof(ad), key, nonce));
+    CHECK(0 == back[0]);                   // untouched
+    expected[5] ^= 1;
+    ad[0] ^= 1;
+    CHECK(!aead_decrypt(back, expected, length, expected_tag, ad, sizeof(ad), key, nonce));
+    ad[0] ^= 1;
+
+    // lengths through the four block path, whole blocks and the tail, in place
+    enum { LONGEST = 4 * 256 + 3 * 64 + 17 };
+    static uint8_t message[LONGEST], reference[LONGEST], encrypted[LONGEST];
+    test_fill(message, sizeof(message));
+    for (size_t n = 0; n <= LONGEST; n += 1 + n / 7) {
+        reference_encrypt(reference, message, n, key, nonce);
+        memcpy(encrypted, message, n);
+        aead_encrypt(encrypted, tag, encrypted, n, NULL, 0, key, nonce);
+        CHECK(0 == memcmp(reference, encrypted, n));
+        CHECK(aead_decrypt(encrypted, encrypted, n, tag, NULL, 0, key, nonce));
+        CHECK(0 == memcmp(message, encrypted, n));
+    }
+    return test_result();
+}
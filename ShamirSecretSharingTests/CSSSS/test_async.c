@@ -0,0 +1,158 @@
+/*
+ *  asynchronous submission/completion queues
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "test.h"
+
+#define JOBS 100
+
+static share_store_t stores[JOBS];
+static char secrets[JOBS][64];
+static char results[JOBS][300];
+static int completed[JOBS];
+
+static async_submission_t split_submission(int i) {
+    async_submission_t s = { .op = ASYNC_SPLIT, .user_data = (uint64_t)i };
+    s.job.split = (split_job_t){
+        .secret = secrets[i],
+        .process_share = store_share,
+        .data = &stores[i],
+        .threshold = 3,
+        .number = 5,
+    };
+    return s;
+}
+
+// split everything, then combine everything, through an 8 entry queue
+static void round_trip(async_queue_t *queue) {
+    int fd = async_queue_fd(queue);
+    CHECK(fd >= 0);
+    int submitted = 0, reaped = 0;
+    memset(completed, 0, sizeof(completed));
+    while (reaped < 2 * JOBS) {
+        while (submitted < 2 * JOBS) {
+            int i = submitted % JOBS;
+            async_submission_t s = split_submission(i);
+            if (submitted >= JOBS) {
+                if (1 != completed[i]) {
+                    break;         // its shares are not there yet
+                }
+                s.op = ASYNC_COMBINE;
+                stores[i].first = 2;
+                s.job.combine = (combine_job_t){
+                    .secret = results[i],
+                    .secret_size = sizeof(results[i]),
+                    .get_share = read_stored_share,
+                    .data = &stores[i],
+                    .threshold = 3,
+                };
+            }
+            if (ERROR_QUEUE_FULL == async_submit(queue, &s, 0)) {
+                break;
+            }
+            ++submitted;
+        }
+        struct pollfd p = { .fd = fd, .events = POLLIN };
+        CHECK(1 == poll(&p, 1, 5000));
+        async_completion_t c[4];
+        unsigned int n = async_reap(queue, c, 4, 0);
+        for (unsigned int k = 0; k < n; ++k) {
+            CHECK(ERROR_OK == c[k].error);
+            CHECK(c[k].user_data < JOBS);
+            ++completed[c[k].user_data];
+            ++reaped;
+        }
+    }
+    for (int i = 0; i < JOBS; ++i) {
+        CHECK(2 == completed[i]);
+        CHECK(0 == strcmp(results[i], secrets[i]));
+    }
+}
+
+// a split whose first share is held until the test lets it go
+static volatile int long_job_running = 0;
+static volatile int release_long_job = 0;
+
+static error_t blocking_share(void *data, const char *buffer, size_t length, int number, int total) {
+    __atomic_store_n(&long_job_running, 1, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(&release_long_job, __ATOMIC_ACQUIRE)) {
+        usleep(1000);
+    }
+    return store_share(data, buffer, length, number, total);
+}
+
+static int callback_count = 0;
+
+static void count_completion(void *data, const async_completion_t *completion) {
+    CHECK(ERROR_OK == completion->error);
+    __atomic_add_fetch((int *)data, 1, __ATOMIC_RELAXED);
+}
+
+int main(void) {
+    for (int i = 0; i < JOBS; ++i) {
+        snprintf(secrets[i], sizeof(secrets[i]), "async secret %d", i);
+    }
+    pool_config_t config = { .workers = 3 };
+    worker_pool_t *pool = worker_pool_create(&config);
+    async_queue_t *queue = async_queue_create(pool, 8);
+    CHECK(NULL != queue);
+    round_trip(queue);
+
+    // jobs submitted while a long one runs complete without waiting for it
+    async_submission_t s = split_submission(0);
+    s.job.split.process_share = blocking_share;
+    s.user_data = JOBS;
+    CHECK_OK(async_submit(queue, &s, 0));
+    while (!__atomic_load_n(&long_job_running, __ATOMIC_ACQUIRE)) {
+        usleep(1000);
+    }
+    for (int i = 1; i <= 4; ++i) {
+        s = split_submission(i);
+        CHECK_OK(async_submit(queue, &s, 0));
+    }
+    async_completion_t c[8];
+    unsigned int n = 0;
+    for (int tries = 0; n < 4 && tries < 50; ++tries) {
+        n += async_reap(queue, c + n, 8 - n, 100);
+    }
+    CHECK(4 == n);
+    for (unsigned int k = 0; k < n; ++k) {
+        CHECK(JOBS != c[k].user_data);
+    }
+    __atomic_store_n(&release_long_job, 1, __ATOMIC_RELEASE);
+    CHECK(1 == async_reap(queue, c, 8, 5000));
+    CHECK(JOBS == c[0].user_data);
+
+    // completion callbacks instead of the ring, and destroy runs what is left
+    for (int i = 0; i < 8; ++i) {
+        s = split_submission(i);
+        s.complete = count_completion;
+        s.complete_data = &callback_count;
+        CHECK_OK(async_submit(queue, &s, -1));
+    }
+    async_queue_destroy(queue);
+    CHECK(8 == callback_count);
+
+    CHECK(NULL == async_queue_create(NULL, 8));
+    CHECK_ERROR(ERROR_INPUT_IS_NULL, async_submit(NULL, &s, 0));
+    worker_pool_destroy(pool);
+    return test_result();
+}
@@ -0,0 +1,289 @@
+/*
+ *  share bundles written, appended to, read back and combined
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define BUNDLE "test_bundle.bundle"
+#define FIRST 5000                 // more records than one write buffer holds
+#define MORE 1000
+
+// the value stored for id by generation; its length depends on the id
+static size_t value_of(uint8_t *value, uint64_t id, int generation) {
+    size_t length = 8 + 8 * (id % 5);
+    for (size_t i = 0; i < length; ++i) {
+        value[i] = (uint8_t)(id * 31 + i * 7 + generation);
+    }
+    return length;
+}
+
+// ids 3 * k for the first generation, appended out of order
+static uint64_t first_id(int k) {
+    return 3 * (uint64_t)((k * 761u) % FIRST);  // 761 is prime to FIRST
+}
+
+static void check_share(const bundle_t *bundle, uint64_t id, int generation) {
+    uint8_t value[MAXDEGREE / 8];
+    size_t length = value_of(value, id, generation);
+    bundle_share_t share;
+    CHECK_OK(bundle_find(bundle, id, &share));
+    CHECK(id == share.id && (int)(id % 7) + 1 == share.number);
+    CHECK(length == share.length && 0 == memcmp(value, share.value, length));
+}
+
+static void write_first(void) {
+    bundle_writer_t *writer = bundle_writer_open(BUNDLE, false);
+    CHECK(NULL != writer);
+    if (NULL == writer) {
+        return;
+    }
+    uint8_t value[MAXDEGREE / 8];
+    for (int k = 0; k < FIRST; ++k) {
+        uint64_t id = first_id(k);
+        size_t length = value_of(value, id, 0);
+        CHECK_OK(bundle_append(writer, id, (int)(id % 7) + 1, value, length));
+    }
+    CHECK(NULL == bundle_open(BUNDLE));  // unfinished until closed
+    CHECK_OK(bundle_writer_close(writer));
+
+    bundle_t *bundle = bundle_open(BUNDLE);
+    CHECK(NULL != bundle);
+    CHECK(FIRST == bundle_count(bundle));
+    for (int k = 0; k < FIRST; ++k) {
+        check_share(bundle, 3 * (uint64_t)k, 0);
+    }
+    bundle_share_t share;
+    CHECK_ERROR(ERROR_INVALID_SHARE, bundle_find(bundle, 4, &share));
+    CHECK_ERROR(ERROR_INVALID_SHARE, bundle_find(bundle, 3 * FIRST, &share));
+    CHECK(2 == bundle_search(bundle, 4));
+    CHECK(FIRST == bundle_search(bundle, UINT64_MAX));
+    bundle_close(bundle);
+}
+
+// new ids between the old ones, and every tenth old id replaced
+static void append_more(void) {
+    bundle_writer_t *writer = bundle_writer_open(BUNDLE, true);
+    CHECK(NULL != writer);
+    if (NULL == writer) {
+        return;
+    }
+    uint8_t value[MAXDEGREE / 8];
+    for (int k = 0; k < MORE; ++k) {
+        uint64_t id = 3 * (uint64_t)k + 1;
+        size_t length = value_of(value, id, 1);
+        CHECK_OK(bundle_append(writer, id, (int)(id % 7) + 1, value, length));
+        if (k < FIRST / 10) {
+            id = 30 * (uint64_t)k;
+            length = value_of(value, id, 1);
+            CHECK_OK(bundle_append(writer, id, (int)(id % 7) + 1, value, length));
+        }
+    }
+
+    // the bundle reads as it was until the writer is closed
+    bundle_t *bundle = bundle_open(BUNDLE);
+    CHECK(NULL != bundle && FIRST == bundle_count(bundle));
+    if (NULL != bundle) {
+        check_share(bundle, 30, 0);
+        bundle_close(bundle);
+    }
+    CHECK_OK(bundle_writer_close(writer));
+
+    bundle = bundle_open(BUNDLE);
+    CHECK(NULL != bundle);
+    CHECK(FIRST + MORE == bundle_count(bundle));
+    for (int k = 0; k < FIRST; ++k) {
+        check_share(bundle, 3 * (uint64_t)k, 0 == k % 10 ? 1 : 0);
+    }
+    for (int k = 0; k < MORE; ++k) {
+        check_share(bundle, 3 * (uint64_t)k + 1, 1);
+    }
+    // in id order
+    bundle_share_t previous, share;
+    CHECK_OK(bundle_entry(bundle, 0, &previous));
+    for (size_t i = 1; i < bundle_count(bundle); ++i) {
+        CHECK_OK(bundle_entry(bundle, i, &share));
+        CHECK(previous.id < share.id);
+        previous = share;
+    }
+    CHECK(ERROR_OK != bundle_entry(bundle, bundle_count(bundle), &share));
+    bundle_close(bundle);
+}
+
+// split share lines in, the same lines out
+static void share_lines(void) {
+    share_store_t store = {0};
+    uint64_t seed = 9;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    CHECK_OK(split("a bundled secret", store_share, &store, 0, 3, 5, false, "holder", false, &cprng));
+
+    bundle_writer_t *writer = bundle_writer_open(BUNDLE, false);
+    CHECK(NULL != writer);
+    if (NULL == writer) {
+        return;
+    }
+    for (int i = 0; i < 5; ++i) {
+        CHECK_OK(bundle_append_share(writer, 77, store.line[i], strlen(store.line[i])));
+        CHECK_OK(bundle_append_share(writer, 100 + i, store.line[i], strlen(store.line[i])));
+    }
+    CHECK_ERROR(ERROR_INVALID_SHARE, bundle_append_share(writer, 1, "holder-x-00", 11));
+    CHECK_ERROR(ERROR_SHARE_HAS_ILLEGAL_LENGTH, bundle_append(writer, 1, 1, "", 0));
+    CHECK_ERROR(ERROR_INVALID_SHARE, bundle_append(writer, 1, -1, "x", 1));
+    CHECK_OK(bundle_writer_close(writer));
+
+    bundle_t *bundle = bundle_open(BUNDLE);
+    CHECK(NULL != bundle && 6 == bundle_count(bundle));
+    for (int i = 0; NULL != bundle && i < 5; ++i) {
+        bundle_share_t share;
+        char line[MAXLINELEN];
+        CHECK_OK(bundle_find(bundle, 100 + i, &share));
+        CHECK_OK(bundle_print_share(line, sizeof(line), &share));
+        CHECK(0 == strcmp(line, store.line[i] + strlen("holder-")));
+        CHECK_ERROR(ERROR_BUFFER_TOO_SMALL, bundle_print_share(line, strlen(line), &share));
+    }
+    if (NULL != bundle) {
+        bundle_share_t share;
+        CHECK_OK(bundle_find(bundle, 77, &share));
+        CHECK(5 == share.number);  // the last of an id wins
+        bundle_close(bundle);
+    }
+}
+
+#define HOLDERS 20
+#define SECRETS 3000               // several combine chunks
+
+static void holder_path(char *path, size_t size, int holder) {
+    snprintf(path, size, "test_bundle.holder-%d", holder);
+}
+
+static void secret_of(uint8_t *secret, uint64_t id) {
+    memset(secret, 0, 32);
+    secret[31 - id % 32] = (uint8_t)id;       // leading zeros too
+    secret[id % 3] ^= (uint8_t)(id >> 8);
+}
+
+// SECRETS ids split to HOLDERS bundles; id 5 is missing from the last holder
+static void split_to_bundles(int threshold) {
+    bundle_writer_t *writers[HOLDERS];
+    for (int h = 0; h < HOLDERS; ++h) {
+        char path[64];
+        holder_path(path, sizeof(path), h);
+        writers[h] = bundle_writer_open(path, false);
+        CHECK(NULL != writers[h]);
+    }
+    uint64_t seed = (uint64_t)threshold;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    for (uint64_t id = 0; id < SECRETS; ++id) {
+        uint8_t secret[32];
+        secret_of(secret, id);
+        bundle_target_t target = {.bundles = writers, .count = 5 == id ? HOLDERS - 1 : HOLDERS, .id = 7 * id};
+        CHECK_OK(split_binary(secret, sizeof(secret), bundle_process_share, &target, threshold, HOLDERS, false, NULL, &cprng));
+    }
+    for (int h = 0; h < HOLDERS; ++h) {
+        if (NULL != writers[h]) {
+            CHECK_OK(bundle_writer_close(writers[h]));
+        }
+    }
+}
+
+// the secrets from the last threshold holders, through bundle_combine
+static void combine_from_bundles(int threshold, worker_pool_t *pool) {
+    bundle_t *bundles[HOLDERS];
+    for (int k = 0; k < threshold; ++k) {
+        char path[64];
+        holder_path(path, sizeof(path), HOLDERS - 1 - k);
+        bundles[k] = bundle_open(path);
+        CHECK(NULL != bundles[k]);
+        if (NULL == bundles[k]) {
+            return;
+        }
+    }
+    bundle_writer_t *output = bundle_writer_open(BUNDLE, false);
+    CHECK(NULL != output);
+    size_t combined = 0;
+    CHECK_OK(bundle_combine(output, bundles, threshold, false, pool, &combined));
+    CHECK(SECRETS - 1 == combined);
+    CHECK_OK(bundle_writer_close(output));
+
+    bundle_t *secrets = bundle_open(BUNDLE);
+    CHECK(NULL != secrets && SECRETS - 1 == bundle_count(secrets));
+    for (uint64_t id = 0; NULL != secrets && id < SECRETS; ++id) {
+        bundle_share_t share;
+        if (5 == id) {
+            CHECK_ERROR(ERROR_INVALID_SHARE, bundle_find(secrets, 7 * id, &share));
+            continue;
+        }
+        uint8_t secret[32];
+        secret_of(secret, id);
+        CHECK_OK(bundle_find(secrets, 7 * id, &share));
+        CHECK(0 == share.number && 32 == share.length && 0 == memcmp(secret, share.value, 32));
+    }
+    if (NULL != secrets) {
+        bundle_close(secrets);
+    }
+
+    // one holder twice: every id fails and none is written
+    if (threshold > 1) {
+        bundle_t *twice = bundles[1];
+        bundles[1] = bundles[0];
+        output = bundle_writer_open(BUNDLE, false);
+        CHECK_ERROR(ERROR_SHARES_INCONSISTENT, bundle_combine(output, bundles, threshold, false, pool, &combined));
+        CHECK(0 == combined);
+        CHECK_OK(bundle_writer_close(output));
+        bundles[1] = twice;
+    }
+    for (int k = 0; k < threshold; ++k) {
+        bundle_close(bundles[k]);
+    }
+}
+
+int main(void) {
+    write_first();
+    append_more();
+    share_lines();
+
+    pool_config_t config = { .workers = 4 };
+    worker_pool_t *pool = worker_pool_create(&config);
+    CHECK(NULL != pool);
+    static const int thresholds[] = {1, 3, HOLDERS};
+    for (size_t i = 0; i < sizeof(thresholds) / sizeof(thresholds[0]); ++i) {
+        split_to_bundles(thresholds[i]);
+        combine_from_bundles(thresholds[i], pool);
+        combine_from_bundles(thresholds[i], NULL);
+    }
+    worker_pool_destroy(pool);
+    for (int h = 0; h < HOLDERS; ++h) {
+        char path[64];
+        holder_path(path, sizeof(path), h);
+        remove(path);
+    }
+    bundle_writer_t *output = bundle_writer_open(BUNDLE, false);
+    bundle_t *none[1] = {NULL};
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, bundle_combine(output, none, 0, false, NULL, NULL));
+    CHECK_OK(bundle_writer_close(output));
+    CHECK(NULL == bundle_open("test_bundle.missing"));
+    FILE *f = fopen(BUNDLE, "wb");
+    CHECK(NULL != f);
+    if (NULL != f) {
+        fputs("not a bundle, but long enough for a header to be read from it..", f);
+        fclose(f);
+    }
+    CHECK(NULL == bundle_open(BUNDLE));
+    CHECK(NULL == bundle_writer_open(BUNDLE, true));
+    remove(BUNDLE);
+    return test_result();
+}
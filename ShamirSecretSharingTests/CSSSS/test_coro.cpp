@@ -0,0 +1,168 @@
+/*
+ *  C++20 coroutine awaitables for split and combine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <errno.h>                 // glibc's error_t must not clash with the library's
+
+#include "shamir_coro.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+
+static std::atomic<int> failures{0};
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                         \
+        }                                                                       \
+    } while (0)
+
+// coroutines resumed on the test thread
+struct Loop {
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::coroutine_handle<>> queue;
+
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            queue.push_back(h);
+        }
+        cv.notify_one();
+    }
+
+    std::coroutine_handle<> take() {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [this] { return !queue.empty(); });
+        std::coroutine_handle<> h = queue.front();
+        queue.pop_front();
+        return h;
+    }
+};
+
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::abort(); }
+    };
+};
+
+static std::atomic<int> done{0};
+
+template <ssss::Executor E>
+Task round_trip(ssss::Engine &engine, E executor, int i) {
+    std::string secret = "coroutine secret " + std::to_string(i);
+    ssss::SplitResult split = co_await ssss::split(engine, executor, secret, 3, 5);
+    CHECK(ssss::ERROR_OK == split.error);
+    if (ssss::ERROR_OK == split.error) {
+        ssss::CombineResult combined = co_await ssss::combine(engine, executor, split.shares, 3);
+        CHECK(ssss::ERROR_OK == combined.error);
+        CHECK(combined.secret.view() == secret);
+    }
+    ++done;
+}
+
+// the failure of a job that ran comes back, not the ssss::ERROR_OK of its submission
+template <ssss::Executor E>
+Task failing_split(ssss::Engine &engine, E executor) {
+    ssss::SplitOptions options;
+    options.security = 8;          // too small for the secret
+    ssss::SplitResult split = co_await ssss::split(engine, executor, "a secret longer than a byte", 3, 5, options);
+    CHECK(ssss::ERROR_INPUT_STRING_TOO_LONG == split.error);
+    ++done;
+}
+
+Task full_queue(ssss::Engine &engine) {
+    ssss::SplitResult split = co_await ssss::split(engine, ssss::InlineExecutor{}, "secret", 3, 5);
+    CHECK(ssss::ERROR_QUEUE_FULL == split.error);
+    ++done;
+}
+
+static std::atomic<bool> release{false};
+
+static ssss::error_t blocking_share(void *data, const char *buffer, size_t length, int number, int total) {
+    (void)data;
+    (void)buffer;
+    (void)length;
+    (void)number;
+    (void)total;
+    while (!release) {
+        usleep(1000);
+    }
+    return ssss::ERROR_OK;
+}
+
+int main() {
+    ssss::pool_config_t config = {};
+    config.workers = 2;
+    {
+        ssss::Engine engine(&config, 256);  // room for every job at once
+        CHECK(static_cast<bool>(engine));
+        Loop loop;
+        auto post = [&loop](std::coroutine_handle<> h) { loop.post(h); };
+        const int jobs = 50;
+        for (int i = 0; i < jobs; ++i) {
+            round_trip(engine, post, i);
+        }
+        while (done < jobs) {
+            loop.take().resume();
+        }
+
+        done = 0;
+        for (int i = 0; i < jobs; ++i) {
+            round_trip(engine, ssss::InlineExecutor{}, i);
+            failing_split(engine, ssss::InlineExecutor{});
+        }
+        while (done < 2 * jobs) {
+            usleep(1000);
+        }
+    }
+
+    // a full queue completes at once
+    {
+        ssss::Engine engine(&config, 1);
+        ssss::async_submission_t submission = {};
+        submission.op = ssss::ASYNC_SPLIT;
+        submission.job.split.secret = "blocked";
+        submission.job.split.process_share = blocking_share;
+        submission.job.split.threshold = 2;
+        submission.job.split.number = 2;
+        CHECK(ssss::ERROR_OK == ssss::c::async_submit(engine.queue(), &submission, 0));
+        done = 0;
+        full_queue(engine);
+        CHECK(1 == done);
+        release = true;
+        ssss::async_completion_t completion;
+        CHECK(1 == ssss::c::async_reap(engine.queue(), &completion, 1, 5000));
+    }
+
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures.load());
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/*
+ *  field kernels: fixed limbs and generic limbs against the mpz code
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+#include "field.h"
+
+// a random non zero element of degree bits
+static void random_element(mpz_t x, unsigned int degree) {
+    unsigned char bytes[MAXDEGREE / 8];
+    test_fill(bytes, degree / 8);
+    bytes[0] |= 1;
+    mpz_import(x, degree / 8, 1, 1, 0, 0, bytes);
+}
+
+static void use_backend(unsigned int degree, field_backend_t backend) {
+    field_choice[degree / 8].mult = (unsigned char)backend;
+    field_choice[degree / 8].invert = (unsigned char)backend;
+}
+
+// multiply, invert and evaluate with backend and with the mpz code
+static void check_backend(unsigned int degree, field_backend_t backend, int rounds) {
+    poly_degree_t pd;
+    field_init(&pd, (int)degree);
+    mpz_t x, y, expected, actual, coeff[4];
+    mpz_init(x);
+    mpz_init(y);
+    mpz_init(expected);
+    mpz_init(actual);
+    for (int i = 0; i < 4; ++i) {
+        mpz_init(coeff[i]);
+    }
+
+    for (int k = 0; k < rounds; ++k) {
+        random_element(x, degree);
+        random_element(y, degree);
+        for (int i = 0; i < 4; ++i) {
+            random_element(coeff[i], degree);
+        }
+
+        use_backend(degree, FIELD_BACKEND_GENERIC);
+        field_mult(expected, x, y, &pd);
+        use_backend(degree, backend);
+        field_mult(actual, x, y, &pd);
+        CHECK(0 == mpz_cmp(expected, actual));
+
+        use_backend(degree, FIELD_BACKEND_GENERIC);
+        field_invert(expected, x, &pd);
+        use_backend(degree, backend);
+        field_invert(actual, x, &pd);
+        CHECK(0 == mpz_cmp(expected, actual));
+
+        // x * x^-1 == 1
+        field_mult(y, x, actual, &pd);
+        CHECK(0 == mpz_cmp_ui(y, 1));
+
+        use_backend(degree, FIELD_BACKEND_GENERIC);
+        horner(4, expected, x, (const mpz_t *)coeff, &pd);
+        use_backend(degree, backend);
+        horner(4, actual, x, (const mpz_t *)coeff, &pd);
+        CHECK(0 == mpz_cmp(expected, actual));
+    }
+
+    use_backend(degree, FIELD_BACKEND_AUTO);
+    for (int i = 0; i < 4; ++i) {
+        mpz_clear(coeff[i]);
+    }
+    mpz_clear(actual);
+    mpz_clear(expected);
+    mpz_clear(y);
+    mpz_clear(x);
+    field_deinit(&pd);
+}
+
+// a split and combine through the specialised degrees
+static void round_trip(int security) {
+    char secret[MAXDEGREE / 4 + 1];
+    char output[MAXDEGREE / 4 + 2];
+    static const char hex[] = "0123456789abcdef";
+    for (int i = 0; i < security / 4; ++i) {
+        secret[i] = hex[test_random() % 16];
+    }
+    secret[security / 4] = '\0';
+    secret[0] = '1';
+
+    share_store_t store = {0};
+    CHECK_OK(split(secret, store_share, &store, security, 4, 6, true, NULL, true, NULL));
+    store.first = 2;
+    CHECK_OK(combine(output, sizeof(output), read_stored_share, &store, 4, true, true));
+    CHECK(0 == strcmp(secret, output));
+}
+
+int main(void) {
+    static const unsigned int fixed[] = {128, 256, 512};
+    for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); ++i) {
+        CHECK(field_backend_available(FIELD_BACKEND_FIXED, fixed[i]));
+        check_backend(fixed[i], FIELD_BACKEND_FIXED, 50);
+        round_trip((int)fixed[i]);
+    }
+    CHECK(!field_backend_available(FIELD_BACKEND_FIXED, 136));
+
+    for (unsigned int degree = 8; degree <= 1024; degree += 8) {
+        check_backend(degree, FIELD_BACKEND_LIMBS, 4);
+    }
+
+    // Karatsuba with odd and even halves at several depths, to MAXDEGREE
+    static const unsigned int large[] = {1032, 1544, 2048, 3080, 4096, 6152, MAXDEGREE};
+    for (size_t i = 0; i < sizeof(large) / sizeof(large[0]); ++i) {
+        check_backend(large[i], FIELD_BACKEND_LIMBS, 2);
+    }
+    round_trip(2048);
+    round_trip(MAXDEGREE);
+    return test_result();
+}
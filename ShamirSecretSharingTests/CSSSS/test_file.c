@@ -0,0 +1,135 @@
+/*
+ *  file split and combine through memory mappings
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <unistd.h>
+
+#include "test.h"
+
+#define SECRET "test_file.secret"
+#define COMBINED "test_file.combined"
+#define THRESHOLD 3
+#define NUMBER 5
+
+static error_t share_path(void *data, char *path, size_t size, int number, int total) {
+    (void)total;
+    snprintf(path, size, "%s-%d", (const char *)data, number);
+    return ERROR_OK;
+}
+
+static error_t failing_path(void *data, char *path, size_t size, int number, int total) {
+    return 3 == number ? ERROR_CANNOT_WRITE_OUTPUT : share_path(data, path, size, number, total);
+}
+
+// the whole file, NULL if it cannot be read; *length is its size
+static uint8_t *read_file(const char *path, size_t *length) {
+    FILE *f = fopen(path, "rb");
+    if (NULL == f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *length = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*length + 1);
+    if (NULL != data && *length != fread(data, 1, *length, f)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+static void write_file(const char *path, const uint8_t *data, size_t length) {
+    FILE *f = fopen(path, "wb");
+    CHECK(NULL != f);
+    if (NULL != f) {
+        CHECK(length == fwrite(data, 1, length, f));
+        fclose(f);
+    }
+}
+
+static void remove_shares(const char *prefix) {
+    char path[64];
+    for (int number = 1; number <= NUMBER; ++number) {
+        snprintf(path, sizeof(path), "%s-%d", prefix, number);
+        remove(path);
+    }
+}
+
+static void round_trip(size_t length) {
+    uint8_t *secret = malloc(length + 1);
+    test_fill(secret, length);
+    write_file(SECRET, secret, length);
+
+    uint64_t seed = length;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    CHECK_OK(gf256_split_file(SECRET, share_path, "test_file.share", THRESHOLD, NUMBER, &cprng));
+
+    // the same bytes as gf256_split
+    uint8_t *expected[NUMBER];
+    for (int i = 0; i < NUMBER; ++i) {
+        expected[i] = malloc(gf256_share_size(length));
+    }
+    seed = length;
+    CHECK_OK(gf256_split(expected, secret, length, THRESHOLD, NUMBER, &cprng));
+    for (int i = 0; i < NUMBER; ++i) {
+        char path[64];
+        size_t size = 0;
+        snprintf(path, sizeof(path), "test_file.share-%d", i + 1);
+        uint8_t *share = read_file(path, &size);
+        CHECK(NULL != share && gf256_share_size(length) == size);
+        CHECK(NULL != share && 0 == memcmp(expected[i], share, size));
+        free(share);
+        free(expected[i]);
+    }
+
+    const char *paths[THRESHOLD] = {"test_file.share-5", "test_file.share-2", "test_file.share-4"};
+    CHECK_OK(gf256_combine_file(COMBINED, paths, THRESHOLD));
+    size_t size = 0;
+    uint8_t *combined = read_file(COMBINED, &size);
+    CHECK(NULL != combined && length == size);
+    CHECK(NULL != combined && 0 == memcmp(secret, combined, length));
+    free(combined);
+    free(secret);
+}
+
+int main(void) {
+    static const size_t lengths[] = {0, 1, 4097, 1000003};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+        round_trip(lengths[i]);
+    }
+
+    // a failure removes the share files already made
+    CHECK_ERROR(ERROR_CANNOT_WRITE_OUTPUT,
+                gf256_split_file(SECRET, failing_path, "test_file.failed", THRESHOLD, NUMBER, NULL));
+    CHECK(0 != access("test_file.failed-1", F_OK));
+    CHECK(0 != access("test_file.failed-2", F_OK));
+    CHECK_ERROR(ERROR_CANNOT_READ_INPUT,
+                gf256_split_file("test_file.missing", share_path, "test_file.missing", THRESHOLD, NUMBER, NULL));
+
+    // a short share, and the partial secret is removed
+    CHECK(0 == truncate("test_file.share-4", 100));
+    const char *paths[THRESHOLD] = {"test_file.share-5", "test_file.share-2", "test_file.share-4"};
+    remove(COMBINED);
+    CHECK_ERROR(ERROR_SHARE_HAS_ILLEGAL_LENGTH, gf256_combine_file(COMBINED, paths, THRESHOLD));
+    CHECK(0 != access(COMBINED, F_OK));
+
+    remove_shares("test_file.share");
+    remove(SECRET);
+    return test_result();
+}
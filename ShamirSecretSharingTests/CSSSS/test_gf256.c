@@ -0,0 +1,91 @@
+/*
+ *  byte-wise split and combine over GF(2^8)
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define MAX_SHARES 12
+
+static void round_trip(size_t length, int threshold, int number) {
+    uint8_t *secret = malloc(length + 1);
+    uint8_t *output = malloc(length + 1);
+    uint8_t *shares[MAX_SHARES];
+    CHECK(NULL != secret && NULL != output);
+    test_fill(secret, length);
+    if (length > 2) {
+        secret[0] = 0;                 // leading and embedded zero bytes
+        secret[length / 2] = 0;
+    }
+    for (int i = 0; i < number; ++i) {
+        shares[i] = malloc(gf256_share_size(length));
+        CHECK(NULL != shares[i]);
+    }
+
+    uint64_t seed = length + (uint64_t)threshold;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    CHECK_OK(gf256_split(shares, secret, length, threshold, number, &cprng));
+    for (int i = 0; i < number; ++i) {
+        CHECK(GF256_VERSION == shares[i][0]);
+        CHECK(threshold == shares[i][1]);
+        CHECK(i + 1 == shares[i][2]);
+    }
+
+    // the last threshold shares, in reverse order
+    const uint8_t *picked[MAX_SHARES];
+    for (int k = 0; k < threshold; ++k) {
+        picked[k] = shares[number - 1 - k];
+    }
+    CHECK_OK(gf256_combine(output, length, picked, threshold));
+    CHECK(0 == memcmp(secret, output, length));
+
+    if (threshold > 1) {
+        picked[0] = picked[1];
+        CHECK_ERROR(ERROR_INVALID_SHARE, gf256_combine(output, length, picked, threshold));
+        CHECK_ERROR(ERROR_SHARES_INCONSISTENT, gf256_combine(output, length, picked, threshold - 1));
+    }
+
+    for (int i = 0; i < number; ++i) {
+        free(shares[i]);
+    }
+    free(output);
+    free(secret);
+}
+
+int main(void) {
+    static const size_t lengths[] = {0, 1, 17, 4095, 4096, 4097, 100000};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+        CHECK(lengths[i] + GF256_HEADER_SIZE == gf256_share_size(lengths[i]));
+        round_trip(lengths[i], 1, 3);
+        round_trip(lengths[i], 4, 7);
+        round_trip(lengths[i], MAX_SHARES, MAX_SHARES);
+    }
+
+    uint8_t buffer[2][GF256_HEADER_SIZE + 4];
+    uint8_t *shares[2] = {buffer[0], buffer[1]};
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, gf256_split(shares, "abcd", 4, 0, 2, NULL));
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, gf256_split(shares, "abcd", 4, 3, 2, NULL));
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, gf256_split(shares, "abcd", 4, 2, GF256_MAX_SHARES + 1, NULL));
+    CHECK_ERROR(ERROR_INPUT_IS_NULL, gf256_split(NULL, "abcd", 4, 2, 2, NULL));
+
+    CHECK_OK(gf256_split(shares, "abcd", 4, 2, 2, NULL));
+    char output[4];
+    buffer[1][0] = GF256_VERSION + 1;
+    CHECK_ERROR(ERROR_INVALID_SYNTAX, gf256_combine(output, 4, (const uint8_t *const *)shares, 2));
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, gf256_combine(output, 4, (const uint8_t *const *)shares, 0));
+    return test_result();
+}
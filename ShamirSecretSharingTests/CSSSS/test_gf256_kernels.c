@@ -0,0 +1,80 @@
+/*
+ *  GF(2^8) region kernels against the scalar kernel
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define THRESHOLD 5
+#define NUMBER 9
+#define LENGTH 100003              // not a multiple of any vector width
+
+int main(void) {
+    uint8_t *secret = malloc(LENGTH);
+    uint8_t *output = malloc(LENGTH);
+    uint8_t *expected[NUMBER];
+    uint8_t *shares[NUMBER];
+    CHECK(NULL != secret && NULL != output);
+    test_fill(secret, LENGTH);
+    for (int i = 0; i < NUMBER; ++i) {
+        expected[i] = malloc(gf256_share_size(LENGTH));
+        shares[i] = malloc(gf256_share_size(LENGTH));
+    }
+
+    CHECK(gf256_kernel_available(GF256_KERNEL_SCALAR));
+    CHECK(gf256_set_kernel(GF256_KERNEL_SCALAR));
+    CHECK(GF256_KERNEL_SCALAR == gf256_kernel());
+    uint64_t seed = 42;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    CHECK_OK(gf256_split(expected, secret, LENGTH, THRESHOLD, NUMBER, &cprng));
+
+    for (int k = GF256_KERNEL_SCALAR; k < GF256_KERNEL_maximum; ++k) {
+        gf256_kernel_t kernel = (gf256_kernel_t)k;
+        CHECK(NULL != gf256_kernel_name(kernel));
+        if (!gf256_kernel_available(kernel)) {
+            CHECK(!gf256_set_kernel(kernel));
+            continue;
+        }
+        CHECK(gf256_set_kernel(kernel));
+        printf("%s\n", gf256_kernel_name(kernel));
+
+        // the same coefficients give the same shares with every kernel
+        seed = 42;
+        CHECK_OK(gf256_split(shares, secret, LENGTH, THRESHOLD, NUMBER, &cprng));
+        for (int i = 0; i < NUMBER; ++i) {
+            CHECK(0 == memcmp(expected[i], shares[i], gf256_share_size(LENGTH)));
+        }
+
+        // and combine any subset, including prefixes of odd lengths
+        const uint8_t *picked[THRESHOLD] = {shares[8], shares[2], shares[5], shares[0], shares[7]};
+        for (size_t length = LENGTH; length > LENGTH - 70; length -= 17) {
+            memset(output, 0, LENGTH);
+            CHECK_OK(gf256_combine(output, length, picked, THRESHOLD));
+            CHECK(0 == memcmp(secret, output, length));
+        }
+    }
+
+    CHECK(gf256_set_kernel(GF256_KERNEL_AUTO));
+    CHECK(GF256_KERNEL_AUTO != gf256_kernel());
+    for (int i = 0; i < NUMBER; ++i) {
+        free(shares[i]);
+        free(expected[i]);
+    }
+    free(output);
+    free(secret);
+    return test_result();
+}
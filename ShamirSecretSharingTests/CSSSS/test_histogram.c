@@ -0,0 +1,120 @@
+/*
+ *  latency histograms for split and combine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <pthread.h>
+
+#include "test.h"
+
+#define THREADS 3
+#define ROUNDS 50
+
+static void split_and_combine(int security, int threshold) {
+    uint64_t seed = 38;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    share_store_t store = {0};
+    char output[64];
+    CHECK_OK(split("timed", store_share, &store, security, threshold, threshold, false, NULL, false, &cprng));
+    CHECK_OK(combine(output, sizeof(output), read_stored_share, &store, threshold, false, false));
+    CHECK(0 == strcmp("timed", output));
+}
+
+static void *rounds(void *argument) {
+    (void)argument;
+    for (int i = 0; i < ROUNDS; ++i) {
+        split_and_combine(64, 9);
+    }
+    return NULL;
+}
+
+static const histogram_t *find(const histogram_snapshot_t *snapshot, histogram_op_t op, unsigned int degree, int threshold) {
+    for (size_t i = 0; i < snapshot->count; ++i) {
+        const histogram_t *h = &snapshot->histograms[i];
+        if (op == h->op && degree == h->degree && threshold == h->threshold) {
+            return h;
+        }
+    }
+    return NULL;
+}
+
+static error_t count_lines(void *data, const char *text, size_t length) {
+    (void)text;
+    (void)length;
+    ++*(int *)data;
+    return ERROR_OK;
+}
+
+int main(void) {
+    for (size_t b = 1; b < HISTOGRAM_BUCKETS; ++b) {
+        CHECK(histogram_bucket_limit(b) > histogram_bucket_limit(b - 1));
+    }
+
+    // off by default
+    histogram_snapshot_t snapshot;
+    split_and_combine(128, 3);
+    CHECK_OK(histogram_snapshot(&snapshot));
+    CHECK(0 == snapshot.count);
+    histogram_snapshot_free(&snapshot);
+
+    histogram_enable(true);
+    CHECK(histogram_enabled());
+    for (int i = 0; i < 100; ++i) {
+        split_and_combine(128, 3);
+    }
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; ++i) {
+        CHECK(0 == pthread_create(&threads[i], NULL, rounds, NULL));
+    }
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    static share_store_t stores[2];
+    split_job_t jobs[2] = {
+        {.secret = "batched", .process_share = store_share, .data = &stores[0], .threshold = 2, .number = 2},
+        {.secret = "batched", .process_share = store_share, .data = &stores[1], .threshold = 2, .number = 2},
+    };
+    CHECK_OK(split_batch(jobs, 2, NULL));
+    histogram_enable(false);
+
+    CHECK_OK(histogram_snapshot(&snapshot));
+    const histogram_t *h = find(&snapshot, HISTOGRAM_SPLIT, 128, 4);
+    CHECK(NULL != h && 100 == h->count);
+    h = find(&snapshot, HISTOGRAM_COMBINE, 128, 4);
+    CHECK(NULL != h && 100 == h->count);
+    if (NULL != h) {
+        CHECK(h->min <= histogram_percentile(h, 50));
+        CHECK(histogram_percentile(h, 50) <= histogram_percentile(h, 99.9));
+        CHECK(h->sum >= h->count * h->min);
+    }
+    // threads merged into one series
+    h = find(&snapshot, HISTOGRAM_SPLIT, 64, 16);
+    CHECK(NULL != h && THREADS * ROUNDS == h->count);
+    h = find(&snapshot, HISTOGRAM_SPLIT_BATCH, 0, 0);
+    CHECK(NULL != h && 1 == h->count);
+    for (size_t i = 1; i < snapshot.count; ++i) {
+        CHECK(snapshot.histograms[i - 1].op <= snapshot.histograms[i].op);
+    }
+    histogram_snapshot_free(&snapshot);
+
+    int lines = 0;
+    CHECK_OK(histogram_export(count_lines, &lines));
+    CHECK(lines > 10);
+    CHECK_OK(histogram_write_file("test_histogram.txt"));
+    remove("test_histogram.txt");
+    return test_result();
+}
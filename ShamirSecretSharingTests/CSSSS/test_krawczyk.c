@@ -0,0 +1,102 @@
+/*
+ *  Krawczyk computational secret sharing
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+#include "aead.h"
+
+#define MAX_SHARES 8
+#define OFFSET_LENGTH 3                // in the share header, see krawczyk.c
+#define OFFSET_KEY 23
+
+static void check(size_t length, int threshold, int number) {
+    uint8_t *secret = malloc(length + 1);
+    uint8_t *output = malloc(length + 1);
+    uint8_t *shares[MAX_SHARES];
+    test_fill(secret, length);
+    size_t size = krawczyk_share_size(length, threshold);
+    CHECK(size == KRAWCZYK_HEADER_SIZE + (length + AEAD_TAG_SIZE + threshold - 1) / threshold);
+    for (int i = 0; i < number; ++i) {
+        shares[i] = malloc(size);
+    }
+
+    uint64_t seed = length;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    CHECK_OK(krawczyk_split(shares, secret, length, threshold, number, &cprng));
+
+    const uint8_t *picked[MAX_SHARES];
+    for (int k = 0; k < threshold; ++k) {
+        picked[k] = shares[number - 1 - k];
+    }
+    uint8_t *last = shares[number - 1];
+    CHECK(length == krawczyk_secret_length(last));
+    CHECK_OK(krawczyk_combine(output, length, picked, threshold));
+    CHECK(0 == memcmp(secret, output, length));
+
+    // a flipped bit of the dispersed ciphertext
+    last[size - 1] ^= 1;
+    CHECK_ERROR(ERROR_AUTHENTICATION_FAILED, krawczyk_combine(output, length, picked, threshold));
+    last[size - 1] ^= 1;
+
+    // a flipped bit of the key share gives another key
+    if (threshold > 1) {
+        last[OFFSET_KEY + 7] ^= 0x10;
+        CHECK_ERROR(ERROR_AUTHENTICATION_FAILED, krawczyk_combine(output, length, picked, threshold));
+        last[OFFSET_KEY + 7] ^= 0x10;
+    }
+
+    // a length that does not match the share size
+    last[OFFSET_LENGTH + 7] ^= 1;
+    CHECK_ERROR(ERROR_SHARE_HAS_ILLEGAL_LENGTH, krawczyk_combine(output, length, picked, threshold));
+    last[OFFSET_LENGTH + 7] ^= 1;
+
+    // fewer or more shares than the threshold they were made for
+    if (threshold > 1) {
+        CHECK_ERROR(ERROR_SHARES_INCONSISTENT, krawczyk_combine(output, length, picked, threshold - 1));
+    }
+    if (threshold < number) {
+        picked[threshold] = shares[0];
+        CHECK_ERROR(ERROR_SHARES_INCONSISTENT, krawczyk_combine(output, length, picked, threshold + 1));
+    }
+
+    // the untampered shares still combine
+    CHECK_OK(krawczyk_combine(output, length, picked, threshold));
+    CHECK(0 == memcmp(secret, output, length));
+
+    for (int i = 0; i < number; ++i) {
+        free(shares[i]);
+    }
+    free(output);
+    free(secret);
+}
+
+int main(void) {
+    static const size_t lengths[] = {0, 1, 15, 16, 17, 1000, 65537};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+        for (int threshold = 1; threshold <= 5; threshold += 2) {
+            check(lengths[i], threshold, threshold + 2);
+        }
+    }
+
+    uint8_t buffer[KRAWCZYK_HEADER_SIZE + AEAD_TAG_SIZE + 4];
+    uint8_t *shares[1] = {buffer};
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, krawczyk_split(shares, "abcd", 4, 2, 1, NULL));
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, krawczyk_split(shares, "abcd", 4, 0, 1, NULL));
+    CHECK(0 == krawczyk_share_size(4, 0));
+    return test_result();
+}
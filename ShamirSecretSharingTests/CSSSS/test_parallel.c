@@ -0,0 +1,112 @@
+/*
+ *  split_parallel against split, combine_parallel against combine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define SHARES 500
+
+typedef struct {
+    char line[SHARES][MAXLINELEN];
+    int order[SHARES];             // share numbers in delivery order
+    int delivered;
+} many_shares_t;
+
+static many_shares_t serial, parallel;
+
+static error_t keep_share(void *data, const char *buffer, size_t length, int number, int total) {
+    many_shares_t *shares = (many_shares_t *)data;
+    (void)total;
+    if (number < 1 || number > SHARES || length >= MAXLINELEN) {
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+    memcpy(shares->line[number - 1], buffer, length);
+    shares->line[number - 1][length] = '\0';
+    int i = __atomic_fetch_add(&shares->delivered, 1, __ATOMIC_RELAXED);
+    shares->order[i] = number;
+    return ERROR_OK;
+}
+
+// the same shares as split from the same random bytes
+static void check_split(worker_pool_t *pool, bool ordered, int threshold) {
+    const char *secret = "a secret split across many holders";
+    uint64_t seed = 42 + threshold;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    memset(&serial, 0, sizeof(serial));
+    memset(&parallel, 0, sizeof(parallel));
+    CHECK_OK(split(secret, keep_share, &serial, 0, threshold, SHARES, false, "p", false, &cprng));
+    CHECK_OK(split_parallel(secret, keep_share, &parallel, 0, threshold, SHARES, false, "p", false, &cprng, pool, ordered));
+    CHECK(SHARES == parallel.delivered);
+    for (int i = 0; i < SHARES; ++i) {
+        CHECK(0 == strcmp(serial.line[i], parallel.line[i]));
+        if (ordered) {
+            CHECK(i + 1 == parallel.order[i]);
+        }
+    }
+
+    // any threshold of them combine
+    const char *use[threshold];
+    for (int i = 0; i < threshold; ++i) {
+        use[i] = parallel.line[(i * 37) % SHARES];
+    }
+    char result[100];
+    CHECK_OK(wrapped_combine(result, sizeof(result), use, threshold, false, false));
+    CHECK(0 == strcmp(result, secret));
+}
+
+// every third share, so the combine does not see 1..threshold
+static const char *read_every_third(void *data, int number, int threshold, size_t size) {
+    (void)threshold;
+    (void)size;
+    return ((many_shares_t *)data)->line[(3 * (number - 1)) % SHARES];
+}
+
+static void check_combine(worker_pool_t *pool, int threshold, bool diffusion) {
+    const char *secret = "0123456789abcdef0123456789abcdef";
+    memset(&parallel, 0, sizeof(parallel));
+    CHECK_OK(split_parallel(secret, keep_share, &parallel, 0, threshold, SHARES, diffusion, NULL, true, NULL, pool, false));
+    
+    char expected[100], result[100];
+    CHECK_OK(combine(expected, sizeof(expected), read_every_third, &parallel, threshold, diffusion, true));
+    CHECK(0 == strcmp(expected, secret));
+    int cutoffs[] = { 0, 2, -1 };  // default, always on the workers, never
+    for (int i = 0; i < 3; ++i) {
+        memset(result, 0, sizeof(result));
+        CHECK_OK(combine_parallel(result, sizeof(result), read_every_third, &parallel, threshold, diffusion, true, pool, cutoffs[i]));
+        CHECK(0 == strcmp(result, secret));
+    }
+    memset(result, 0, sizeof(result));
+    CHECK_OK(combine_parallel(result, sizeof(result), read_every_third, &parallel, threshold, diffusion, true, NULL, 0));
+    CHECK(0 == strcmp(result, secret));
+}
+
+int main(void) {
+    pool_config_t config = { .workers = 4 };
+    worker_pool_t *pool = worker_pool_create(&config);
+    CHECK(NULL != pool);
+    for (int threshold = 2; threshold <= 12; threshold += 5) {
+        check_split(pool, true, threshold);
+        check_split(pool, false, threshold);
+    }
+    check_combine(pool, 3, false);
+    check_combine(pool, 40, true);
+    check_combine(pool, 100, false);
+    CHECK_ERROR(ERROR_INPUT_IS_NULL, split_parallel("x", keep_share, &parallel, 0, 2, 3, false, NULL, false, NULL, NULL, true));
+    worker_pool_destroy(pool);
+    return test_result();
+}
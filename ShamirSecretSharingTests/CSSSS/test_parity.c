@@ -0,0 +1,96 @@
+/*
+ *  the fixed-limb backend (SSSS_NO_GMP) against results made with GMP
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+// the shares of each split are drawn from a fixed seed, so both backends
+// must print the same lines; golden is the FNV-1a hash of all the lines
+// as printed by a GMP build (run with an argument to print them again)
+
+typedef struct {
+    int security;
+    int threshold;
+    bool diffusion;
+    bool hexmode;
+    uint64_t golden;
+} parity_case_t;
+
+static const parity_case_t cases[] = {
+    {8,    2,  false, false, 0x3be5913e507f1beaULL},
+    {64,   3,  true,  false, 0x7ab14eb3eb2caa17ULL},
+    {128,  5,  true,  true,  0x5374c555669b9cb1ULL},
+    {136,  4,  false, true,  0x1a936839911c5fe3ULL},
+    {256,  8,  true,  true,  0xdfe58598db978989ULL},
+    {512,  2,  true,  true,  0xe13f2f38c65560ebULL},
+    {520,  9,  true,  false, 0xd968c578267bf77cULL},
+    {1024, 16, true,  true,  0xb0edc133719f1af5ULL},
+    {4096, 3,  true,  true,  0x55f53244e4855c3eULL},
+    {8192, 2,  true,  true,  0x8f28af5adb40ab35ULL},
+};
+
+static uint64_t fnv1a(uint64_t hash, const char *s) {
+    for (; *s; ++s) {
+        hash ^= (uint8_t)*s;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t check_case(const parity_case_t *c) {
+    static char secret[MAXDEGREE / 4 + 1];
+    static char output[MAXDEGREE / 4 + 2];
+    static const char hex[] = "0123456789abcdef";
+    size_t length = c->hexmode ? (size_t)c->security / 4 : (size_t)c->security / 8;
+    for (size_t i = 0; i < length; ++i) {
+        secret[i] = c->hexmode ? hex[(i * 7 + 3) % 16] : (char)('a' + (i * 5) % 26);
+    }
+    secret[length] = '\0';
+
+    uint64_t seed = (uint64_t)c->security * 1000 + (uint64_t)c->threshold;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    static share_store_t store;
+    memset(&store, 0, sizeof(store));
+    CHECK_OK(split(secret, store_share, &store, c->security, c->threshold, c->threshold,
+                   c->diffusion, "parity", c->hexmode, &cprng));
+    CHECK_OK(combine(output, sizeof(output), read_stored_share, &store, c->threshold, c->diffusion, c->hexmode));
+    CHECK(0 == strcmp(secret, output));
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < c->threshold; ++i) {
+        hash = fnv1a(hash, store.line[i]);
+    }
+    return hash;
+}
+
+int main(int argc, char **argv) {
+    (void)argv;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        uint64_t hash = check_case(&cases[i]);
+        if (argc > 1) {
+            printf("    {%d, %d, %s, %s, 0x%016llxULL},\n", cases[i].security, cases[i].threshold,
+                   cases[i].diffusion ? "true" : "false", cases[i].hexmode ? "true" : "false",
+                   (unsigned long long)hash);
+        } else if (hash != cases[i].golden) {
+            fprintf(stderr, "security %d threshold %d: shares differ from the GMP build\n",
+                    cases[i].security, cases[i].threshold);
+            ++test_failures;
+        }
+    }
+    return test_result();
+}
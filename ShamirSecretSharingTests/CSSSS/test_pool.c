@@ -0,0 +1,130 @@
+/*
+ *  worker pool, split_batch and combine_batch round trips
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <unistd.h>
+
+#include "test.h"
+#include "pool.h"
+
+#define JOBS 200
+
+static split_job_t split_jobs[JOBS];
+static combine_job_t combine_jobs[JOBS];
+static share_store_t stores[JOBS];
+static char secrets[JOBS][80];
+static char results[JOBS][300];
+
+// split and combine every job on pool, combining from the last threshold shares
+static void round_trip(worker_pool_t *pool) {
+    for (int i = 0; i < JOBS; ++i) {
+        int threshold = 2 + i % 9;
+        snprintf(secrets[i], sizeof(secrets[i]), "secret number %d%s", i, i % 3 ? "" : " padded out to a longer secret");
+        stores[i].first = 3;
+        split_jobs[i] = (split_job_t){
+            .secret = secrets[i],
+            .process_share = store_share,
+            .data = &stores[i],
+            .threshold = threshold,
+            .number = threshold + 3,
+        };
+        combine_jobs[i] = (combine_job_t){
+            .secret = results[i],
+            .secret_size = sizeof(results[i]),
+            .get_share = read_stored_share,
+            .data = &stores[i],
+            .threshold = threshold,
+        };
+    }
+    CHECK_OK(split_batch(split_jobs, JOBS, pool));
+    CHECK_OK(combine_batch(combine_jobs, JOBS, pool));
+    for (int i = 0; i < JOBS; ++i) {
+        CHECK(ERROR_OK == split_jobs[i].error);
+        CHECK(ERROR_OK == combine_jobs[i].error);
+        CHECK(0 == strcmp(results[i], secrets[i]));
+    }
+}
+
+static size_t items_run[1000];
+
+static void count_item(void *context, size_t index, int worker) {
+    (void)context;
+    (void)worker;
+    __atomic_add_fetch(&items_run[index], 1, __ATOMIC_RELAXED);
+}
+
+static int released = 0;
+
+// a submitted item holding its worker until released
+static void hold_worker(void *context, size_t index, int worker) {
+    (void)context;
+    (void)index;
+    (void)worker;
+    while (!__atomic_load_n(&released, __ATOMIC_ACQUIRE)) {
+        usleep(1000);
+    }
+}
+
+// runs finish on the free workers while one is held by a submitted item
+static void run_beside_task(worker_pool_t *pool) {
+    CHECK(worker_pool_submit(pool, hold_worker, NULL, 0));
+    for (int run = 0; run < 3; ++run) {
+        memset(items_run, 0, sizeof(items_run));
+        worker_pool_run(pool, 1000, count_item, NULL, NULL);
+        for (int i = 0; i < 1000; ++i) {
+            CHECK(1 == items_run[i]);
+        }
+    }
+    __atomic_store_n(&released, 1, __ATOMIC_RELEASE);
+
+    // and the released worker does not rejoin a finished run
+    for (int run = 0; run < 20; ++run) {
+        memset(items_run, 0, sizeof(items_run));
+        worker_pool_run(pool, 1000, count_item, NULL, NULL);
+        for (int i = 0; i < 1000; ++i) {
+            CHECK(1 == items_run[i]);
+        }
+    }
+}
+
+int main(void) {
+    // every item runs exactly once
+    pool_config_t config = { .workers = 4 };
+    worker_pool_t *pool = worker_pool_create(&config);
+    CHECK(NULL != pool);
+    worker_pool_run(pool, 1000, count_item, NULL, NULL);
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(1 == items_run[i]);
+    }
+
+    run_beside_task(pool);
+
+    round_trip(pool);
+    round_trip(NULL);              // in the calling thread
+
+    // a failing job reports its error and does not stop the others
+    split_jobs[5].security = 8;     // too small for the secret
+    CHECK_ERROR(ERROR_INPUT_STRING_TOO_LONG, split_batch(split_jobs, JOBS, pool));
+    CHECK(ERROR_INPUT_STRING_TOO_LONG == split_jobs[5].error);
+    CHECK(ERROR_OK == split_jobs[6].error);
+
+    CHECK_ERROR(ERROR_INPUT_IS_NULL, split_batch(NULL, 1, pool));
+    CHECK_ERROR(ERROR_INPUT_IS_NULL, combine_batch(NULL, 1, pool));
+    worker_pool_destroy(pool);
+    return test_result();
+}
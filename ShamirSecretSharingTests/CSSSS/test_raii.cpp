@@ -0,0 +1,161 @@
+/*
+ *  C++20 wrappers for split and combine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include <errno.h>                 // glibc's error_t must not clash with the library's
+
+#include "shamir.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                         \
+        }                                                                       \
+    } while (0)
+
+static void text_round_trip() {
+    std::string secret = "a text secret";
+    ssss::SplitResult split = ssss::split(secret, 3, 5);
+    CHECK(ssss::ERROR_OK == split.error);
+    CHECK(5 == split.shares.size());
+
+    ssss::CombineResult combined = ssss::combine(split.shares, 3);
+    CHECK(ssss::ERROR_OK == combined.error);
+    CHECK(combined.secret.view() == secret);
+
+    // any threshold shares read back as Share objects
+    std::vector<ssss::Share> held;
+    for (int i = 4; i >= 2; --i) {
+        held.emplace_back(split.shares[i]);
+        CHECK(i + 1 == held.back().number());
+    }
+    combined = ssss::combine(std::span<const ssss::Share>(held), 3);
+    CHECK(ssss::ERROR_OK == combined.error);
+    CHECK(combined.secret.view() == secret);
+
+    // or viewed where they are, without a copy
+    std::vector<std::string> lines = {std::string(split.shares[1]), std::string(split.shares[3])};
+    std::array<ssss::ShareView, 3> views = {ssss::ShareView(lines[0].c_str()), held[0], split.shares.line(0)};
+    combined = ssss::combine(std::span<const ssss::ShareView>(views), 3);
+    CHECK(ssss::ERROR_OK == combined.error);
+    CHECK(combined.secret.view() == secret);
+}
+
+// slots sized from the degree still hold full shares at MAXDEGREE, with a
+// security above the secret's size and with a prefix
+static void share_sizes() {
+    std::string hex(MAXDEGREE / 4, 'e');
+    ssss::SplitOptions options;
+    options.hexmode = true;
+    options.prefix = "holder";
+    ssss::SplitResult split = ssss::split(hex, 2, 3, options);
+    CHECK(ssss::ERROR_OK == split.error);
+    CHECK(std::string_view("holder-1-") == split.shares[0].substr(0, 9));
+    ssss::CombineOptions hexmode;
+    hexmode.hexmode = true;
+    CHECK(ssss::combine(split.shares, 2, hexmode).secret.view() == hex);
+
+    options.security = 1024;
+    options.hexmode = false;
+    split = ssss::split("ee", 2, 3, options);
+    CHECK(ssss::ERROR_OK == split.error);
+    CHECK(ssss::combine(split.shares, 2).secret.view() == "ee");
+
+    ssss::ShareSet small(2, 8);
+    std::string line(SHARE_LINELEN(8), 'x');
+    CHECK(ssss::ERROR_BUFFER_TOO_SMALL == ssss::ShareSet::collect(&small, line.data(), line.size(), 1, 2));
+    CHECK(ssss::ERROR_OK == ssss::ShareSet::collect(&small, line.data(), line.size() - 1, 2, 2));
+}
+
+// embedded and leading zero bytes survive a binary round trip
+static void binary_round_trip() {
+    std::array<std::byte, 32> key;
+    for (size_t i = 0; i < key.size(); ++i) {
+        key[i] = static_cast<std::byte>(i % 5 ? 37 * i : 0);
+    }
+    ssss::SplitResult split = ssss::split(std::span<const std::byte>(key), 2, 4);
+    CHECK(ssss::ERROR_OK == split.error);
+
+    ssss::CombineResult combined = ssss::combine_binary(split.shares, 2);
+    CHECK(ssss::ERROR_OK == combined.error);
+    CHECK(combined.secret.bytes().size() == key.size());
+    CHECK(std::equal(key.begin(), key.end(), combined.secret.bytes().begin(), combined.secret.bytes().end()));
+
+    std::vector<ssss::Share> held;
+    held.emplace_back(split.shares[3]);
+    held.emplace_back(split.shares[1]);
+    combined = ssss::combine_binary(std::span<const ssss::Share>(held), 2);
+    CHECK(ssss::ERROR_OK == combined.error);
+    CHECK(std::equal(key.begin(), key.end(), combined.secret.bytes().begin(), combined.secret.bytes().end()));
+}
+
+static void invalid_threshold() {
+    ssss::SplitResult split = ssss::split("secret", 2, 3);
+    CHECK(ssss::ERROR_OK == split.error);
+    std::vector<ssss::Share> held;
+    held.emplace_back(split.shares[0]);
+    held.emplace_back(split.shares[1]);
+
+    for (int threshold : {0, -1, 4}) {
+        CHECK(ssss::ERROR_INVALID_THRESHOLD == ssss::combine(split.shares, threshold).error);
+        CHECK(ssss::ERROR_INVALID_THRESHOLD == ssss::combine_binary(split.shares, threshold).error);
+    }
+    for (int threshold : {0, -1, 3}) {
+        CHECK(ssss::ERROR_INVALID_THRESHOLD == ssss::combine(std::span<const ssss::Share>(held), threshold).error);
+        CHECK(ssss::ERROR_INVALID_THRESHOLD == ssss::combine_binary(std::span<const ssss::Share>(held), threshold).error);
+    }
+    CHECK(ssss::combine(split.shares, 0).secret.view().empty());
+}
+
+static void move_semantics() {
+    ssss::SplitResult split = ssss::split("moved secret", 2, 3);
+    CHECK(ssss::ERROR_OK == split.error);
+    std::string first(split.shares[0]);
+
+    ssss::ShareSet shares = std::move(split.shares);
+    CHECK(split.shares.empty());
+    CHECK(3 == shares.size());
+    CHECK(shares[0] == first);
+
+    ssss::CombineResult combined = ssss::combine(shares, 2);
+    ssss::Secret secret = std::move(combined.secret);
+    CHECK(secret.view() == "moved secret");
+    CHECK(combined.secret.view().empty());
+}
+
+int main() {
+    text_round_trip();
+    binary_round_trip();
+    share_sizes();
+    invalid_threshold();
+    move_semantics();
+
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+/*
+ *  batched share file writes with more files open than buffers
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define FILES 100
+#define LENGTH 3001
+
+static uint8_t expected_byte(int file, size_t offset) {
+    return (uint8_t)(file * 131 + offset * 7 + (offset >> 8));
+}
+
+static void path_of(char *path, size_t size, int file) {
+    snprintf(path, size, "test_share_io.%d", file);
+}
+
+// read file back through a fresh share_io_t and compare
+static void check_file(const share_io_config_t *config, int file) {
+    share_io_t *io = share_io_create(config);
+    CHECK(NULL != io);
+    if (NULL == io) {
+        return;
+    }
+    char path[64];
+    path_of(path, sizeof(path), file);
+    int handle = share_io_open(io, path, false);
+    CHECK(handle >= 0);
+    size_t offset = 0;
+    bool same = true;
+    uint8_t buffer[700];
+    for (ssize_t n; handle >= 0 && (n = share_io_read(io, handle, buffer, sizeof(buffer))) > 0;) {
+        for (ssize_t i = 0; i < n; ++i) {
+            same = same && expected_byte(file, offset + (size_t)i) == buffer[i];
+        }
+        offset += (size_t)n;
+    }
+    CHECK(same && LENGTH == offset);
+    if (handle >= 0) {
+        CHECK_OK(share_io_close(io, handle));
+    }
+    CHECK_OK(share_io_destroy(io));
+}
+
+// FILES files written in interleaved chunks of uneven size
+static void interleaved(const share_io_config_t *config) {
+    share_io_t *io = share_io_create(config);
+    CHECK(NULL != io);
+    if (NULL == io) {
+        return;
+    }
+    int handles[FILES];
+    size_t written[FILES] = {0};
+    for (int file = 0; file < FILES; ++file) {
+        char path[64];
+        path_of(path, sizeof(path), file);
+        handles[file] = share_io_open(io, path, true);
+        CHECK(handles[file] >= 0);
+    }
+    for (bool more = true; more;) {
+        more = false;
+        for (int file = 0; file < FILES; ++file) {
+            size_t n = 1 + test_random() % 97;
+            if (n > LENGTH - written[file]) {
+                n = LENGTH - written[file];
+            }
+            uint8_t chunk[97];
+            for (size_t i = 0; i < n; ++i) {
+                chunk[i] = expected_byte(file, written[file] + i);
+            }
+            if (handles[file] >= 0 && 0 != n) {
+                CHECK_OK(share_io_append(io, handles[file], chunk, n));
+            }
+            written[file] += n;
+            more = more || LENGTH != written[file];
+        }
+    }
+    // half closed one by one, the rest by destroy
+    for (int file = 0; file < FILES; file += 2) {
+        if (handles[file] >= 0) {
+            CHECK_OK(share_io_close(io, handles[file]));
+        }
+    }
+    CHECK_OK(share_io_destroy(io));
+
+    for (int file = 0; file < FILES; ++file) {
+        check_file(config, file);
+    }
+}
+
+int main(void) {
+    static const share_io_backend_t backends[] = {SHARE_IO_BACKEND_PWRITE, SHARE_IO_BACKEND_AUTO};
+    static const unsigned int depths[] = {0, 4, 1};
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); ++b) {
+        for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); ++d) {
+            share_io_config_t config = {.backend = backends[b], .depth = depths[d], .buffer_size = 256};
+            interleaved(&config);
+        }
+    }
+
+    for (int file = 0; file < FILES; ++file) {
+        char path[64];
+        path_of(path, sizeof(path), file);
+        remove(path);
+    }
+    return test_result();
+}
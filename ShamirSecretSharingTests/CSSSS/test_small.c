@@ -0,0 +1,89 @@
+/*
+ *  thresholds 2 to 8: the unrolled split and the Lagrange restore
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+#include "field.h"
+
+#define SHARES 10
+
+// shares picked in any order
+static const char *read_picked(void *data, int number, int threshold, size_t size) {
+    (void)threshold;
+    (void)size;
+    return ((const char **)data)[number - 1];
+}
+
+static void pick(const char **picked, share_store_t *store, int threshold) {
+    int order[SHARES];
+    for (int i = 0; i < SHARES; ++i) {
+        order[i] = i;
+    }
+    for (int i = SHARES - 1; i > 0; --i) {
+        int j = (int)(test_random() % (uint32_t)(i + 1));
+        int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (int i = 0; i < threshold; ++i) {
+        picked[i] = store->line[order[i]];
+    }
+}
+
+static void check_threshold(const char *secret, int security, int threshold, bool diffusion) {
+    uint64_t seed = (uint64_t)(security + threshold);
+    cprng_t cprng = TEST_CPRNG(&seed);
+    share_store_t store = {0};
+    CHECK_OK(split(secret, store_share, &store, security, threshold, SHARES, diffusion, NULL, false, &cprng));
+
+    unsigned int degree = security ? (unsigned int)security : 8 * (unsigned int)strlen(secret);
+    for (int round = 0; round < 10; ++round) {
+        const char *picked[SHARES];
+        char lagrange[MAXDEGREE / 8 + 1];
+        char gauss[MAXDEGREE / 8 + 1];
+        pick(picked, &store, threshold);
+
+        field_choice[degree / 8].restore = RESTORE_LAGRANGE;
+        CHECK_OK(combine(lagrange, sizeof(lagrange), read_picked, picked, threshold, diffusion, false));
+        field_choice[degree / 8].restore = RESTORE_GAUSS;
+        CHECK_OK(combine(gauss, sizeof(gauss), read_picked, picked, threshold, diffusion, false));
+        field_choice[degree / 8].restore = RESTORE_AUTO;
+        CHECK(0 == strcmp(secret, lagrange));
+        CHECK(0 == strcmp(secret, gauss));
+
+        // a repeated share is caught rather than combined into garbage
+        if (threshold > 1) {
+            picked[1] = picked[0];
+            CHECK_ERROR(ERROR_SHARES_INCONSISTENT,
+                        combine(lagrange, sizeof(lagrange), read_picked, picked, threshold, diffusion, false));
+        }
+    }
+}
+
+int main(void) {
+    static const int security[] = {0, 128, 136, 256, 512, 1024};
+    for (size_t i = 0; i < sizeof(security) / sizeof(security[0]); ++i) {
+        for (int threshold = 1; threshold <= SHARES; ++threshold) {
+            check_threshold("small threshold", security[i], threshold, false);
+            if (security[i] >= 64) {
+                check_threshold("small threshold", security[i], threshold, true);
+            }
+        }
+    }
+    return test_result();
+}
@@ -0,0 +1,89 @@
+/*
+ *  per phase timings and operation counters
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define JOBS 40
+
+static void split_and_combine(int number) {
+    uint64_t seed = 36;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    share_store_t store = {0};
+    char output[64];
+    CHECK_OK(split("counted secret", store_share, &store, 256, 3, number, true, NULL, false, &cprng));
+    CHECK_OK(combine(output, sizeof(output), read_stored_share, &store, 3, true, false));
+    CHECK(0 == strcmp("counted secret", output));
+}
+
+int main(void) {
+    stats_t before;
+    stats_t after;
+
+    // off by default: nothing is recorded
+    CHECK(!stats_enabled());
+    stats_read(&before);
+    split_and_combine(5);
+    stats_read(&after);
+    CHECK(after.splits == before.splits);
+    CHECK(after.field_mults == before.field_mults);
+
+    stats_enable(true);
+    CHECK(stats_enabled());
+    stats_read(&before);
+    split_and_combine(5);
+    stats_read(&after);
+    CHECK(1 == after.splits - before.splits);
+    CHECK(1 == after.combines - before.combines);
+    CHECK(3 - 1 == after.calls[STATS_CPRNG] - before.calls[STATS_CPRNG]);  // one per random coefficient
+    CHECK(5 == after.calls[STATS_EVALUATE] - before.calls[STATS_EVALUATE]);
+    CHECK(5 + 3 == after.calls[STATS_CALLBACK] - before.calls[STATS_CALLBACK]);
+    CHECK(after.field_mults > before.field_mults);
+    for (int i = 0; i < STATS_maximum; ++i) {
+        CHECK(NULL != stats_phase_name((stats_phase_t)i));
+        CHECK(after.nanoseconds[i] >= before.nanoseconds[i]);
+    }
+
+    // work on pool threads is in the totals but not in this thread's counters
+    worker_pool_t *pool = worker_pool_create(&(pool_config_t){.workers = 3});
+    CHECK(NULL != pool);
+    static split_job_t jobs[JOBS];
+    static share_store_t stores[JOBS];
+    for (int i = 0; i < JOBS; ++i) {
+        jobs[i] = (split_job_t){.secret = "pooled", .process_share = store_share, .data = &stores[i],
+                                .threshold = 2, .number = 3};
+    }
+    stats_t thread_before;
+    stats_t thread_after;
+    stats_read(&before);
+    stats_read_thread(&thread_before);
+    CHECK_OK(split_batch(jobs, JOBS, pool));
+    worker_pool_destroy(pool);
+    stats_read(&after);
+    stats_read_thread(&thread_after);
+    CHECK(JOBS == after.splits - before.splits);
+    CHECK(JOBS * 3 == after.calls[STATS_EVALUATE] - before.calls[STATS_EVALUATE]);
+    CHECK(thread_after.splits - thread_before.splits < JOBS);
+
+    stats_enable(false);
+    stats_read(&before);
+    split_and_combine(4);
+    stats_read(&after);
+    CHECK(after.splits == before.splits);
+    return test_result();
+}
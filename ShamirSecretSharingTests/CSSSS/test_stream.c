@@ -0,0 +1,143 @@
+/*
+ *  streaming byte-wise split and combine
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define THRESHOLD 4
+#define NUMBER 7
+
+// share streams and the combined secret kept in memory
+typedef struct {
+    uint8_t *share[NUMBER];
+    size_t length[NUMBER];
+    size_t position[NUMBER];
+    int picked[THRESHOLD];         // share stream read for each input index
+    size_t read_limit;             // short reads, as from a pipe
+    uint8_t *secret;
+    size_t secret_length;
+} streams_t;
+
+static error_t output(void *data, const uint8_t *buffer, size_t length, int number, int total) {
+    streams_t *s = (streams_t *)data;
+    (void)total;
+    if (0 == number) {
+        memcpy(s->secret + s->secret_length, buffer, length);
+        s->secret_length += length;
+    } else {
+        memcpy(s->share[number - 1] + s->length[number - 1], buffer, length);
+        s->length[number - 1] += length;
+    }
+    return ERROR_OK;
+}
+
+static ssize_t input(void *data, int index, void *buffer, size_t size) {
+    streams_t *s = (streams_t *)data;
+    int i = s->picked[index];
+    size_t n = s->length[i] - s->position[i];
+    n = n < size ? n : size;
+    n = n < s->read_limit ? n : s->read_limit;
+    memcpy(buffer, s->share[i] + s->position[i], n);
+    s->position[i] += n;
+    return (ssize_t)n;
+}
+
+static error_t failing_output(void *data, const uint8_t *buffer, size_t length, int number, int total) {
+    (void)data;
+    (void)buffer;
+    (void)length;
+    (void)total;
+    return number > 1 ? ERROR_CANNOT_WRITE_OUTPUT : ERROR_OK;
+}
+
+static void round_trip(size_t length) {
+    static streams_t s;
+    memset(&s, 0, sizeof(s));
+    uint8_t *secret = malloc(length + 1);
+    uint8_t *expected[NUMBER];
+    test_fill(secret, length);
+    for (int i = 0; i < NUMBER; ++i) {
+        s.share[i] = malloc(gf256_share_size(length));
+        expected[i] = malloc(gf256_share_size(length));
+    }
+
+    // chunks of growing, uneven sizes
+    uint64_t seed = length;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    gf256_split_stream_t *stream = NULL;
+    CHECK_OK(gf256_split_begin(&stream, THRESHOLD, NUMBER, &cprng, output, &s));
+    for (size_t offset = 0, step = 1; offset < length; step = 3 * step + 1) {
+        size_t n = length - offset < step ? length - offset : step;
+        CHECK_OK(gf256_split_update(stream, secret + offset, n));
+        offset += n;
+    }
+    CHECK_OK(gf256_split_end(stream));
+
+    // the same bytes as gf256_split
+    seed = length;
+    CHECK_OK(gf256_split(expected, secret, length, THRESHOLD, NUMBER, &cprng));
+    for (int i = 0; i < NUMBER; ++i) {
+        CHECK(gf256_share_size(length) == s.length[i]);
+        CHECK(0 == memcmp(expected[i], s.share[i], s.length[i]));
+    }
+
+    s.picked[0] = 6;
+    s.picked[1] = 1;
+    s.picked[2] = 3;
+    s.picked[3] = 4;
+    s.read_limit = 777;
+    s.secret = malloc(length + 1);
+    CHECK_OK(gf256_combine_stream(THRESHOLD, input, output, &s));
+    CHECK(length == s.secret_length);
+    CHECK(0 == memcmp(secret, s.secret, length));
+
+    // one stream cut short
+    if (length > 0) {
+        memset(s.position, 0, sizeof(s.position));
+        s.secret_length = 0;
+        s.length[3] -= 1;
+        CHECK_ERROR(ERROR_SHARE_HAS_ILLEGAL_LENGTH, gf256_combine_stream(THRESHOLD, input, output, &s));
+    }
+
+    free(s.secret);
+    for (int i = 0; i < NUMBER; ++i) {
+        free(expected[i]);
+        free(s.share[i]);
+    }
+    free(secret);
+}
+
+int main(void) {
+    static const size_t lengths[] = {0, 1, 4095, 4096, 4097, 12288, 50001};
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+        round_trip(lengths[i]);
+    }
+
+    // a failure is sticky and end still frees the stream
+    gf256_split_stream_t *stream = NULL;
+    error_t err = gf256_split_begin(&stream, 2, 3, NULL, failing_output, NULL);
+    CHECK(ERROR_CANNOT_WRITE_OUTPUT == err);
+    CHECK(NULL != stream);
+    if (NULL != stream) {
+        CHECK_ERROR(ERROR_CANNOT_WRITE_OUTPUT, gf256_split_update(stream, "abc", 3));
+        CHECK_ERROR(ERROR_CANNOT_WRITE_OUTPUT, gf256_split_end(stream));
+    }
+    stream = NULL;
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, gf256_split_begin(&stream, 3, 2, NULL, output, NULL));
+    return test_result();
+}
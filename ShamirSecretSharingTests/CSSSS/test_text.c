@@ -0,0 +1,53 @@
+/*
+ *  hex and ASCII secrets with the internal random source
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+static void round_trip(const char *secret, int security, bool diffusion, bool hexmode) {
+    share_store_t store = {0};
+    char output[MAXDEGREE / 4 + 2];
+    CHECK_OK(split(secret, store_share, &store, security, 3, 5, diffusion, "text", hexmode, NULL));
+    store.first = 1;
+    CHECK_OK(combine(output, sizeof(output), read_stored_share, &store, 3, diffusion, hexmode));
+    CHECK(0 == strcmp(secret, output));
+}
+
+int main(void) {
+    round_trip("an ASCII secret", 0, false, false);
+    round_trip("an ASCII secret", 256, true, false);
+    round_trip("0123456789abcdef", 0, false, true);
+    round_trip("0123456789abcdef0123456789abcdef", 128, true, true);
+
+    // two splits with the internal random source differ
+    share_store_t first = {0};
+    share_store_t second = {0};
+    CHECK_OK(split("same secret", store_share, &first, 0, 2, 2, false, NULL, false, NULL));
+    CHECK_OK(split("same secret", store_share, &second, 0, 2, 2, false, NULL, false, NULL));
+    CHECK(0 != strcmp(first.line[0], second.line[0]));
+
+    // a secret that is not printable comes back with dots and a warning
+    share_store_t store = {0};
+    char output[64];
+    CHECK_OK(split("41ff42", store_share, &store, 24, 2, 3, false, NULL, true, NULL));
+    CHECK_ERROR(ERROR_BINARY_DATA, combine(output, sizeof(output), read_stored_share, &store, 2, false, false));
+    CHECK(0 == strncmp(output, "A.B", 3));
+
+    CHECK_ERROR(ERROR_BINARY_DATA, split("tab\there", store_share, &store, 0, 2, 3, false, NULL, false, NULL));
+    return test_result();
+}
@@ -0,0 +1,111 @@
+/*
+ *  the tuning file and the cost estimates
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define TUNING_FILE "test_tune.txt"
+
+// benchmarking every degree takes too long for a test, so a tuning file
+// is written for this CPU as tune names it and loaded instead
+#if defined(__linux__)
+static void cpu_name(char *buffer, size_t size) {
+    snprintf(buffer, size, "unknown");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (NULL == f) {
+        return;
+    }
+    char line[256];
+    while (NULL != fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        if (0 == strncmp(line, "model name", 10) && NULL != colon) {
+            colon += strspn(colon + 1, " \t") + 1;
+            colon[strcspn(colon, "\r\n")] = '\0';
+            snprintf(buffer, size, "%s", colon);
+            break;
+        }
+    }
+    fclose(f);
+}
+
+static void write_tuning(void) {
+    char cpu[128];
+    cpu_name(cpu, sizeof(cpu));
+    FILE *f = fopen(TUNING_FILE, "w");
+    CHECK(NULL != f);
+    if (NULL == f) {
+        return;
+    }
+#if defined(SSSS_NO_GMP)
+    fprintf(f, "ssss-tuning 1\nbuild fixed\ncpu %s\n", cpu);
+#else
+    fprintf(f, "ssss-tuning 1\nbuild gmp\ncpu %s\n", cpu);
+#endif
+    for (unsigned int degree = 8; degree <= MAXDEGREE; degree += 8) {
+        fprintf(f, "%u limbs generic gauss 100 1000\n", degree);
+    }
+    fclose(f);
+}
+#endif
+
+int main(void) {
+    tuning_t tuning;
+
+    // untuned: no estimate, and asking for one does not benchmark
+    stats_enable(true);
+    histogram_enable(true);
+    CHECK(0 == split_cost(128, 4, 8));
+    CHECK(0 == combine_cost(128, 4));
+    CHECK(0 == combine_cost(136, 12));
+    CHECK_OK(tuning_read(128, &tuning));
+    CHECK(0 == tuning.mult_ns);
+    CHECK(FIELD_BACKEND_FIXED == tuning.mult);
+    CHECK(stats_enabled());
+    CHECK(histogram_enabled());
+    stats_enable(false);
+    histogram_enable(false);
+
+    CHECK_ERROR(ERROR_INPUT_IS_NULL, tuning_read(128, NULL));
+    CHECK_ERROR(ERROR_INVALID_SECURITY_LEVEL, tuning_read(12, &tuning));
+    CHECK(0 == split_cost(12, 4, 8));
+    CHECK(NULL != field_backend_name(FIELD_BACKEND_LIMBS) && 0 == strcmp("limbs", field_backend_name(FIELD_BACKEND_LIMBS)));
+    CHECK(0 == strcmp("lagrange", restore_name(RESTORE_LAGRANGE)));
+
+#if defined(__linux__)
+    write_tuning();
+    CHECK_OK(tune(TUNING_FILE));
+    CHECK_OK(tuning_read(128, &tuning));
+    CHECK(FIELD_BACKEND_LIMBS == tuning.mult);
+    CHECK(FIELD_BACKEND_GENERIC == tuning.invert);
+    CHECK(RESTORE_GAUSS == tuning.restore);
+    CHECK(100 == tuning.mult_ns && 1000 == tuning.invert_ns);
+    CHECK(8 * 3 * 100 == split_cost(128, 4, 8));
+    CHECK(combine_cost(128, 4) > 1000);
+    CHECK(combine_cost(128, 12) > combine_cost(128, 4));
+
+    // the loaded choices still combine correctly
+    share_store_t store = {0};
+    char output[64];
+    CHECK_OK(split("tuned secret", store_share, &store, 128, 4, 6, true, NULL, false, NULL));
+    store.first = 2;
+    CHECK_OK(combine(output, sizeof(output), read_stored_share, &store, 4, true, false));
+    CHECK(0 == strcmp("tuned secret", output));
+    remove(TUNING_FILE);
+#endif
+    return test_result();
+}
@@ -0,0 +1,128 @@
+/*
+ *  wrapped API at the largest degree and for binary secrets, with caller
+ *  random bytes
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307 USA
+ */
+
+#include "test.h"
+
+#define THRESHOLD 4
+#define NUMBER 6
+
+static char random_bytes[(THRESHOLD - 1) * MAXDEGREE / 8];
+
+// a hex secret of degree bits through wrapped_split and wrapped_combine
+static void hex_round_trip(int degree) {
+    char secret[MAXDEGREE / 4 + 1];
+    for (int i = 0; i < degree / 4; ++i) {
+        secret[i] = "0123456789abcdef"[test_random() & 15];
+    }
+    secret[degree / 4] = '\0';
+    size_t needed = (THRESHOLD - 1) * (size_t)degree / 8;
+
+    char **shares = wrapped_allocate_shares(NUMBER);
+    CHECK(NULL != shares);
+    CHECK_OK(wrapped_split(shares, secret, degree, THRESHOLD, NUMBER, false, NULL, true, random_bytes, needed));
+    for (int i = 0; i < NUMBER; ++i) {
+        CHECK(NULL != shares[i] && 2 + (size_t)degree / 4 == strlen(shares[i]));  // "N-" and the digits
+    }
+    const char *use[THRESHOLD] = {shares[5], shares[1], shares[3], shares[0]};
+    char result[MAXDEGREE / 4 + 1];
+    CHECK_OK(wrapped_combine(result, sizeof(result), use, THRESHOLD, false, true));
+    CHECK(0 == strcmp(result, secret));
+
+    // the same array again, and a byte short of random data
+    CHECK_OK(wrapped_split(shares, secret, degree, THRESHOLD, NUMBER, false, "prefix", true, random_bytes, needed));
+    CHECK(0 == strncmp(shares[2], "prefix-3-", 9));
+    CHECK(ERROR_OK != wrapped_split(shares, secret, degree, THRESHOLD, NUMBER, false, NULL, true, random_bytes, needed - 1));
+    CHECK_OK(wrapped_free_shares(shares, NUMBER));
+}
+
+// raw secret and random bytes with zeros in them, leading zeros come back
+static void binary_round_trip(size_t length, size_t zeros) {
+    uint8_t secret[MAXDEGREE / 8];
+    test_fill(secret, length);
+    memset(secret, 0, zeros);
+    char random[(THRESHOLD - 1) * MAXDEGREE / 8];
+    size_t needed = (THRESHOLD - 1) * length;
+    test_fill(random, needed);
+    for (size_t i = 0; i < needed; i += 7) {
+        random[i] = '\0';
+    }
+
+    char **shares = wrapped_allocate_shares(NUMBER);
+    CHECK(NULL != shares);
+    CHECK_OK(wrapped_split_binary(shares, secret, length, THRESHOLD, NUMBER, false, NULL, random, needed));
+    CHECK(ERROR_OK != wrapped_split_binary(shares, secret, length, THRESHOLD, NUMBER, false, NULL, random, needed - 1));
+    const char *use[THRESHOLD] = {shares[2], shares[4], shares[0], shares[5]};
+    uint8_t result[MAXDEGREE / 8];
+    size_t size = 0;
+    CHECK_OK(wrapped_combine_binary(result, sizeof(result), &size, use, THRESHOLD, false));
+    CHECK(length == size && 0 == memcmp(result, secret, length));
+    CHECK_OK(wrapped_free_shares(shares, NUMBER));
+}
+
+static share_store_t serial, ordered;
+
+// the reorder buffer of split_parallel holds shares of the full degree
+static void parallel_round_trip(worker_pool_t *pool) {
+    char secret[MAXDEGREE / 4 + 1];
+    memset(secret, '7', MAXDEGREE / 4);
+    secret[MAXDEGREE / 4] = '\0';
+    uint64_t seed = 5;
+    cprng_t cprng = TEST_CPRNG(&seed);
+    CHECK_OK(split(secret, store_share, &serial, MAXDEGREE, THRESHOLD, TEST_MAX_SHARES, false, "p", true, &cprng));
+    CHECK_OK(split_parallel(secret, store_share, &ordered, MAXDEGREE, THRESHOLD, TEST_MAX_SHARES, false, "p", true, &cprng, pool, true));
+    for (int i = 0; i < TEST_MAX_SHARES; ++i) {
+        CHECK(0 == strcmp(serial.line[i], ordered.line[i]));
+    }
+    char result[MAXDEGREE / 4 + 1];
+    ordered.first = TEST_MAX_SHARES - THRESHOLD;
+    CHECK_OK(combine(result, sizeof(result), read_stored_share, &ordered, THRESHOLD, false, true));
+    CHECK(0 == strcmp(result, secret));
+}
+
+int main(void) {
+    test_fill(random_bytes, sizeof(random_bytes));
+    hex_round_trip(8);
+    hex_round_trip(1024);
+    hex_round_trip(MAXDEGREE);
+    binary_round_trip(1, 1);
+    binary_round_trip(32, 3);
+    binary_round_trip(32, 32);
+    binary_round_trip(MAXDEGREE / 8, 5);
+
+    // thresholds outside 1..number, and a binary secret too long for the field
+    char **shares = wrapped_allocate_shares(NUMBER);
+    uint8_t secret[MAXDEGREE / 8 + 1] = {1};
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, wrapped_split_binary(shares, secret, 16, 0, NUMBER, false, NULL, random_bytes, 64));
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, wrapped_split(shares, "abc", 0, NUMBER + 1, NUMBER, false, NULL, false, random_bytes, 64));
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, split("abc", store_share, &serial, 0, -1, NUMBER, false, NULL, false, NULL));
+    CHECK_ERROR(ERROR_INVALID_SECURITY_LEVEL, wrapped_split_binary(shares, secret, sizeof(secret), 2, NUMBER, false, NULL, random_bytes, sizeof(random_bytes)));
+    CHECK_ERROR(ERROR_INVALID_THRESHOLD, combine((char *)secret, sizeof(secret), read_stored_share, &serial, 0, false, false));
+    CHECK_OK(wrapped_free_shares(shares, NUMBER));
+
+    // freeing an array no split has filled
+    CHECK_OK(wrapped_free_shares(wrapped_allocate_shares(NUMBER), NUMBER));
+
+    pool_config_t config = { .workers = 4 };
+    worker_pool_t *pool = worker_pool_create(&config);
+    CHECK(NULL != pool);
+    parallel_round_trip(pool);
+    worker_pool_destroy(pool);
+    return test_result();
+}
@@ -26,6 +26,27 @@ class ShamirSecretSharingTests: XCTestCase {
         // Use XCTAssert and related functions to verify your tests produce the correct results.
     }
     
+    func testSplitCombineData() {
+        // leading zero bytes must come back
+        let secret = Data(bytes: [0, 0, 0, 1, 2, 3, 0, 255, 128, 7, 0, 42])
+        guard let shares = ShamirSecretSharing.split(secret: secret, threshold: 3, numberOfShare: 5) else {
+            XCTFail("split failed")
+            return
+        }
+        XCTAssertEqual(shares.count, 5)
+        XCTAssertEqual(ShamirSecretSharing.combineData(shares: [shares[4], shares[1], shares[2]]), secret)
+    }
+    
+    func testSplitCombineString() {
+        let secret = "a secret for three of five holders"
+        guard let shares = ShamirSecretSharing.split(secret: secret, threshold: 3, numberOfShare: 5) else {
+            XCTFail("split failed")
+            return
+        }
+        XCTAssertEqual(shares.count, 5)
+        XCTAssertEqual(ShamirSecretSharing.combine(shares: [shares[0], shares[3], shares[4]]), secret)
+    }
+    
     func testPerformanceExample() {
         // This is an example of a performance test case.
         self.measure {